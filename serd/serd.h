@@ -191,8 +191,9 @@ typedef enum {
    Flags indicating certain string properties relevant to serialisation.
 */
 typedef enum {
-	SERD_HAS_NEWLINE = 1,      /**< Contains line breaks ('\\n' or '\\r') */
-	SERD_HAS_QUOTE   = 1 << 1  /**< Contains quotes ('"') */
+	SERD_HAS_NEWLINE = 1,       /**< Contains line breaks ('\\n' or '\\r') */
+	SERD_HAS_QUOTE   = 1 << 1,  /**< Contains quotes ('"') */
+	SERD_IS_STREAMED = 1 << 2   /**< Value was passed to a literal sink */
 } SerdNodeFlag;
 
 /**
@@ -247,6 +248,23 @@ typedef struct {
 	SerdChunk fragment;   /**< Fragment */
 } SerdURI;
 
+/**
+   A memory allocator.
+
+   This can be given to the `_with_allocator` variants of constructors to make
+   serd use a custom allocator, such as an arena or a pool.  The functions have
+   the same semantics as the standard malloc(), realloc(), and free(), with an
+   additional `handle` argument.  A NULL allocator means the standard ones.
+
+   The allocator is not copied, so it must outlive everything that uses it.
+*/
+typedef struct {
+	void* handle;                                               /**< User data */
+	void* (*allocate)(void* handle, size_t size);               /**< Allocate */
+	void* (*reallocate)(void* handle, void* ptr, size_t size);  /**< Resize */
+	void  (*deallocate)(void* handle, void* ptr);               /**< Free */
+} SerdAllocator;
+
 /**
    Syntax style options.
 
@@ -263,6 +281,17 @@ typedef enum {
 	SERD_STYLE_BULK        = 1 << 4   /**< Write output in pages. */
 } SerdStyle;
 
+/**
+   Writer output flush policy.
+
+   The writer always collects output in a buffer, this controls when the
+   buffer is passed to the sink.
+*/
+typedef enum {
+	SERD_FLUSH_STATEMENT = 0,  /**< Flush after every writer call. */
+	SERD_FLUSH_FULL      = 1   /**< Flush only when the buffer is full. */
+} SerdFlushPolicy;
+
 /**
    @name String Utilities
    @{
@@ -292,11 +321,23 @@ serd_strlen(const uint8_t* str, size_t* n_bytes, SerdNodeFlags* flags);
    The API of this function is identical to the standard C strtod function,
    except this function is locale-independent and always matches the lexical
    format used in the Turtle grammar (the decimal point is always ".").
+
+   The result is correctly rounded to the nearest double.
 */
 SERD_API
 double
 serd_strtod(const char* str, char** endptr);
 
+/**
+   Parse at most `len` bytes of a string to a double.
+
+   This is like serd_strtod(), but `str` need not be null terminated, so it
+   can be used to parse numbers directly from a larger buffer.
+*/
+SERD_API
+double
+serd_strntod(const char* str, size_t len, char** endptr);
+
 /**
    Decode a base64 string.
    This function can be used to deserialise a blob node created with
@@ -356,6 +397,16 @@ SERD_API
 SerdStatus
 serd_uri_parse(const uint8_t* utf8, SerdURI* out);
 
+/**
+   Parse the `len` bytes at `buf`, writing result to `out`.
+
+   This is like serd_uri_parse(), but `buf` need not be null terminated, so
+   URIs inside larger strings can be parsed in place.
+*/
+SERD_API
+SerdStatus
+serd_uri_parse_chunk(const uint8_t* buf, size_t len, SerdURI* out);
+
 /**
    Set `out` to `uri` resolved against `base`.
 */
@@ -375,6 +426,46 @@ SERD_API
 size_t
 serd_uri_serialise(const SerdURI* uri, SerdSink sink, void* stream);
 
+/**
+   Serialise `uri` to `buf` without allocating.
+
+   The result is the same as serd_uri_serialise(), but written directly to
+   `buf` and null terminated.  Nothing is written if the result does not fit,
+   so `buf` may be NULL to only measure the length.
+
+   @param uri The URI to serialise.
+   @param buf Output buffer of `size` bytes.
+   @param size Size of `buf` in bytes.
+   @return The length of the URI string, excluding the null terminator.  If
+   this is greater than or equal to `size`, nothing was written.
+*/
+SERD_API
+size_t
+serd_uri_serialise_buffer(const SerdURI* uri, uint8_t* buf, size_t size);
+
+/**
+   Resolve the URI reference `str` against `base` and write it to `buf`.
+
+   This parses, resolves, and serialises in a single call without allocating,
+   which is much faster than creating a node for each of many URIs.
+
+   @param str URI reference string, which need not be null terminated.
+   @param len Length of `str` in bytes.
+   @param base Parsed base URI, or NULL for no resolution.
+   @param buf Output buffer of `size` bytes.
+   @param size Size of `buf` in bytes.
+   @return The length of the resolved URI, excluding the null terminator.  If
+   this is greater than or equal to `size`, nothing was written, and the call
+   can be repeated with a buffer of at least the returned length plus one.
+*/
+SERD_API
+size_t
+serd_uri_resolve_string(const uint8_t* str,
+                        size_t         len,
+                        const SerdURI* base,
+                        uint8_t*       buf,
+                        size_t         size);
+
 /**
    Serialise `uri` relative to `base` with a series of calls to `sink`.
 
@@ -416,6 +507,17 @@ SERD_API
 SerdNode
 serd_node_copy(const SerdNode* node);
 
+/**
+   Make a deep copy of `node` using `allocator`.
+
+   @return a node that the caller must free with
+   serd_node_free_with_allocator().
+*/
+SERD_API
+SerdNode
+serd_node_copy_with_allocator(const SerdAllocator* allocator,
+                              const SerdNode*      node);
+
 /**
    Return true iff `a` is equal to `b`.
 */
@@ -432,6 +534,16 @@ serd_node_new_uri_from_node(const SerdNode* uri_node,
                             const SerdURI*  base,
                             SerdURI*        out);
 
+/**
+   Like serd_node_new_uri_from_node(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_uri_from_node_with_allocator(const SerdAllocator* allocator,
+                                           const SerdNode*      uri_node,
+                                           const SerdURI*       base,
+                                           SerdURI*             out);
+
 /**
    Simple wrapper for serd_node_new_uri to resolve a URI string.
 */
@@ -441,6 +553,16 @@ serd_node_new_uri_from_string(const uint8_t* str,
                               const SerdURI* base,
                               SerdURI*       out);
 
+/**
+   Like serd_node_new_uri_from_string(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_uri_from_string_with_allocator(const SerdAllocator* allocator,
+                                             const uint8_t*       str,
+                                             const SerdURI*       base,
+                                             SerdURI*             out);
+
 /**
    Create a new file URI node from a file system path and optional hostname.
 
@@ -458,6 +580,17 @@ serd_node_new_file_uri(const uint8_t* path,
                        SerdURI*       out,
                        bool           escape);
 
+/**
+   Like serd_node_new_file_uri(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_file_uri_with_allocator(const SerdAllocator* allocator,
+                                      const uint8_t*       path,
+                                      const uint8_t*       hostname,
+                                      SerdURI*             out,
+                                      bool                 escape);
+
 /**
    Create a new node by serialising `uri` into a new string.
 
@@ -472,6 +605,16 @@ SERD_API
 SerdNode
 serd_node_new_uri(const SerdURI* uri, const SerdURI* base, SerdURI* out);
 
+/**
+   Like serd_node_new_uri(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_uri_with_allocator(const SerdAllocator* allocator,
+                                 const SerdURI*       uri,
+                                 const SerdURI*       base,
+                                 SerdURI*             out);
+
 /**
    Create a new node by serialising `d` into an xsd:decimal string.
 
@@ -491,6 +634,33 @@ SERD_API
 SerdNode
 serd_node_new_decimal(double d, unsigned frac_digits);
 
+/**
+   Like serd_node_new_decimal(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_decimal_with_allocator(const SerdAllocator* allocator,
+                                     double               d,
+                                     unsigned             frac_digits);
+
+/**
+   Create a new node by serialising `d` into an xsd:double string.
+
+   The result is in canonical form, with one digit before the decimal point
+   and an exponent (e.g. "1.5E-3"), or "NaN", "INF", or "-INF".  It is always
+   the shortest form that reads back as exactly `d`.
+*/
+SERD_API
+SerdNode
+serd_node_new_double(double d);
+
+/**
+   Like serd_node_new_double(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_double_with_allocator(const SerdAllocator* allocator, double d);
+
 /**
    Create a new node by serialising `i` into an xsd:integer string.
 */
@@ -498,6 +668,48 @@ SERD_API
 SerdNode
 serd_node_new_integer(int64_t i);
 
+/**
+   Like serd_node_new_integer(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_integer_with_allocator(const SerdAllocator* allocator,
+                                     int64_t              i);
+
+/**
+   Size of a buffer large enough for any result of serd_format_integer().
+*/
+#define SERD_INTEGER_BUF_SIZE 24
+
+/**
+   Size of a buffer large enough for any result of serd_format_double().
+*/
+#define SERD_DOUBLE_BUF_SIZE 32
+
+/**
+   Write `i` as an xsd:integer string to `buf` without allocating.
+
+   @param i The value to write.
+   @param buf Output buffer of at least SERD_INTEGER_BUF_SIZE bytes.
+   @return The length of the written string, which is null terminated.
+*/
+SERD_API
+size_t
+serd_format_integer(int64_t i, uint8_t* buf);
+
+/**
+   Write `d` as an xsd:double string to `buf` without allocating.
+
+   The output is the same as the string of serd_node_new_double().
+
+   @param d The value to write.
+   @param buf Output buffer of at least SERD_DOUBLE_BUF_SIZE bytes.
+   @return The length of the written string, which is null terminated.
+*/
+SERD_API
+size_t
+serd_format_double(double d, uint8_t* buf);
+
 /**
    Create a node by serialising `buf` into an xsd:base64Binary string.
    This function can be used to make a serialisable node out of arbitrary
@@ -511,6 +723,16 @@ SERD_API
 SerdNode
 serd_node_new_blob(const void* buf, size_t size, bool wrap_lines);
 
+/**
+   Like serd_node_new_blob(), but allocate with `allocator`.
+*/
+SERD_API
+SerdNode
+serd_node_new_blob_with_allocator(const SerdAllocator* allocator,
+                                  const void*          buf,
+                                  size_t               size,
+                                  bool                 wrap_lines);
+
 /**
    Free any data owned by `node`.
 
@@ -521,6 +743,13 @@ SERD_API
 void
 serd_node_free(SerdNode* node);
 
+/**
+   Free any data owned by `node`, which was allocated with `allocator`.
+*/
+SERD_API
+void
+serd_node_free_with_allocator(const SerdAllocator* allocator, SerdNode* node);
+
 /**
    @}
    @name Event Handlers
@@ -577,6 +806,26 @@ typedef SerdStatus (*SerdStatementSink)(void*              handle,
 typedef SerdStatus (*SerdEndSink)(void*           handle,
                                   const SerdNode* node);
 
+/**
+   Sink (callback) for the start of a streamed literal.
+
+   @see serd_reader_set_literal_sink()
+*/
+typedef SerdStatus (*SerdLiteralBeginSink)(void* handle);
+
+/**
+   Sink (callback) for a piece of a streamed literal.
+
+   The chunk is not null terminated, and is only valid during the call.
+*/
+typedef SerdStatus (*SerdLiteralChunkSink)(void*            handle,
+                                           const SerdChunk* chunk);
+
+/**
+   Sink (callback) for the end of a streamed literal.
+*/
+typedef SerdStatus (*SerdLiteralEndSink)(void* handle);
+
 /**
    @}
    @name Environment
@@ -590,6 +839,17 @@ SERD_API
 SerdEnv*
 serd_env_new(const SerdNode* base_uri);
 
+/**
+   Create a new environment that allocates memory with `allocator`.
+
+   Nodes returned by serd_env_expand_node() are also allocated with
+   `allocator`, and must be freed with serd_node_free_with_allocator().
+*/
+SERD_API
+SerdEnv*
+serd_env_new_with_allocator(const SerdAllocator* allocator,
+                            const SerdNode*      base_uri);
+
 /**
    Free `ns`.
 */
@@ -687,6 +947,20 @@ serd_reader_new(SerdSyntax        syntax,
                 SerdStatementSink statement_sink,
                 SerdEndSink       end_sink);
 
+/**
+   Create a new RDF reader that allocates memory with `allocator`.
+*/
+SERD_API
+SerdReader*
+serd_reader_new_with_allocator(const SerdAllocator* allocator,
+                               SerdSyntax           syntax,
+                               void*                handle,
+                               void                 (*free_handle)(void*),
+                               SerdBaseSink         base_sink,
+                               SerdPrefixSink       prefix_sink,
+                               SerdStatementSink    statement_sink,
+                               SerdEndSink          end_sink);
+
 /**
    Enable or disable strict parsing.
 
@@ -698,6 +972,17 @@ SERD_API
 void
 serd_reader_set_strict(SerdReader* reader, bool strict);
 
+/**
+   Enable or disable timing in the reader statistics.
+
+   Timing is disabled by default, since it reads the clock around every call
+   to a sink, and then the `sink_time` and `parse_time` statistics are zero.
+   The other counters are always enabled (see serd_reader_get_stats()).
+*/
+SERD_API
+void
+serd_reader_set_timing(SerdReader* reader, bool timing);
+
 /**
    Set a function to be called when errors occur during reading.
 
@@ -710,6 +995,28 @@ serd_reader_set_error_sink(SerdReader*   reader,
                            SerdErrorSink error_sink,
                            void*         handle);
 
+/**
+   Set functions to stream long literals in chunks.
+
+   Literals longer than `threshold` bytes are not accumulated in memory, but
+   passed to `chunk_sink` in pieces of about `threshold` bytes, which always
+   end on a character boundary.  The pieces of each streamed literal are
+   preceded by a call to `begin_sink` and followed by a call to `end_sink`,
+   then the statement is emitted as usual with an empty object literal that
+   has the SERD_IS_STREAMED flag set.  If any of these sinks returns an error,
+   or the literal is invalid, reading fails and `end_sink` is not called.
+
+   All sinks are called with the handle passed to serd_reader_new().  A
+   `threshold` of zero disables streaming, which is the default.
+*/
+SERD_API
+void
+serd_reader_set_literal_sink(SerdReader*          reader,
+                             size_t               threshold,
+                             SerdLiteralBeginSink begin_sink,
+                             SerdLiteralChunkSink chunk_sink,
+                             SerdLiteralEndSink   end_sink);
+
 /**
    Return the `handle` passed to serd_reader_new().
 */
@@ -773,11 +1080,52 @@ serd_reader_start_stream(SerdReader*    me,
    may be a directive, statement, or several statements; essentially it reads
    until a '.' is encountered.  This is particularly useful for reading
    directly from a pipe or socket.
+
+   @return SERD_SUCCESS if a chunk was read, SERD_FAILURE at the end of the
+   input, or an error code if the input is invalid.
 */
 SERD_API
 SerdStatus
 serd_reader_read_chunk(SerdReader* me);
 
+/**
+   Return the number of bytes consumed from the input so far.
+
+   This is the offset from the start of the current stream or string.
+   Immediately after serd_reader_read_chunk() returns successfully, this is
+   the offset of a statement boundary, where a fresh stream may be started
+   (see SerdIndex).
+*/
+SERD_API
+size_t
+serd_reader_get_offset(const SerdReader* me);
+
+/**
+   Reader performance counters.
+
+   Counters accumulate over the lifetime of the reader, across all streams and
+   strings read.  If serd was built with SERD_NO_STATS defined, counting is
+   compiled out and all fields are zero.
+*/
+typedef struct {
+	size_t n_bytes;         /**< Input bytes consumed */
+	size_t n_statements;    /**< Statements emitted to the statement sink */
+	size_t n_nodes;         /**< Nodes pushed to the stack */
+	size_t n_escaped;       /**< Escape sequences decoded */
+	size_t n_pages;         /**< Input pages read from a file */
+	size_t stack_peak;      /**< Stack high-water mark in bytes */
+	size_t stack_reallocs;  /**< Number of stack reallocations */
+	double sink_time;       /**< Seconds spent in user sinks, if timing */
+	double parse_time;      /**< Seconds spent reading, if timing */
+} SerdReaderStats;
+
+/**
+   Return the performance counters of `reader`.
+*/
+SERD_API
+SerdReaderStats
+serd_reader_get_stats(const SerdReader* reader);
+
 /**
    Finish an incremental read from a file handle.
 */
@@ -808,6 +1156,102 @@ SERD_API
 void
 serd_reader_free(SerdReader* reader);
 
+/**
+   @}
+   @name Index
+   @{
+*/
+
+/**
+   Statement offset index.
+
+   An index records the byte offset of every Nth top level statement in a
+   file, along with the directives (base URI and prefixes) that are in effect
+   at that point.  This allows reading to begin part-way through a large file,
+   for example to extract a range of statements or to process separate ranges
+   in parallel.
+
+   Note that blank node IDs generated for anonymous nodes start over when
+   reading from an indexed position, so a distinct blank prefix (see
+   serd_reader_add_blank_prefix()) should be used for each range that is to be
+   merged into the same output.
+*/
+typedef struct SerdIndexImpl SerdIndex;
+
+/**
+   Create a new empty index with a checkpoint every `interval` statements.
+*/
+SERD_API
+SerdIndex*
+serd_index_new(unsigned interval);
+
+/**
+   Free `index`.
+*/
+SERD_API
+void
+serd_index_free(SerdIndex* index);
+
+/**
+   Build `index` by reading `file` from its current position to the end.
+
+   The first checkpoint is always the starting position.  Offsets are relative
+   to the starting position, which should normally be the start of the file.
+*/
+SERD_API
+SerdStatus
+serd_index_build(SerdIndex*     index,
+                 SerdSyntax     syntax,
+                 FILE*          file,
+                 const uint8_t* name);
+
+/**
+   Return the number of checkpoints in `index`.
+*/
+SERD_API
+size_t
+serd_index_get_size(const SerdIndex* index);
+
+/**
+   Return the byte offset of checkpoint `i` in `index`.
+*/
+SERD_API
+size_t
+serd_index_get_offset(const SerdIndex* index, size_t i);
+
+/**
+   Seek `file` to checkpoint `i` and restore the directives in effect there.
+
+   The base URI and prefix directives which precede the checkpoint are passed
+   to `base_sink` and `prefix_sink` (either may be NULL) in document order, so
+   a writer or environment can be brought up to date before reading resumes.
+   A stream can then be started on `file` with serd_reader_start_stream() or
+   serd_reader_read_file_handle().
+*/
+SERD_API
+SerdStatus
+serd_index_seek(const SerdIndex* index,
+                size_t           i,
+                FILE*            file,
+                SerdBaseSink     base_sink,
+                SerdPrefixSink   prefix_sink,
+                void*            handle);
+
+/**
+   Write `index` to `out` in a simple line-based text format.
+*/
+SERD_API
+SerdStatus
+serd_index_write(const SerdIndex* index, FILE* out);
+
+/**
+   Read an index previously written with serd_index_write().
+   @return A new index, or NULL on error.
+*/
+SERD_API
+SerdIndex*
+serd_index_read(FILE* in);
+
 /**
    @}
    @name Writer
@@ -826,6 +1270,19 @@ serd_writer_new(SerdSyntax     syntax,
                 SerdSink       sink,
                 void*          stream);
 
+/**
+   Create a new RDF writer that allocates memory with `allocator`.
+*/
+SERD_API
+SerdWriter*
+serd_writer_new_with_allocator(const SerdAllocator* allocator,
+                               SerdSyntax           syntax,
+                               SerdStyle            style,
+                               SerdEnv*             env,
+                               const SerdURI*       base_uri,
+                               SerdSink             sink,
+                               void*                stream);
+
 /**
    Free `writer`.
 */
@@ -884,6 +1341,28 @@ serd_writer_set_error_sink(SerdWriter*   writer,
                            SerdErrorSink error_sink,
                            void*         handle);
 
+/**
+   Set the size of the output buffer and when it is flushed.
+
+   By default, the buffer is one page, and is flushed after every statement
+   or directive, or only when full if SERD_STYLE_BULK is set.  With
+   SERD_FLUSH_FULL, output is passed to the sink in blocks of exactly `size`
+   bytes, except for the remainder written by serd_writer_flush() or
+   serd_writer_finish().  Any buffered output is flushed before resizing.
+*/
+SERD_API
+void
+serd_writer_set_buffer(SerdWriter*     writer,
+                       size_t          size,
+                       SerdFlushPolicy policy);
+
+/**
+   Pass any buffered output to the sink.
+*/
+SERD_API
+void
+serd_writer_flush(SerdWriter* writer);
+
 /**
    Set a prefix to be removed from matching blank node identifiers.
 */
@@ -961,6 +1440,634 @@ SERD_API
 SerdStatus
 serd_writer_finish(SerdWriter* writer);
 
+/**
+   @}
+   @name Sorter
+   @{
+*/
+
+/**
+   Statement sorter.
+
+   A sorter is a statement sink which collects statements and passes them on
+   to another sink (typically a writer) sorted by subject, then predicate, so
+   that Turtle output is as abbreviated as possible.  Statements with equal
+   subject and predicate stay in their original order.
+
+   Statements are kept in memory up to a given budget, beyond which sorted
+   runs are written to temporary files and merged at the end, so memory use is
+   bounded regardless of the input size.
+
+   Relative URIs and CURIEs are expanded with the environment when statements
+   are added, since it may have changed by the time they are written.
+   Anonymous nodes and lists can not be written inline once sorted, so all
+   statement flags are dropped and blank nodes are written with their labels.
+*/
+typedef struct SerdSorterImpl SerdSorter;
+
+/**
+   Create a new sorter.
+
+   @param env Environment for expanding relative URIs and CURIEs.
+   @param budget Number of bytes of memory to use before writing to disk.
+   @param statement_sink Sink to call with sorted statements.
+   @param handle Handle passed to `statement_sink`.
+*/
+SERD_API
+SerdSorter*
+serd_sorter_new(SerdEnv*          env,
+                size_t            budget,
+                SerdStatementSink statement_sink,
+                void*             handle);
+
+/**
+   Free `sorter`, discarding any statements which have not been written.
+*/
+SERD_API
+void
+serd_sorter_free(SerdSorter* sorter);
+
+/**
+   Add a statement to `sorter`.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SERD_API
+SerdStatus
+serd_sorter_add_statement(SerdSorter*        sorter,
+                          SerdStatementFlags flags,
+                          const SerdNode*    graph,
+                          const SerdNode*    subject,
+                          const SerdNode*    predicate,
+                          const SerdNode*    object,
+                          const SerdNode*    object_datatype,
+                          const SerdNode*    object_lang);
+
+/**
+   Write all added statements to the sink in order.
+
+   The sorter is empty afterwards and may be used again.
+*/
+SERD_API
+SerdStatus
+serd_sorter_finish(SerdSorter* sorter);
+
+/**
+   @}
+   @name Partitioner
+   @{
+*/
+
+/**
+   Statement partitioner.
+
+   A partitioner is a statement sink which distributes statements among
+   several sinks (typically writers to separate files) by a hash of the
+   subject, so all statements about a subject go to the same sink.  CURIEs
+   and relative URIs are expanded with the environment before hashing, so the
+   choice does not depend on how a subject was written.
+
+   The description of a blank node goes to the same sink as the first
+   statement that refers to it, wherever it appears in the input, so blank
+   nodes are not split between sinks.  A blank node that is described before
+   it is referred to goes to the sink for its label.  The sink of every blank
+   node is remembered, so memory grows with the number of blank nodes.
+*/
+typedef struct SerdPartitionerImpl SerdPartitioner;
+
+/**
+   Create a new partitioner.
+
+   @param env Environment for expanding relative URIs and CURIEs.
+   @param n_sinks Number of sinks to distribute statements among.
+   @param statement_sink Sink to call with statements.
+   @param end_sink Sink to call with the end of anonymous nodes, or NULL.
+   @param handles Array of `n_sinks` handles passed to the sinks.
+*/
+SERD_API
+SerdPartitioner*
+serd_partitioner_new(SerdEnv*          env,
+                     unsigned          n_sinks,
+                     SerdStatementSink statement_sink,
+                     SerdEndSink       end_sink,
+                     void* const*      handles);
+
+/**
+   Free `partitioner`.
+*/
+SERD_API
+void
+serd_partitioner_free(SerdPartitioner* partitioner);
+
+/**
+   Return the index of the sink that the statement with `subject` goes to.
+
+   This only depends on `subject`, and not on any previous statements, so
+   blank nodes in a description are not handled specially.
+*/
+SERD_API
+unsigned
+serd_partitioner_get_index(const SerdPartitioner* partitioner,
+                           const SerdNode*        subject);
+
+/**
+   Write a statement to the sink for its subject.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SERD_API
+SerdStatus
+serd_partitioner_write_statement(SerdPartitioner*   partitioner,
+                                 SerdStatementFlags flags,
+                                 const SerdNode*    graph,
+                                 const SerdNode*    subject,
+                                 const SerdNode*    predicate,
+                                 const SerdNode*    object,
+                                 const SerdNode*    object_datatype,
+                                 const SerdNode*    object_lang);
+
+/**
+   Mark the end of an anonymous node in the sink of the current statement.
+
+   Note this function can be safely casted to SerdEndSink.
+*/
+SERD_API
+SerdStatus
+serd_partitioner_end_anon(SerdPartitioner* partitioner,
+                          const SerdNode*  node);
+
+/**
+   @}
+   @name Filter
+   @{
+*/
+
+/**
+   A part of a statement that a filter pattern applies to.
+*/
+typedef enum {
+	SERD_FILTER_SUBJECT   = 0,  /**< Subject URI */
+	SERD_FILTER_PREDICATE = 1,  /**< Predicate URI */
+	SERD_FILTER_OBJECT    = 2,  /**< Object URI */
+	SERD_FILTER_GRAPH     = 3,  /**< Graph URI */
+	SERD_FILTER_DATATYPE  = 4,  /**< Datatype URI of literal object */
+	SERD_FILTER_LANG      = 5   /**< Language tag of literal object */
+} SerdFilterField;
+
+/**
+   Statement filter.
+
+   A filter is a statement sink which only passes on statements that match
+   its patterns to another sink.  Each pattern is either an exact string or a
+   prefix for one field of a statement.  A statement matches if, for every
+   field with patterns, the field matches any of them.  Fields without
+   patterns match anything.
+
+   URI fields only match URIs, with CURIEs and relative URIs expanded by the
+   environment first.  Literals without a datatype have the datatype
+   xsd:string, or rdf:langString if they have a language.  Language tags are
+   matched case-insensitively.  Statements without a graph do not match any
+   graph pattern.
+
+   Exact patterns are stored in a hash table and prefixes in a trie, so the
+   cost of filtering a statement does not depend on the number of patterns.
+
+   Since the statements that are passed on may no longer form complete
+   anonymous nodes or lists, they are passed on without abbreviation flags,
+   so blank nodes are written with labels.
+*/
+typedef struct SerdFilterImpl SerdFilter;
+
+/**
+   Create a new filter with no patterns, which passes on all statements.
+
+   @param env Environment for expanding relative URIs and CURIEs.
+   @param statement_sink Sink to call with matching statements.
+   @param handle Handle passed to `statement_sink`.
+*/
+SERD_API
+SerdFilter*
+serd_filter_new(SerdEnv*          env,
+                SerdStatementSink statement_sink,
+                void*             handle);
+
+/**
+   Free `filter`.
+*/
+SERD_API
+void
+serd_filter_free(SerdFilter* filter);
+
+/**
+   Add a pattern which matches `field` if it is exactly `str`.
+*/
+SERD_API
+SerdStatus
+serd_filter_add_exact(SerdFilter*     filter,
+                      SerdFilterField field,
+                      const uint8_t*  str);
+
+/**
+   Add a pattern which matches `field` if it starts with `prefix`.
+*/
+SERD_API
+SerdStatus
+serd_filter_add_prefix(SerdFilter*     filter,
+                       SerdFilterField field,
+                       const uint8_t*  prefix);
+
+/**
+   Return true iff a statement matches the patterns of `filter`.
+*/
+SERD_API
+bool
+serd_filter_matches(SerdFilter*     filter,
+                    const SerdNode* graph,
+                    const SerdNode* subject,
+                    const SerdNode* predicate,
+                    const SerdNode* object,
+                    const SerdNode* object_datatype,
+                    const SerdNode* object_lang);
+
+/**
+   Pass a statement on to the sink of `filter` if it matches.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SERD_API
+SerdStatus
+serd_filter_write_statement(SerdFilter*        filter,
+                            SerdStatementFlags flags,
+                            const SerdNode*    graph,
+                            const SerdNode*    subject,
+                            const SerdNode*    predicate,
+                            const SerdNode*    object,
+                            const SerdNode*    object_datatype,
+                            const SerdNode*    object_lang);
+
+/**
+   @}
+   @name Batch Writer
+   @{
+*/
+
+/**
+   A batch of statements to be written.
+
+   A batch owns a copy of all the statements added to it, so it can be written
+   by a batch writer after the nodes it was built from are gone.
+*/
+typedef struct SerdBatchImpl SerdBatch;
+
+/**
+   Parallel RDF writer.
+
+   Statements are written in batches, which are formatted on worker threads
+   into private buffers, then written to the output sink in the order they
+   were given.  Each batch is formatted by a separate SerdWriter, so
+   abbreviation works within batches but not across them: for the most compact
+   Turtle, batches should end at subject boundaries.
+
+   The environment is shared with worker threads and must not be modified
+   while a batch writer is using it.  Base and prefix directives for the
+   environment are written once when the batch writer is created.
+*/
+typedef struct SerdBatchWriterImpl SerdBatchWriter;
+
+/**
+   Create a new empty batch.
+*/
+SERD_API
+SerdBatch*
+serd_batch_new(void);
+
+/**
+   Free `batch`.
+*/
+SERD_API
+void
+serd_batch_free(SerdBatch* batch);
+
+/**
+   Remove all statements from `batch`, keeping its memory for reuse.
+*/
+SERD_API
+void
+serd_batch_clear(SerdBatch* batch);
+
+/**
+   Return the number of events (statements and ends) in `batch`.
+*/
+SERD_API
+size_t
+serd_batch_size(const SerdBatch* batch);
+
+/**
+   Add a statement to `batch`.
+
+   Note this function can be safely casted to SerdStatementSink.
+*/
+SERD_API
+SerdStatus
+serd_batch_add_statement(SerdBatch*         batch,
+                         SerdStatementFlags flags,
+                         const SerdNode*    graph,
+                         const SerdNode*    subject,
+                         const SerdNode*    predicate,
+                         const SerdNode*    object,
+                         const SerdNode*    object_datatype,
+                         const SerdNode*    object_lang);
+
+/**
+   Mark the end of an anonymous node's description in `batch`.
+
+   Note this function can be safely casted to SerdEndSink.
+*/
+SERD_API
+SerdStatus
+serd_batch_end_anon(SerdBatch* batch, const SerdNode* node);
+
+/**
+   Create a new batch writer.
+
+   Parameters are as for serd_writer_new(), except `n_threads` is the number of
+   worker threads to use.  If this is less than 2, or threads are not
+   supported, batches are formatted synchronously by the calling thread.
+*/
+SERD_API
+SerdBatchWriter*
+serd_batch_writer_new(SerdSyntax     syntax,
+                      SerdStyle      style,
+                      SerdEnv*       env,
+                      const SerdURI* base_uri,
+                      SerdSink       ssink,
+                      void*          stream,
+                      unsigned       n_threads);
+
+/**
+   Write the statements in `batch`.
+
+   The contents of `batch` are taken by the writer, and `batch` is replaced
+   with an empty batch (which may reuse memory from an earlier batch).  This
+   blocks only if all workers are busy.  The returned status is that of the
+   first failed batch so far, which may not be this one.
+*/
+SERD_API
+SerdStatus
+serd_batch_writer_write(SerdBatchWriter* writer, SerdBatch* batch);
+
+/**
+   Wait for all batches to be formatted and written to the sink.
+*/
+SERD_API
+SerdStatus
+serd_batch_writer_finish(SerdBatchWriter* writer);
+
+/**
+   Finish writing and free `writer`.
+*/
+SERD_API
+void
+serd_batch_writer_free(SerdBatchWriter* writer);
+
+/**
+   @}
+   @name Compressor
+   @{
+*/
+
+/**
+   Compression format.
+*/
+typedef enum {
+	SERD_GZIP = 1,  /**< Gzip (RFC 1952), requires zlib */
+	SERD_ZSTD = 2   /**< Zstandard (RFC 8878), requires libzstd */
+} SerdCompression;
+
+/**
+   Output compressor.
+
+   A compressor is a sink which compresses everything written to it and
+   passes the result on to another sink.  It is typically placed between a
+   writer and a file, by passing serd_compressor_sink() and the compressor as
+   the writer's sink and stream.
+
+   With several threads, input is split into blocks which are compressed
+   independently on worker threads, and written in order as separate gzip
+   members or zstd frames.  Standard tools decompress such output as a single
+   stream, at a slight cost in compression ratio.
+*/
+typedef struct SerdCompressorImpl SerdCompressor;
+
+/**
+   Return true iff `format` is supported by this build.
+*/
+SERD_API
+bool
+serd_compression_supported(SerdCompression format);
+
+/**
+   Create a new compressor.
+
+   @param format Compression format.
+   @param level Compression level, or 0 for the format's default.
+   @param n_threads Number of worker threads, or 0 or 1 to compress as a
+   single stream on the calling thread.
+   @param sink Sink for compressed output.
+   @param stream Stream passed to `sink`.
+   @return A new compressor, or NULL if `format` is not supported.
+*/
+SERD_API
+SerdCompressor*
+serd_compressor_new(SerdCompression format,
+                    int             level,
+                    unsigned        n_threads,
+                    SerdSink        sink,
+                    void*           stream);
+
+/**
+   Compress `len` bytes of `buf` to `stream`, which must be a SerdCompressor.
+
+   This is a SerdSink, and returns `len` on success or 0 on error.
+*/
+SERD_API
+size_t
+serd_compressor_sink(const void* buf, size_t len, void* stream);
+
+/**
+   Compress any pending input and write the end of the output.
+
+   Nothing may be written to `comp` after this is called.
+*/
+SERD_API
+SerdStatus
+serd_compressor_finish(SerdCompressor* comp);
+
+/**
+   Free `comp`, discarding any output which has not been finished.
+*/
+SERD_API
+void
+serd_compressor_free(SerdCompressor* comp);
+
+/**
+   @}
+   @name Asynchronous Sink
+   @{
+*/
+
+/**
+   Asynchronous output sink.
+
+   An asynchronous sink copies everything written to it into fixed-size
+   blocks, which are passed to another sink on a separate I/O thread, so a
+   slow disk or pipe does not stall reading and writing.  Writing only blocks
+   when all blocks are waiting to be written.  If threads are not supported,
+   output is written synchronously.
+
+   This is typically placed between a writer and its output, by passing
+   serd_async_sink_write() and the async sink as the writer's sink and stream.
+   Since the writer itself buffers output, serd_writer_finish() (or
+   serd_writer_flush()) must be called before serd_async_sink_flush() to pass
+   all output on to the I/O thread.
+*/
+typedef struct SerdAsyncSinkImpl SerdAsyncSink;
+
+/**
+   Create a new asynchronous sink.
+
+   @param block_size Size of each block, or 0 for one page.
+   @param n_blocks Number of blocks, at least 2.
+   @param sink Sink called on the I/O thread.
+   @param stream Stream passed to `sink`.
+*/
+SERD_API
+SerdAsyncSink*
+serd_async_sink_new(size_t   block_size,
+                    size_t   n_blocks,
+                    SerdSink sink,
+                    void*    stream);
+
+/**
+   Queue `len` bytes of `buf` to be written, where `stream` is a SerdAsyncSink.
+
+   This is a SerdSink, and returns `len` on success or 0 if an error has
+   occurred in the I/O thread.
+*/
+SERD_API
+size_t
+serd_async_sink_write(const void* buf, size_t len, void* stream);
+
+/**
+   Wait until everything written to `async` has been passed to its sink.
+
+   @return SERD_ERR_UNKNOWN if the sink failed to write some output.
+*/
+SERD_API
+SerdStatus
+serd_async_sink_flush(SerdAsyncSink* async);
+
+/**
+   Flush and free `async`.
+*/
+SERD_API
+void
+serd_async_sink_free(SerdAsyncSink* async);
+
+/**
+   @}
+   @name Base64
+   @{
+*/
+
+/**
+   Incremental base64 encoder.
+
+   An encoder writes the base64 encoding of binary data which is given in
+   chunks of any size to a sink, so large blobs can be written without
+   holding the entire blob or its encoding in memory.  The output is the same
+   as the string of serd_node_new_blob().
+*/
+typedef struct SerdBase64EncoderImpl SerdBase64Encoder;
+
+/**
+   Incremental base64 decoder.
+
+   A decoder writes the binary data decoded from base64 text which is given
+   in chunks of any size to a sink.  Like serd_base64_decode(), characters not
+   in the base64 alphabet (such as line breaks) are ignored.
+*/
+typedef struct SerdBase64DecoderImpl SerdBase64Decoder;
+
+/**
+   Create a new base64 encoder.
+
+   @param wrap_lines Wrap lines at 76 characters to conform to RFC 2045.
+   @param sink Sink for base64 text.
+   @param stream Stream passed to `sink`.
+*/
+SERD_API
+SerdBase64Encoder*
+serd_base64_encoder_new(bool wrap_lines, SerdSink sink, void* stream);
+
+/**
+   Encode `size` bytes of `buf`.
+
+   Up to 2 trailing bytes may be kept until the next write or finish.
+*/
+SERD_API
+SerdStatus
+serd_base64_encoder_write(SerdBase64Encoder* enc, const void* buf, size_t size);
+
+/**
+   Write the end of the encoding, with padding if necessary.
+*/
+SERD_API
+SerdStatus
+serd_base64_encoder_finish(SerdBase64Encoder* enc);
+
+/**
+   Free `enc`.
+*/
+SERD_API
+void
+serd_base64_encoder_free(SerdBase64Encoder* enc);
+
+/**
+   Create a new base64 decoder.
+
+   @param sink Sink for decoded binary data.
+   @param stream Stream passed to `sink`.
+*/
+SERD_API
+SerdBase64Decoder*
+serd_base64_decoder_new(SerdSink sink, void* stream);
+
+/**
+   Decode `len` characters of `str`.
+
+   Up to 3 trailing characters may be kept until the next write or finish.
+*/
+SERD_API
+SerdStatus
+serd_base64_decoder_write(SerdBase64Decoder* dec,
+                          const uint8_t*     str,
+                          size_t             len);
+
+/**
+   Decode any incomplete final group of characters.
+*/
+SERD_API
+SerdStatus
+serd_base64_decoder_finish(SerdBase64Decoder* dec);
+
+/**
+   Free `dec`.
+*/
+SERD_API
+void
+serd_base64_decoder_free(SerdBase64Decoder* dec);
+
 /**
    @}
    @}
@@ -0,0 +1,219 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD
+#    include <pthread.h>
+#endif
+
+typedef struct {
+	uint8_t* buf;
+	size_t   len;
+} AsyncBlock;
+
+/**
+   Ring of blocks with a single producer and a single consumer.
+
+   The producer fills the block at `tail`, and the I/O thread writes blocks
+   from `head` up to (but not including) `tail`.  The counters only increase,
+   so the ring is full when `tail - head == n_blocks`.  Only the counters and
+   status are shared, and they are only accessed with the mutex held.
+*/
+struct SerdAsyncSinkImpl {
+	SerdSink        sink;
+	void*           stream;
+	AsyncBlock*     blocks;
+	size_t          n_blocks;
+	size_t          block_size;
+	size_t          head;  ///< Index of next block to write to sink
+	size_t          tail;  ///< Index of block being filled
+	SerdStatus      st;
+#ifdef HAVE_PTHREAD
+	pthread_t       thread;
+	bool            threaded;
+	pthread_mutex_t mutex;
+	pthread_cond_t  work_cond;  ///< Signalled when a block is filled
+	pthread_cond_t  done_cond;  ///< Signalled when a block is written
+	bool            exit;
+#endif
+};
+
+#ifdef HAVE_PTHREAD
+static void*
+io_run(void* arg)
+{
+	SerdAsyncSink* async = (SerdAsyncSink*)arg;
+
+	pthread_mutex_lock(&async->mutex);
+	while (async->head < async->tail || !async->exit) {
+		if (async->head == async->tail) {
+			pthread_cond_wait(&async->work_cond, &async->mutex);
+			continue;
+		}
+
+		// Write block without the lock, skipping output after any error
+		const AsyncBlock* block = &async->blocks[async->head % async->n_blocks];
+		const bool        ok    = !async->st;
+		pthread_mutex_unlock(&async->mutex);
+		const bool written = ok && (async->sink(block->buf, block->len,
+		                                        async->stream) == block->len);
+		pthread_mutex_lock(&async->mutex);
+		if (ok && !written) {
+			async->st = SERD_ERR_UNKNOWN;
+		}
+		++async->head;
+		pthread_cond_signal(&async->done_cond);
+	}
+	pthread_mutex_unlock(&async->mutex);
+	return NULL;
+}
+
+/** Hand the block being filled to the I/O thread and start a new one. */
+static SerdStatus
+submit_block(SerdAsyncSink* async)
+{
+	pthread_mutex_lock(&async->mutex);
+	++async->tail;
+	pthread_cond_signal(&async->work_cond);
+	while (async->tail - async->head == async->n_blocks) {
+		pthread_cond_wait(&async->done_cond, &async->mutex);
+	}
+	const SerdStatus st = async->st;
+	pthread_mutex_unlock(&async->mutex);
+
+	async->blocks[async->tail % async->n_blocks].len = 0;
+	return st;
+}
+#endif
+
+SERD_API
+SerdAsyncSink*
+serd_async_sink_new(size_t   block_size,
+                    size_t   n_blocks,
+                    SerdSink sink,
+                    void*    stream)
+{
+	SerdAsyncSink* async = (SerdAsyncSink*)calloc(
+		1, sizeof(struct SerdAsyncSinkImpl));
+	async->sink       = sink;
+	async->stream     = stream;
+	async->block_size = block_size ? block_size : SERD_PAGE_SIZE;
+	async->n_blocks   = (n_blocks < 2) ? 2 : n_blocks;
+
+#ifdef HAVE_PTHREAD
+	async->blocks = (AsyncBlock*)calloc(async->n_blocks, sizeof(AsyncBlock));
+	for (size_t i = 0; i < async->n_blocks; ++i) {
+		async->blocks[i].buf = (uint8_t*)serd_bufalloc(async->block_size);
+	}
+
+	pthread_mutex_init(&async->mutex, NULL);
+	pthread_cond_init(&async->work_cond, NULL);
+	pthread_cond_init(&async->done_cond, NULL);
+	async->threaded = !pthread_create(&async->thread, NULL, io_run, async);
+#endif
+
+	return async;
+}
+
+SERD_API
+size_t
+serd_async_sink_write(const void* buf, size_t len, void* stream)
+{
+	SerdAsyncSink* async = (SerdAsyncSink*)stream;
+#ifdef HAVE_PTHREAD
+	if (async->threaded) {
+		const uint8_t* in = (const uint8_t*)buf;
+		for (size_t n = len; n > 0;) {
+			AsyncBlock*  block = &async->blocks[async->tail % async->n_blocks];
+			const size_t space = async->block_size - block->len;
+			const size_t count = MIN(space, n);
+			memcpy(block->buf + block->len, in, count);
+			block->len += count;
+			in         += count;
+			n          -= count;
+			if (block->len == async->block_size && submit_block(async)) {
+				return 0;
+			}
+		}
+		return len;
+	}
+#endif
+
+	// Write synchronously if threads are unavailable
+	if (async->st) {
+		return 0;
+	} else if (async->sink(buf, len, async->stream) != len) {
+		async->st = SERD_ERR_UNKNOWN;
+		return 0;
+	}
+	return len;
+}
+
+SERD_API
+SerdStatus
+serd_async_sink_flush(SerdAsyncSink* async)
+{
+#ifdef HAVE_PTHREAD
+	if (async->threaded) {
+		if (async->blocks[async->tail % async->n_blocks].len) {
+			submit_block(async);
+		}
+
+		pthread_mutex_lock(&async->mutex);
+		while (async->head < async->tail) {
+			pthread_cond_wait(&async->done_cond, &async->mutex);
+		}
+		const SerdStatus st = async->st;
+		pthread_mutex_unlock(&async->mutex);
+		return st;
+	}
+#endif
+	return async->st;
+}
+
+SERD_API
+void
+serd_async_sink_free(SerdAsyncSink* async)
+{
+	if (!async) {
+		return;
+	}
+
+	serd_async_sink_flush(async);
+
+#ifdef HAVE_PTHREAD
+	if (async->threaded) {
+		pthread_mutex_lock(&async->mutex);
+		async->exit = true;
+		pthread_cond_signal(&async->work_cond);
+		pthread_mutex_unlock(&async->mutex);
+		pthread_join(async->thread, NULL);
+	}
+	pthread_cond_destroy(&async->done_cond);
+	pthread_cond_destroy(&async->work_cond);
+	pthread_mutex_destroy(&async->mutex);
+	for (size_t i = 0; i < async->n_blocks; ++i) {
+		free(async->blocks[i].buf);
+	}
+	free(async->blocks);
+#endif
+
+	free(async);
+}
@@ -0,0 +1,410 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of 3-byte groups per line, for 76 character lines (RFC 2045). */
+#define B64_LINE_GROUPS 19
+
+/** Number of groups encoded or decoded at once by the streaming objects. */
+#define B64_SLICE_GROUPS 1024
+
+/** Size of encoder output buffer, with space for a slice and newlines. */
+#define B64_ENCODE_BUF_SIZE (4 * (B64_SLICE_GROUPS + 1) + 64)
+
+/** Value of '=' in b64_values. */
+#define B64_PAD 0x40
+
+/** Value of characters not in the base64 alphabet in b64_values. */
+#define B64_JUNK 0x80
+
+/**
+   Base64 encoding table.
+   @see <a href="http://tools.ietf.org/html/rfc3548#section-3">RFC3986 S3</a>.
+*/
+static const uint8_t b64_map[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+   Base64 decoding table.
+
+   This maps characters to their 6-bit value, B64_PAD for '=', or B64_JUNK
+   for characters that are not in the base64 alphabet (which are skipped).
+*/
+static const uint8_t b64_values[256] = {
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x3E, 0x80, 0x80, 0x80, 0x3F,  // '+', '/'
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,  // '0'...'7'
+	0x3C, 0x3D, 0x80, 0x80, 0x80, 0x40, 0x80, 0x80,  // '8', '9', '='
+	0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,  // 'A'...'G'
+	0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+	0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,  // ...'Z'
+	0x80, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20,  // 'a'...'g'
+	0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+	0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,  // ...'z'
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+/**
+   Encode `n_groups` groups of 3 bytes from `in` to `out`.
+
+   If `wrap` is true, a newline is written before a group when `*col` (the
+   number of groups on the current line) reaches the line length.
+
+   @return The end of the output.
+*/
+static uint8_t*
+encode_groups(uint8_t*       out,
+              const uint8_t* in,
+              size_t         n_groups,
+              bool           wrap,
+              unsigned*      col)
+{
+	while (n_groups) {
+		if (wrap && *col == B64_LINE_GROUPS) {
+			*out++ = '\n';
+			*col   = 0;
+		}
+
+		const size_t n = wrap ? MIN(n_groups, B64_LINE_GROUPS - *col) : n_groups;
+		for (size_t i = 0; i < n; ++i, in += 3, out += 4) {
+			const uint32_t w = ((uint32_t)in[0] << 16) |
+			                   ((uint32_t)in[1] << 8) | in[2];
+			out[0] = b64_map[w >> 18];
+			out[1] = b64_map[(w >> 12) & 0x3F];
+			out[2] = b64_map[(w >> 6) & 0x3F];
+			out[3] = b64_map[w & 0x3F];
+		}
+		n_groups -= n;
+		*col     += (unsigned)n;
+	}
+	return out;
+}
+
+/** Encode a final group of 1 or 2 bytes with padding. */
+static uint8_t*
+encode_tail(uint8_t* out, const uint8_t* in, size_t n_in, bool wrap,
+            unsigned* col)
+{
+	if (wrap && *col == B64_LINE_GROUPS) {
+		*out++ = '\n';
+		*col   = 0;
+	}
+
+	const uint32_t w = ((uint32_t)in[0] << 16) |
+	                   ((n_in > 1) ? ((uint32_t)in[1] << 8) : 0);
+	out[0] = b64_map[w >> 18];
+	out[1] = b64_map[(w >> 12) & 0x3F];
+	out[2] = (n_in > 1) ? b64_map[(w >> 6) & 0x3F] : (uint8_t)'=';
+	out[3] = '=';
+	++*col;
+	return out + 4;
+}
+
+/** Decode a group of 4 characters which may contain padding. */
+static size_t
+decode_group(const uint8_t in[4], uint8_t out[3])
+{
+	const uint32_t w = ((uint32_t)(b64_values[in[0]] & 0x3F) << 18) |
+	                   ((uint32_t)(b64_values[in[1]] & 0x3F) << 12) |
+	                   ((uint32_t)(b64_values[in[2]] & 0x3F) << 6) |
+	                   (uint32_t)(b64_values[in[3]] & 0x3F);
+	out[0] = (uint8_t)(w >> 16);
+	out[1] = (uint8_t)(w >> 8);
+	out[2] = (uint8_t)w;
+	return 1 + (in[2] != '=') + ((in[2] != '=') && (in[3] != '='));
+}
+
+/**
+   Decode `len` characters of `str` to `out`, skipping junk.
+
+   Characters left over after the last complete group are stored in `group`,
+   and `*n_group` is set to their count.  This allows decoding in chunks,
+   where `group` is completed by the start of the next chunk.
+
+   @return The number of bytes written to `out`.
+*/
+static size_t
+decode_chars(const uint8_t* str,
+             size_t         len,
+             uint8_t        group[4],
+             unsigned*      n_group,
+             uint8_t*       out)
+{
+	uint8_t* o = out;
+	for (size_t i = 0; i < len;) {
+		if (!*n_group) {
+			// Fast path for groups of 4 characters with no junk or padding
+			for (; i + 4 <= len; i += 4, o += 3) {
+				const uint8_t a = b64_values[str[i]];
+				const uint8_t b = b64_values[str[i + 1]];
+				const uint8_t c = b64_values[str[i + 2]];
+				const uint8_t d = b64_values[str[i + 3]];
+				if ((a | b | c | d) & (B64_PAD | B64_JUNK)) {
+					break;
+				}
+
+				const uint32_t w = ((uint32_t)a << 18) | ((uint32_t)b << 12) |
+				                   ((uint32_t)c << 6) | d;
+				o[0] = (uint8_t)(w >> 16);
+				o[1] = (uint8_t)(w >> 8);
+				o[2] = (uint8_t)w;
+			}
+			if (i == len) {
+				break;
+			}
+		}
+
+		// Slow path, one character at a time
+		const uint8_t c = str[i++];
+		if (!(b64_values[c] & B64_JUNK)) {
+			group[(*n_group)++] = c;
+			if (*n_group == 4) {
+				o        += decode_group(group, o);
+				*n_group  = 0;
+			}
+		}
+	}
+	return (size_t)(o - out);
+}
+
+/** Decode an incomplete final group, where missing characters are padding. */
+static size_t
+decode_tail(uint8_t group[4], unsigned n_group, uint8_t* out)
+{
+	if (n_group > 1) {
+		for (unsigned i = n_group; i < 4; ++i) {
+			group[i] = '=';
+		}
+		return decode_group(group, out);
+	}
+	return 0;
+}
+
+SERD_API
+SerdNode
+serd_node_new_blob(const void* buf, size_t size, bool wrap_lines)
+{
+	return serd_node_new_blob_with_allocator(NULL, buf, size, wrap_lines);
+}
+
+SERD_API
+SerdNode
+serd_node_new_blob_with_allocator(const SerdAllocator* allocator,
+                                  const void*          buf,
+                                  size_t               size,
+                                  bool                 wrap_lines)
+{
+	const size_t   n_groups = size / 3;
+	const size_t   n_lines  = (wrap_lines && size) ? (size - 1) / 57 : 0;
+	const size_t   len      = ((size + 2) / 3) * 4 + n_lines;
+	uint8_t*       str      = (uint8_t*)serd_malloc(allocator, len + 1);
+	const uint8_t* in       = (const uint8_t*)buf;
+	unsigned       col      = 0;
+
+	uint8_t* out = encode_groups(str, in, n_groups, wrap_lines, &col);
+	if (size % 3) {
+		out = encode_tail(out, in + n_groups * 3, size % 3, wrap_lines, &col);
+	}
+	*out = '\0';
+
+	SerdNode node = { str, len, len, n_lines ? SERD_HAS_NEWLINE : 0,
+	                  SERD_LITERAL };
+	return node;
+}
+
+SERD_API
+void*
+serd_base64_decode(const uint8_t* str, size_t len, size_t* size)
+{
+	uint8_t* buf     = (uint8_t*)malloc((len * 3) / 4 + 3);
+	uint8_t  group[4];
+	unsigned n_group = 0;
+
+	*size  = decode_chars(str, len, group, &n_group, buf);
+	*size += decode_tail(group, n_group, buf + *size);
+	return buf;
+}
+
+struct SerdBase64EncoderImpl {
+	SerdSink   sink;
+	void*      stream;
+	bool       wrap_lines;
+	unsigned   col;         ///< Number of groups on the current line
+	uint8_t    pending[3];  ///< Input bytes not yet encoded
+	unsigned   n_pending;
+	SerdStatus st;
+	uint8_t    buf[B64_ENCODE_BUF_SIZE];
+};
+
+struct SerdBase64DecoderImpl {
+	SerdSink   sink;
+	void*      stream;
+	uint8_t    group[4];  ///< Characters of the current incomplete group
+	unsigned   n_group;
+	SerdStatus st;
+	uint8_t    buf[3 * B64_SLICE_GROUPS + 3];
+};
+
+/** Write `len` bytes of output to `sink`, recording any error in `st`. */
+static SerdStatus
+flush_output(SerdSink sink, void* stream, const uint8_t* buf, size_t len,
+             SerdStatus* st)
+{
+	if (!*st && len && sink(buf, len, stream) != len) {
+		*st = SERD_ERR_UNKNOWN;
+	}
+	return *st;
+}
+
+SERD_API
+SerdBase64Encoder*
+serd_base64_encoder_new(bool wrap_lines, SerdSink sink, void* stream)
+{
+	SerdBase64Encoder* enc = (SerdBase64Encoder*)calloc(
+		1, sizeof(struct SerdBase64EncoderImpl));
+	enc->sink       = sink;
+	enc->stream     = stream;
+	enc->wrap_lines = wrap_lines;
+	return enc;
+}
+
+SERD_API
+SerdStatus
+serd_base64_encoder_write(SerdBase64Encoder* enc, const void* buf, size_t size)
+{
+	const uint8_t* in  = (const uint8_t*)buf;
+	uint8_t*       out = enc->buf;
+	if (enc->n_pending) {
+		// Complete the group left over from the previous write
+		for (; enc->n_pending < 3 && size; --size) {
+			enc->pending[enc->n_pending++] = *in++;
+		}
+		if (enc->n_pending < 3) {
+			return enc->st;
+		}
+		out = encode_groups(out, enc->pending, 1, enc->wrap_lines, &enc->col);
+		enc->n_pending = 0;
+	}
+
+	// Encode the input in slices, writing the output of each to the sink
+	while (size >= 3) {
+		const size_t n_groups = MIN(size / 3, B64_SLICE_GROUPS);
+		out = encode_groups(out, in, n_groups, enc->wrap_lines, &enc->col);
+		in   += n_groups * 3;
+		size -= n_groups * 3;
+		flush_output(enc->sink, enc->stream, enc->buf,
+		             (size_t)(out - enc->buf), &enc->st);
+		out = enc->buf;
+	}
+	flush_output(enc->sink, enc->stream, enc->buf,
+	             (size_t)(out - enc->buf), &enc->st);
+
+	// Keep any remainder for the next write
+	memcpy(enc->pending, in, size);
+	enc->n_pending = (unsigned)size;
+	return enc->st;
+}
+
+SERD_API
+SerdStatus
+serd_base64_encoder_finish(SerdBase64Encoder* enc)
+{
+	if (enc->n_pending) {
+		const uint8_t* end = encode_tail(enc->buf, enc->pending, enc->n_pending,
+		                                 enc->wrap_lines, &enc->col);
+		enc->n_pending = 0;
+		flush_output(enc->sink, enc->stream, enc->buf,
+		             (size_t)(end - enc->buf), &enc->st);
+	}
+	return enc->st;
+}
+
+SERD_API
+void
+serd_base64_encoder_free(SerdBase64Encoder* enc)
+{
+	free(enc);
+}
+
+SERD_API
+SerdBase64Decoder*
+serd_base64_decoder_new(SerdSink sink, void* stream)
+{
+	SerdBase64Decoder* dec = (SerdBase64Decoder*)calloc(
+		1, sizeof(struct SerdBase64DecoderImpl));
+	dec->sink   = sink;
+	dec->stream = stream;
+	return dec;
+}
+
+SERD_API
+SerdStatus
+serd_base64_decoder_write(SerdBase64Decoder* dec,
+                          const uint8_t*     str,
+                          size_t             len)
+{
+	// Decode in slices small enough for the output buffer
+	while (len) {
+		const size_t n    = MIN(len, 4 * B64_SLICE_GROUPS);
+		const size_t size = decode_chars(
+			str, n, dec->group, &dec->n_group, dec->buf);
+		flush_output(dec->sink, dec->stream, dec->buf, size, &dec->st);
+		str += n;
+		len -= n;
+	}
+	return dec->st;
+}
+
+SERD_API
+SerdStatus
+serd_base64_decoder_finish(SerdBase64Decoder* dec)
+{
+	const size_t size = decode_tail(dec->group, dec->n_group, dec->buf);
+	dec->n_group = 0;
+	return flush_output(dec->sink, dec->stream, dec->buf, size, &dec->st);
+}
+
+SERD_API
+void
+serd_base64_decoder_free(SerdBase64Decoder* dec)
+{
+	free(dec);
+}
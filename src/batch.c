@@ -0,0 +1,367 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "job_ring.h"
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Statement flag (outside the range of SerdStatementFlag) for end_anon. */
+#define BATCH_END_ANON (1U << 31)
+
+typedef enum {
+	BATCH_GRAPH,
+	BATCH_SUBJECT,
+	BATCH_PREDICATE,
+	BATCH_OBJECT,
+	BATCH_DATATYPE,
+	BATCH_LANG,
+	BATCH_N_NODES
+} BatchField;
+
+/** A node with its string stored at an offset in the batch text stack. */
+typedef struct {
+	size_t        offset;
+	size_t        n_bytes;
+	size_t        n_chars;
+	SerdNodeFlags flags;
+	SerdType      type;
+} BatchNode;
+
+typedef struct {
+	SerdStatementFlags flags;  ///< Statement flags, or BATCH_END_ANON
+	BatchNode          nodes[BATCH_N_NODES];
+} BatchEvent;
+
+struct SerdBatchImpl {
+	SerdStack events;  ///< Stack of BatchEvent
+	SerdStack text;    ///< Node strings, each null terminated
+};
+
+typedef struct {
+	SerdBatch  batch;  ///< Statements to write (owned, swapped with caller)
+	SerdChunk  out;    ///< Formatted output
+	SerdStatus st;     ///< Status of formatting
+} BatchSlot;
+
+struct SerdBatchWriterImpl {
+	SerdSyntax  syntax;
+	SerdStyle   style;
+	SerdEnv*    env;
+	SerdURI     base_uri;
+	SerdSink    sink;
+	void*       stream;
+	BatchSlot*  slots;
+	size_t      n_slots;
+	SerdJobRing ring;     ///< Formats slots and writes them in order
+	bool        started;  ///< True iff any output has been written
+	SerdStatus  st;
+};
+
+static void
+batch_init(SerdBatch* batch)
+{
+	batch->events = serd_stack_new(NULL, SERD_PAGE_SIZE);
+	batch->text   = serd_stack_new(NULL, SERD_PAGE_SIZE);
+}
+
+SERD_API
+SerdBatch*
+serd_batch_new(void)
+{
+	SerdBatch* batch = (SerdBatch*)malloc(sizeof(struct SerdBatchImpl));
+	batch_init(batch);
+	return batch;
+}
+
+static void
+batch_destroy(SerdBatch* batch)
+{
+	serd_stack_free(&batch->events);
+	serd_stack_free(&batch->text);
+}
+
+SERD_API
+void
+serd_batch_free(SerdBatch* batch)
+{
+	if (batch) {
+		batch_destroy(batch);
+		free(batch);
+	}
+}
+
+SERD_API
+void
+serd_batch_clear(SerdBatch* batch)
+{
+	batch->events.size = SERD_STACK_BOTTOM;
+	batch->text.size   = SERD_STACK_BOTTOM;
+}
+
+SERD_API
+size_t
+serd_batch_size(const SerdBatch* batch)
+{
+	return (batch->events.size - SERD_STACK_BOTTOM) / sizeof(BatchEvent);
+}
+
+static void
+batch_add_node(SerdBatch* batch, BatchNode* dst, const SerdNode* node)
+{
+	if (!node || !node->buf) {
+		dst->type = SERD_NOTHING;
+		return;
+	}
+
+	dst->offset  = batch->text.size;
+	dst->n_bytes = node->n_bytes;
+	dst->n_chars = node->n_chars;
+	dst->flags   = node->flags;
+	dst->type    = node->type;
+
+	uint8_t* buf = serd_stack_push(&batch->text, node->n_bytes + 1);
+	memcpy(buf, node->buf, node->n_bytes);
+	buf[node->n_bytes] = '\0';
+}
+
+static BatchEvent*
+batch_add_event(SerdBatch* batch, SerdStatementFlags flags)
+{
+	BatchEvent* event = (BatchEvent*)serd_stack_push(
+		&batch->events, sizeof(BatchEvent));
+	event->flags = flags;
+	return event;
+}
+
+SERD_API
+SerdStatus
+serd_batch_add_statement(SerdBatch*         batch,
+                         SerdStatementFlags flags,
+                         const SerdNode*    graph,
+                         const SerdNode*    subject,
+                         const SerdNode*    predicate,
+                         const SerdNode*    object,
+                         const SerdNode*    object_datatype,
+                         const SerdNode*    object_lang)
+{
+	if (!subject || !predicate || !object
+	    || !subject->buf || !predicate->buf || !object->buf) {
+		return SERD_ERR_BAD_ARG;
+	}
+
+	BatchEvent* event = batch_add_event(batch, flags);
+	batch_add_node(batch, &event->nodes[BATCH_GRAPH], graph);
+	batch_add_node(batch, &event->nodes[BATCH_SUBJECT], subject);
+	batch_add_node(batch, &event->nodes[BATCH_PREDICATE], predicate);
+	batch_add_node(batch, &event->nodes[BATCH_OBJECT], object);
+	batch_add_node(batch, &event->nodes[BATCH_DATATYPE], object_datatype);
+	batch_add_node(batch, &event->nodes[BATCH_LANG], object_lang);
+	return SERD_SUCCESS;
+}
+
+SERD_API
+SerdStatus
+serd_batch_end_anon(SerdBatch* batch, const SerdNode* node)
+{
+	if (!node || !node->buf) {
+		return SERD_ERR_BAD_ARG;
+	}
+
+	BatchEvent* event = batch_add_event(batch, BATCH_END_ANON);
+	for (unsigned i = 0; i < BATCH_N_NODES; ++i) {
+		event->nodes[i].type = SERD_NOTHING;
+	}
+	batch_add_node(batch, &event->nodes[BATCH_SUBJECT], node);
+	return SERD_SUCCESS;
+}
+
+static inline SerdNode
+batch_node(const SerdBatch* batch, const BatchNode* node)
+{
+	if (!node->type) {
+		return SERD_NODE_NULL;
+	}
+	const SerdNode ret = { batch->text.buf + node->offset,
+	                       node->n_bytes,
+	                       node->n_chars,
+	                       node->flags,
+	                       node->type };
+	return ret;
+}
+
+/** Format the statements in `slot` into its output chunk. */
+static void
+format_slot(void* handle, void* ptr)
+{
+	SerdBatchWriter* const bw   = (SerdBatchWriter*)handle;
+	BatchSlot* const       slot = (BatchSlot*)ptr;
+
+	SerdWriter* writer = serd_writer_new(bw->syntax, bw->style, bw->env,
+	                                     &bw->base_uri, serd_chunk_sink,
+	                                     &slot->out);
+
+	SerdStatus st = SERD_SUCCESS;
+	for (size_t i = SERD_STACK_BOTTOM; !st && i < slot->batch.events.size;
+	     i += sizeof(BatchEvent)) {
+		const BatchEvent* event = (const BatchEvent*)(
+			slot->batch.events.buf + i);
+
+		SerdNode nodes[BATCH_N_NODES];
+		for (unsigned n = 0; n < BATCH_N_NODES; ++n) {
+			nodes[n] = batch_node(&slot->batch, &event->nodes[n]);
+		}
+
+		if (event->flags == BATCH_END_ANON) {
+			st = serd_writer_end_anon(writer, &nodes[BATCH_SUBJECT]);
+		} else {
+			st = serd_writer_write_statement(
+				writer, event->flags,
+				&nodes[BATCH_GRAPH], &nodes[BATCH_SUBJECT],
+				&nodes[BATCH_PREDICATE], &nodes[BATCH_OBJECT],
+				&nodes[BATCH_DATATYPE], &nodes[BATCH_LANG]);
+		}
+	}
+
+	serd_writer_free(writer);
+	slot->st = st;
+}
+
+/** Write the output of `slot` to the sink and make it available for reuse. */
+static void
+emit_slot(void* handle, void* ptr)
+{
+	SerdBatchWriter* const bw   = (SerdBatchWriter*)handle;
+	BatchSlot* const       slot = (BatchSlot*)ptr;
+
+	if (slot->out.len) {
+		if (bw->started && bw->syntax == SERD_TURTLE) {
+			bw->sink("\n", 1, bw->stream);  // Blank line between subjects
+		}
+		bw->sink(slot->out.buf, slot->out.len, bw->stream);
+		bw->started = true;
+	}
+	if (slot->st && !bw->st) {
+		bw->st = slot->st;
+	}
+
+	free((uint8_t*)slot->out.buf);
+	slot->out.buf = NULL;
+	slot->out.len = 0;
+	slot->st      = SERD_SUCCESS;
+}
+
+/** Write base and prefix directives for `env` to the sink. */
+static void
+write_directives(SerdBatchWriter* bw)
+{
+	if (bw->syntax == SERD_NTRIPLES) {
+		return;
+	}
+
+	SerdChunk       chunk  = { NULL, 0 };
+	SerdURI         ignored;
+	const SerdNode* base   = serd_env_get_base_uri(bw->env, &ignored);
+	SerdEnv*        env    = serd_env_new(NULL);
+	SerdWriter*     writer = serd_writer_new(
+		bw->syntax, bw->style, env, NULL, serd_chunk_sink, &chunk);
+
+	if (base && base->buf) {
+		serd_writer_set_base_uri(writer, base);
+	}
+	serd_env_foreach(bw->env, (SerdPrefixSink)serd_writer_set_prefix, writer);
+	serd_writer_free(writer);
+	serd_env_free(env);
+
+	if (chunk.len) {
+		bw->sink(chunk.buf, chunk.len, bw->stream);
+		bw->started = true;
+	}
+	free((uint8_t*)chunk.buf);
+}
+
+SERD_API
+SerdBatchWriter*
+serd_batch_writer_new(SerdSyntax     syntax,
+                      SerdStyle      style,
+                      SerdEnv*       env,
+                      const SerdURI* base_uri,
+                      SerdSink       ssink,
+                      void*          stream,
+                      unsigned       n_threads)
+{
+	SerdBatchWriter* bw = (SerdBatchWriter*)calloc(
+		1, sizeof(struct SerdBatchWriterImpl));
+	bw->syntax   = syntax;
+	bw->style    = style;
+	bw->env      = env;
+	bw->base_uri = base_uri ? *base_uri : SERD_URI_NULL;
+	bw->sink     = ssink;
+	bw->stream   = stream;
+	bw->n_slots  = n_threads > 1 ? 2 * n_threads : 1;
+	bw->slots    = (BatchSlot*)calloc(bw->n_slots, sizeof(BatchSlot));
+	for (size_t i = 0; i < bw->n_slots; ++i) {
+		batch_init(&bw->slots[i].batch);
+	}
+
+	write_directives(bw);
+	serd_job_ring_init(&bw->ring, bw, format_slot, emit_slot,
+	                   bw->slots, sizeof(BatchSlot), bw->n_slots, n_threads);
+
+	return bw;
+}
+
+SERD_API
+SerdStatus
+serd_batch_writer_write(SerdBatchWriter* bw, SerdBatch* batch)
+{
+	if (!serd_batch_size(batch)) {
+		return bw->st;
+	}
+
+	// Swap batch into the free slot, leaving the caller an empty batch
+	BatchSlot* const slot = (BatchSlot*)serd_job_ring_tail(&bw->ring);
+	const SerdBatch  tmp  = slot->batch;
+	slot->batch = *batch;
+	*batch      = tmp;
+	serd_batch_clear(batch);
+
+	serd_job_ring_submit(&bw->ring);
+	return bw->st;
+}
+
+SERD_API
+SerdStatus
+serd_batch_writer_finish(SerdBatchWriter* bw)
+{
+	serd_job_ring_finish(&bw->ring);
+	return bw->st;
+}
+
+SERD_API
+void
+serd_batch_writer_free(SerdBatchWriter* bw)
+{
+	serd_batch_writer_finish(bw);
+	serd_job_ring_destroy(&bw->ring);
+
+	for (size_t i = 0; i < bw->n_slots; ++i) {
+		batch_destroy(&bw->slots[i].batch);
+	}
+	free(bw->slots);
+	free(bw);
+}
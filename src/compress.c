@@ -0,0 +1,368 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "job_ring.h"
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#    include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#    include <zstd.h>
+#endif
+
+/** Size of independently compressed blocks in parallel mode. */
+#define COMPRESS_BLOCK_SIZE (128 * 1024)
+
+/** Size of output buffer in streaming mode. */
+#define COMPRESS_OUT_SIZE (64 * 1024)
+
+typedef struct {
+	uint8_t*   in;       ///< Uncompressed input, COMPRESS_BLOCK_SIZE bytes
+	size_t     in_len;
+	uint8_t*   out;      ///< Compressed output
+	size_t     out_len;
+	size_t     out_size;
+	SerdStatus st;
+} CompressSlot;
+
+struct SerdCompressorImpl {
+	SerdCompression format;
+	int             level;
+	SerdSink        sink;
+	void*           stream;
+	uint8_t*        out;  ///< Output buffer in streaming mode
+#ifdef HAVE_ZLIB
+	z_stream        zs;
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD_CStream*   zcs;
+#endif
+	CompressSlot*   slots;  ///< Blocks in parallel mode, or NULL
+	size_t          n_slots;
+	SerdJobRing     ring;   ///< Compresses slots and writes them in order
+	SerdStatus      st;
+};
+
+SERD_API
+bool
+serd_compression_supported(SerdCompression format)
+{
+	switch (format) {
+	case SERD_GZIP:
+#ifdef HAVE_ZLIB
+		return true;
+#else
+		return false;
+#endif
+	case SERD_ZSTD:
+#ifdef HAVE_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+/** Write `len` bytes to the output sink, returning false on error. */
+static bool
+write_out(SerdCompressor* comp, const uint8_t* buf, size_t len)
+{
+	if (len && comp->sink(buf, len, comp->stream) != len) {
+		comp->st = SERD_ERR_UNKNOWN;
+	}
+	return !comp->st;
+}
+
+/** Compress `slot` into a complete, independent gzip member or zstd frame. */
+static void
+compress_slot(void* handle, void* ptr)
+{
+	const SerdCompressor* const comp = (const SerdCompressor*)handle;
+	CompressSlot* const         slot = (CompressSlot*)ptr;
+
+	slot->st      = SERD_ERR_UNKNOWN;
+	slot->out_len = 0;
+	switch (comp->format) {
+	case SERD_GZIP: {
+#ifdef HAVE_ZLIB
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		if (deflateInit2(&zs, comp->level, Z_DEFLATED, 15 + 16, 8,
+		                 Z_DEFAULT_STRATEGY) != Z_OK) {
+			break;
+		}
+		const size_t bound = deflateBound(&zs, (uLong)slot->in_len);
+		if (slot->out_size < bound) {
+			slot->out_size = bound;
+			slot->out      = (uint8_t*)realloc(slot->out, bound);
+		}
+		zs.next_in   = slot->in;
+		zs.avail_in  = (uInt)slot->in_len;
+		zs.next_out  = slot->out;
+		zs.avail_out = (uInt)slot->out_size;
+		if (deflate(&zs, Z_FINISH) == Z_STREAM_END) {
+			slot->out_len = slot->out_size - zs.avail_out;
+			slot->st      = SERD_SUCCESS;
+		}
+		deflateEnd(&zs);
+#endif
+		break;
+	}
+	case SERD_ZSTD: {
+#ifdef HAVE_ZSTD
+		const size_t bound = ZSTD_compressBound(slot->in_len);
+		if (slot->out_size < bound) {
+			slot->out_size = bound;
+			slot->out      = (uint8_t*)realloc(slot->out, bound);
+		}
+		const size_t len = ZSTD_compress(slot->out, slot->out_size,
+		                                 slot->in, slot->in_len, comp->level);
+		if (!ZSTD_isError(len)) {
+			slot->out_len = len;
+			slot->st      = SERD_SUCCESS;
+		}
+#endif
+		break;
+	}
+	}
+}
+
+/** Write the output of `slot` to the sink and make it available for reuse. */
+static void
+emit_slot(void* handle, void* ptr)
+{
+	SerdCompressor* const comp = (SerdCompressor*)handle;
+	CompressSlot* const   slot = (CompressSlot*)ptr;
+
+	if (slot->st) {
+		comp->st = slot->st;
+	} else {
+		write_out(comp, slot->out, slot->out_len);
+	}
+	slot->in_len  = 0;
+	slot->out_len = 0;
+}
+
+static bool
+start_stream(SerdCompressor* comp)
+{
+	switch (comp->format) {
+	case SERD_GZIP:
+#ifdef HAVE_ZLIB
+		return deflateInit2(&comp->zs, comp->level, Z_DEFLATED, 15 + 16, 8,
+		                    Z_DEFAULT_STRATEGY) == Z_OK;
+#else
+		break;
+#endif
+	case SERD_ZSTD:
+#ifdef HAVE_ZSTD
+		if ((comp->zcs = ZSTD_createCStream())) {
+			ZSTD_CCtx_setParameter(
+				comp->zcs, ZSTD_c_compressionLevel, comp->level);
+			return true;
+		}
+#endif
+		break;
+	}
+	return false;
+}
+
+/** Compress `len` bytes in streaming mode, flushing at the end if `end`. */
+static void
+stream_compress(SerdCompressor* comp, const void* buf, size_t len, bool end)
+{
+	switch (comp->format) {
+	case SERD_GZIP: {
+#ifdef HAVE_ZLIB
+		comp->zs.next_in  = (Bytef*)buf;
+		comp->zs.avail_in = (uInt)len;
+		int ret = Z_OK;
+		do {
+			comp->zs.next_out  = comp->out;
+			comp->zs.avail_out = COMPRESS_OUT_SIZE;
+			ret = deflate(&comp->zs, end ? Z_FINISH : Z_NO_FLUSH);
+			if (ret == Z_STREAM_ERROR) {
+				comp->st = SERD_ERR_UNKNOWN;
+				return;
+			}
+			write_out(comp, comp->out,
+			          COMPRESS_OUT_SIZE - comp->zs.avail_out);
+		} while (!comp->st && (comp->zs.avail_in || !comp->zs.avail_out ||
+		                       (end && ret != Z_STREAM_END)));
+#endif
+		break;
+	}
+	case SERD_ZSTD: {
+#ifdef HAVE_ZSTD
+		ZSTD_inBuffer in        = { buf, len, 0 };
+		size_t        remaining = 0;
+		do {
+			ZSTD_outBuffer out = { comp->out, COMPRESS_OUT_SIZE, 0 };
+			remaining = ZSTD_compressStream2(
+				comp->zcs, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+			if (ZSTD_isError(remaining)) {
+				comp->st = SERD_ERR_UNKNOWN;
+				return;
+			}
+			write_out(comp, comp->out, out.pos);
+		} while (!comp->st && (in.pos < in.size || (end && remaining)));
+#endif
+		break;
+	}
+	}
+}
+
+SERD_API
+SerdCompressor*
+serd_compressor_new(SerdCompression format,
+                    int             level,
+                    unsigned        n_threads,
+                    SerdSink        sink,
+                    void*           stream)
+{
+	if (!serd_compression_supported(format)) {
+		return NULL;
+	}
+
+	SerdCompressor* comp = (SerdCompressor*)calloc(
+		1, sizeof(struct SerdCompressorImpl));
+	comp->format = format;
+	comp->level  = level;
+	comp->sink   = sink;
+	comp->stream = stream;
+	if (!level) {
+#ifdef HAVE_ZLIB
+		comp->level = (format == SERD_GZIP) ? Z_DEFAULT_COMPRESSION : 0;
+#endif
+#ifdef HAVE_ZSTD
+		comp->level = (format == SERD_ZSTD) ? ZSTD_CLEVEL_DEFAULT : comp->level;
+#endif
+	}
+
+#ifdef HAVE_PTHREAD
+	if (n_threads > 1) {
+		comp->n_slots = 2 * n_threads;
+		comp->slots   = (CompressSlot*)calloc(comp->n_slots,
+		                                      sizeof(CompressSlot));
+		for (size_t i = 0; i < comp->n_slots; ++i) {
+			comp->slots[i].in = (uint8_t*)malloc(COMPRESS_BLOCK_SIZE);
+		}
+
+		serd_job_ring_init(&comp->ring, comp, compress_slot, emit_slot,
+		                   comp->slots, sizeof(CompressSlot), comp->n_slots,
+		                   n_threads);
+		return comp;
+	}
+#endif
+
+	// Compress as a single stream on the calling thread
+	(void)n_threads;
+	comp->out = (uint8_t*)malloc(COMPRESS_OUT_SIZE);
+	if (!start_stream(comp)) {
+		free(comp->out);
+		free(comp);
+		return NULL;
+	}
+	return comp;
+}
+
+SERD_API
+size_t
+serd_compressor_sink(const void* buf, size_t len, void* stream)
+{
+	SerdCompressor* comp = (SerdCompressor*)stream;
+	if (comp->st) {
+		return 0;
+	} else if (!comp->slots) {
+		stream_compress(comp, buf, len, false);
+		return comp->st ? 0 : len;
+	}
+
+	// Copy input into blocks, submitting each as it is filled
+	const uint8_t* in = (const uint8_t*)buf;
+	for (size_t n = len; n > 0;) {
+		CompressSlot* slot  = (CompressSlot*)serd_job_ring_tail(&comp->ring);
+		const size_t  space = COMPRESS_BLOCK_SIZE - slot->in_len;
+		const size_t  count = MIN(space, n);
+		memcpy(slot->in + slot->in_len, in, count);
+		slot->in_len += count;
+		in           += count;
+		n            -= count;
+		if (slot->in_len == COMPRESS_BLOCK_SIZE) {
+			serd_job_ring_submit(&comp->ring);
+		}
+	}
+	return comp->st ? 0 : len;
+}
+
+SERD_API
+SerdStatus
+serd_compressor_finish(SerdCompressor* comp)
+{
+	if (!comp->slots) {
+		if (!comp->st) {
+			stream_compress(comp, NULL, 0, true);
+		}
+		return comp->st;
+	}
+
+	if (((CompressSlot*)serd_job_ring_tail(&comp->ring))->in_len) {
+		serd_job_ring_submit(&comp->ring);
+	}
+	serd_job_ring_finish(&comp->ring);
+	return comp->st;
+}
+
+SERD_API
+void
+serd_compressor_free(SerdCompressor* comp)
+{
+	if (!comp) {
+		return;
+	}
+
+	if (comp->slots) {
+		serd_job_ring_destroy(&comp->ring);
+	}
+
+	for (size_t i = 0; i < comp->n_slots; ++i) {
+		free(comp->slots[i].in);
+		free(comp->slots[i].out);
+	}
+	free(comp->slots);
+
+	if (comp->out) {
+		switch (comp->format) {
+		case SERD_GZIP:
+#ifdef HAVE_ZLIB
+			deflateEnd(&comp->zs);
+#endif
+			break;
+		case SERD_ZSTD:
+#ifdef HAVE_ZSTD
+			ZSTD_freeCStream(comp->zcs);
+#endif
+			break;
+		}
+		free(comp->out);
+	}
+	free(comp);
+}
@@ -24,19 +24,53 @@ typedef struct {
 	SerdNode uri;
 } SerdPrefix;
 
+/* Prefixes are indexed by two open addressing hash tables of the same size,
+   one keyed by name and one by URI.  Each slot holds a prefix index plus 1,
+   or 0 if empty.  The URI table is used to find namespaces which are a
+   prefix of a URI, by hashing the URI incrementally and looking up each
+   length that some namespace URI has.
+*/
+
 struct SerdEnvImpl {
-	SerdPrefix* prefixes;
-	size_t      n_prefixes;
-	SerdNode    base_uri_node;
-	SerdURI     base_uri;
+	const SerdAllocator* allocator;
+	SerdPrefix*          prefixes;
+	size_t               n_prefixes;
+	size_t               prefixes_size;  ///< Allocated size of prefixes
+	size_t*              names;          ///< Hash table of prefixes by name
+	size_t*              uris;           ///< Hash table of prefixes by URI
+	size_t               n_slots;        ///< Size of hash tables (a power of 2)
+	size_t*              uri_lens;       ///< Sorted distinct prefix URI lengths
+	size_t               n_uri_lens;
+	SerdNode             base_uri_node;
+	SerdURI              base_uri;
 };
 
+static inline uint64_t
+hash_string(const uint8_t* buf, size_t len)
+{
+	return serd_hash_finish(serd_hash_bytes(SERD_HASH_SEED, buf, len));
+}
+
 SERD_API
 SerdEnv*
 serd_env_new(const SerdNode* base_uri)
 {
-	SerdEnv* env = (SerdEnv*)calloc(sizeof(struct SerdEnvImpl), 1);
-	if (env && base_uri) {
+	return serd_env_new_with_allocator(NULL, base_uri);
+}
+
+SERD_API
+SerdEnv*
+serd_env_new_with_allocator(const SerdAllocator* allocator,
+                            const SerdNode*      base_uri)
+{
+	SerdEnv* env = (SerdEnv*)serd_calloc(
+		allocator, 1, sizeof(struct SerdEnvImpl));
+	if (!env) {
+		return NULL;
+	}
+
+	env->allocator = allocator;
+	if (base_uri) {
 		serd_env_set_base_uri(env, base_uri);
 	}
 	return env;
@@ -46,13 +80,17 @@ SERD_API
 void
 serd_env_free(SerdEnv* env)
 {
+	const SerdAllocator* const allocator = env->allocator;
 	for (size_t i = 0; i < env->n_prefixes; ++i) {
-		serd_node_free(&env->prefixes[i].name);
-		serd_node_free(&env->prefixes[i].uri);
+		serd_node_free_with_allocator(allocator, &env->prefixes[i].name);
+		serd_node_free_with_allocator(allocator, &env->prefixes[i].uri);
 	}
-	free(env->prefixes);
-	serd_node_free(&env->base_uri_node);
-	free(env);
+	serd_free(allocator, env->prefixes);
+	serd_free(allocator, env->names);
+	serd_free(allocator, env->uris);
+	serd_free(allocator, env->uri_lens);
+	serd_node_free_with_allocator(allocator, &env->base_uri_node);
+	serd_free(allocator, env);
 }
 
 SERD_API
@@ -77,12 +115,12 @@ serd_env_set_base_uri(SerdEnv*        env,
 
 	// Resolve base URI and create a new node and URI for it
 	SerdURI  base_uri;
-	SerdNode base_uri_node = serd_node_new_uri_from_node(
-		uri_node, &env->base_uri, &base_uri);
+	SerdNode base_uri_node = serd_node_new_uri_from_node_with_allocator(
+		env->allocator, uri_node, &env->base_uri, &base_uri);
 
 	if (base_uri_node.buf) {
 		// Replace the current base URI
-		serd_node_free(&env->base_uri_node);
+		serd_node_free_with_allocator(env->allocator, &env->base_uri_node);
 		env->base_uri_node = base_uri_node;
 		env->base_uri      = base_uri;
 		return SERD_SUCCESS;
@@ -90,20 +128,85 @@ serd_env_set_base_uri(SerdEnv*        env,
 	return SERD_ERR_BAD_ARG;
 }
 
+/** Return the slot in `table` for `str` with hash `hash`, which may be empty. */
+static inline size_t*
+find_slot(const SerdEnv* env,
+          size_t*        table,
+          bool           by_uri,
+          uint64_t       hash,
+          const uint8_t* str,
+          size_t         len)
+{
+	const size_t mask = env->n_slots - 1;
+	for (size_t s = (size_t)hash & mask;; s = (s + 1) & mask) {
+		if (!table[s]) {
+			return &table[s];
+		}
+
+		const SerdPrefix* const prefix = &env->prefixes[table[s] - 1];
+		const SerdNode* const   key    = by_uri ? &prefix->uri : &prefix->name;
+		if (key->n_bytes == len && !memcmp(key->buf, str, len)) {
+			return &table[s];
+		}
+	}
+}
+
 static inline SerdPrefix*
 serd_env_find(const SerdEnv* env,
               const uint8_t* name,
               size_t         name_len)
 {
+	if (!env->n_prefixes) {
+		return NULL;
+	}
+
+	const size_t* const slot = find_slot(
+		env, env->names, false, hash_string(name, name_len), name, name_len);
+	return *slot ? &env->prefixes[*slot - 1] : NULL;
+}
+
+static void
+index_uri(SerdEnv* env, size_t i)
+{
+	const SerdNode* const uri  = &env->prefixes[i].uri;
+	size_t* const         slot = find_slot(
+		env, env->uris, true, hash_string(uri->buf, uri->n_bytes),
+		uri->buf, uri->n_bytes);
+	if (*slot) {
+		return;  // Namespace is already bound to an earlier prefix
+	}
+	*slot = i + 1;
+
+	// Insert URI length into sorted set of lengths
+	size_t l = 0;
+	for (; l < env->n_uri_lens && env->uri_lens[l] < uri->n_bytes; ++l) {}
+	if (l == env->n_uri_lens || env->uri_lens[l] != uri->n_bytes) {
+		env->uri_lens = (size_t*)serd_realloc(
+			env->allocator, env->uri_lens,
+			(++env->n_uri_lens) * sizeof(size_t));
+		memmove(env->uri_lens + l + 1, env->uri_lens + l,
+		        (env->n_uri_lens - l - 1) * sizeof(size_t));
+		env->uri_lens[l] = uri->n_bytes;
+	}
+}
+
+/** Rebuild both hash tables with `n_slots` slots. */
+static void
+reindex(SerdEnv* env, size_t n_slots)
+{
+	serd_free(env->allocator, env->names);
+	serd_free(env->allocator, env->uris);
+	env->names = (size_t*)serd_calloc(env->allocator, n_slots, sizeof(size_t));
+	env->uris  = (size_t*)serd_calloc(env->allocator, n_slots, sizeof(size_t));
+	env->n_slots    = n_slots;
+	env->n_uri_lens = 0;
 	for (size_t i = 0; i < env->n_prefixes; ++i) {
-		const SerdNode* const prefix_name = &env->prefixes[i].name;
-		if (prefix_name->n_bytes == name_len) {
-			if (!memcmp(prefix_name->buf, name, name_len)) {
-				return &env->prefixes[i];
-			}
-		}
+		const SerdNode* const name = &env->prefixes[i].name;
+		*find_slot(env, env->names, false,
+		           hash_string(name->buf, name->n_bytes),
+		           name->buf, name->n_bytes) = i + 1;
+		index_uri(env, i);
 	}
-	return NULL;
 }
 
 static void
@@ -114,13 +217,30 @@ serd_env_add(SerdEnv*        env,
 	SerdPrefix* const prefix = serd_env_find(env, name->buf, name->n_bytes);
 	if (prefix) {
 		SerdNode old_prefix_uri = prefix->uri;
-		prefix->uri = serd_node_copy(uri);
-		serd_node_free(&old_prefix_uri);
+		prefix->uri = serd_node_copy_with_allocator(env->allocator, uri);
+		serd_node_free_with_allocator(env->allocator, &old_prefix_uri);
+		reindex(env, env->n_slots);  // Rebuild URI index (rare)
+		return;
+	}
+
+	if (env->n_prefixes == env->prefixes_size) {
+		env->prefixes_size = env->prefixes_size ? env->prefixes_size * 2 : 8;
+		env->prefixes      = (SerdPrefix*)serd_realloc(
+			env->allocator, env->prefixes,
+			env->prefixes_size * sizeof(SerdPrefix));
+	}
+
+	const size_t i = env->n_prefixes++;
+	env->prefixes[i].name = serd_node_copy_with_allocator(env->allocator, name);
+	env->prefixes[i].uri  = serd_node_copy_with_allocator(env->allocator, uri);
+
+	if (env->n_prefixes * 2 > env->n_slots) {
+		reindex(env, env->n_slots ? env->n_slots * 2 : 16);
 	} else {
-		env->prefixes = (SerdPrefix*)realloc(
-			env->prefixes, (++env->n_prefixes) * sizeof(SerdPrefix));
-		env->prefixes[env->n_prefixes - 1].name = serd_node_copy(name);
-		env->prefixes[env->n_prefixes - 1].uri  = serd_node_copy(uri);
+		*find_slot(env, env->names, false,
+		           hash_string(name->buf, name->n_bytes),
+		           name->buf, name->n_bytes) = i + 1;
+		index_uri(env, i);
 	}
 }
 
@@ -138,12 +258,12 @@ serd_env_set_prefix(SerdEnv*        env,
 	} else {
 		// Resolve relative URI and create a new node and URI for it
 		SerdURI  abs_uri;
-		SerdNode abs_uri_node = serd_node_new_uri_from_node(
-			uri_node, &env->base_uri, &abs_uri);
+		SerdNode abs_uri_node = serd_node_new_uri_from_node_with_allocator(
+			env->allocator, uri_node, &env->base_uri, &abs_uri);
 
 		// Set prefix to resolved (absolute) URI
 		serd_env_add(env, name, &abs_uri_node);
-		serd_node_free(&abs_uri_node);
+		serd_node_free_with_allocator(env->allocator, &abs_uri_node);
 	}
 	return SERD_SUCCESS;
 }
@@ -188,21 +308,36 @@ serd_env_qualify(const SerdEnv*  env,
                  SerdNode*       prefix_name,
                  SerdChunk*      suffix)
 {
-	for (size_t i = 0; i < env->n_prefixes; ++i) {
-		const SerdNode* const prefix_uri = &env->prefixes[i].uri;
-		if (uri->n_bytes >= prefix_uri->n_bytes) {
-			if (!strncmp((const char*)uri->buf,
-			             (const char*)prefix_uri->buf,
-			             prefix_uri->n_bytes)) {
-				*prefix_name = env->prefixes[i].name;
-				suffix->buf = uri->buf + prefix_uri->n_bytes;
-				suffix->len = uri->n_bytes - prefix_uri->n_bytes;
-				if (is_name(suffix->buf, suffix->len)) {
-					return true;
-				}
+	/* Find the first declared prefix whose namespace is a prefix of `uri` and
+	   leaves a valid name, by looking up every namespace length in turn. */
+	const SerdPrefix* best = NULL;
+	uint64_t          hash = SERD_HASH_SEED;
+	size_t            pos  = 0;
+	for (size_t l = 0; l < env->n_uri_lens; ++l) {
+		const size_t len = env->uri_lens[l];
+		if (len > uri->n_bytes) {
+			break;
+		}
+		hash = serd_hash_bytes(hash, uri->buf + pos, len - pos);
+		pos  = len;
+
+		const size_t slot = *find_slot(
+			env, env->uris, true, serd_hash_finish(hash), uri->buf, len);
+		if (slot) {
+			const SerdPrefix* const prefix = &env->prefixes[slot - 1];
+			if ((!best || prefix < best) &&
+			    is_name(uri->buf + len, uri->n_bytes - len)) {
+				best = prefix;
 			}
 		}
 	}
+
+	if (best) {
+		*prefix_name = best->name;
+		suffix->buf  = uri->buf + best->uri.n_bytes;
+		suffix->len  = uri->n_bytes - best->uri.n_bytes;
+		return true;
+	}
 	return false;
 }
 
@@ -244,14 +379,15 @@ serd_env_expand_node(const SerdEnv*  env,
 			return SERD_NODE_NULL;
 		}
 		const size_t len = prefix.len + suffix.len;  // FIXME: UTF-8?
-		uint8_t*     buf = (uint8_t*)malloc(len + 1);
+		uint8_t*     buf = (uint8_t*)serd_malloc(env->allocator, len + 1);
 		SerdNode     ret = { buf, len, len, 0, SERD_URI };
 		snprintf((char*)buf, ret.n_bytes + 1, "%s%s", prefix.buf, suffix.buf);
 		return ret;
 	}
 	case SERD_URI: {
 		SerdURI ignored;
-		return serd_node_new_uri_from_node(node, &env->base_uri, &ignored);
+		return serd_node_new_uri_from_node_with_allocator(
+			env->allocator, node, &env->base_uri, &ignored);
 	}
 	default:
 		return SERD_NODE_NULL;
@@ -0,0 +1,409 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_FIELDS      (SERD_FILTER_LANG + 1)
+#define INITIAL_SLOTS 16
+
+/** Flags that describe abbreviations which filtering may break. */
+#define ABBREV_FLAGS (SERD_EMPTY_S|SERD_EMPTY_O|SERD_ANON_S_BEGIN| \
+                      SERD_ANON_O_BEGIN|SERD_ANON_CONT|SERD_LIST_S_BEGIN| \
+                      SERD_LIST_O_BEGIN|SERD_LIST_CONT)
+
+/** An exact pattern in a hash table, where a zero hash marks an empty slot. */
+typedef struct {
+	uint64_t hash;
+	uint8_t* str;
+	size_t   len;
+} Entry;
+
+/** A prefix trie node, where children are a list linked through siblings. */
+typedef struct {
+	unsigned child;     ///< Index of first child, or 0 for none
+	unsigned sibling;   ///< Index of next sibling, or 0 for none
+	uint8_t  byte;      ///< Last byte of the prefix this node represents
+	bool     terminal;  ///< True iff a pattern ends here
+} TrieNode;
+
+/** The patterns for one field. */
+typedef struct {
+	Entry*    entries;
+	size_t    n_entries;
+	size_t    n_slots;  ///< Size of entries (a power of 2)
+	TrieNode* trie;     ///< Prefix trie, with the root at index 0
+	unsigned  n_nodes;
+} Patterns;
+
+struct SerdFilterImpl {
+	SerdEnv*          env;
+	SerdStatementSink statement_sink;
+	void*             handle;
+	Patterns          fields[N_FIELDS];
+	uint8_t*          buf;  ///< Buffer for expanded URIs and language tags
+	size_t            buf_size;
+};
+
+static inline uint8_t
+to_lower(const uint8_t c)
+{
+	return in_range(c, 'A', 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+static uint64_t
+hash_string(const uint8_t* str, size_t len)
+{
+	const uint64_t hash = serd_hash_finish(
+		serd_hash_bytes(SERD_HASH_SEED, str, len));
+	return hash ? hash : 1;
+}
+
+static bool
+is_empty(const Patterns* pats)
+{
+	return !pats->n_entries && !pats->n_nodes;
+}
+
+static void
+entries_insert(Entry* entries, size_t n_slots, Entry entry)
+{
+	size_t s = entry.hash & (n_slots - 1);
+	while (entries[s].hash) {
+		s = (s + 1) & (n_slots - 1);
+	}
+	entries[s] = entry;
+}
+
+static bool
+exact_matches(const Patterns* pats, const uint8_t* str, size_t len)
+{
+	if (!pats->n_entries) {
+		return false;
+	}
+
+	const uint64_t hash = hash_string(str, len);
+	const size_t   mask = pats->n_slots - 1;
+	for (size_t s = hash & mask; pats->entries[s].hash; s = (s + 1) & mask) {
+		const Entry* e = &pats->entries[s];
+		if (e->hash == hash && e->len == len && !memcmp(e->str, str, len)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+add_exact(Patterns* pats, const uint8_t* str, size_t len)
+{
+	if (exact_matches(pats, str, len)) {
+		return;
+	} else if ((pats->n_entries + 1) * 2 > pats->n_slots) {
+		// Grow to keep the load factor at most 1/2
+		const size_t n_slots = (pats->n_slots ? pats->n_slots * 2
+		                                      : INITIAL_SLOTS);
+		Entry* const entries = (Entry*)calloc(n_slots, sizeof(Entry));
+		for (size_t i = 0; i < pats->n_slots; ++i) {
+			if (pats->entries[i].hash) {
+				entries_insert(entries, n_slots, pats->entries[i]);
+			}
+		}
+		free(pats->entries);
+		pats->entries = entries;
+		pats->n_slots = n_slots;
+	}
+
+	Entry entry = { hash_string(str, len), (uint8_t*)malloc(len + 1), len };
+	memcpy(entry.str, str, len);
+	entry.str[len] = '\0';
+	entries_insert(pats->entries, pats->n_slots, entry);
+	++pats->n_entries;
+}
+
+static unsigned
+trie_child(const Patterns* pats, unsigned node, uint8_t byte)
+{
+	unsigned c = pats->trie[node].child;
+	while (c && pats->trie[c].byte != byte) {
+		c = pats->trie[c].sibling;
+	}
+	return c;
+}
+
+static bool
+prefix_matches(const Patterns* pats, const uint8_t* str, size_t len)
+{
+	if (!pats->n_nodes) {
+		return false;
+	}
+
+	unsigned node = 0;
+	for (size_t i = 0; i < len; ++i) {
+		if (pats->trie[node].terminal) {
+			return true;
+		} else if (!(node = trie_child(pats, node, str[i]))) {
+			return false;
+		}
+	}
+	return pats->trie[node].terminal;
+}
+
+static void
+add_prefix(Patterns* pats, const uint8_t* str, size_t len)
+{
+	if (!pats->n_nodes) {
+		pats->trie    = (TrieNode*)calloc(1, sizeof(TrieNode));
+		pats->n_nodes = 1;
+	}
+
+	unsigned node = 0;
+	for (size_t i = 0; i < len; ++i) {
+		unsigned c = trie_child(pats, node, str[i]);
+		if (!c) {
+			c          = pats->n_nodes++;
+			pats->trie = (TrieNode*)realloc(
+				pats->trie, pats->n_nodes * sizeof(TrieNode));
+
+			TrieNode* const n = &pats->trie[c];
+			n->child               = 0;
+			n->sibling             = pats->trie[node].child;
+			n->byte                = str[i];
+			n->terminal            = false;
+			pats->trie[node].child = c;
+		}
+		node = c;
+	}
+	pats->trie[node].terminal = true;
+}
+
+static bool
+matches(const Patterns* pats, const uint8_t* str, size_t len)
+{
+	return exact_matches(pats, str, len) || prefix_matches(pats, str, len);
+}
+
+static uint8_t*
+reserve(SerdFilter* filter, size_t size)
+{
+	if (size > filter->buf_size) {
+		filter->buf      = (uint8_t*)realloc(filter->buf, size);
+		filter->buf_size = size;
+	}
+	return filter->buf;
+}
+
+/** Return true iff `node` is a URI that matches `pats`. */
+static bool
+uri_matches(SerdFilter* filter, const Patterns* pats, const SerdNode* node)
+{
+	if (node->type == SERD_CURIE) {
+		SerdChunk prefix;
+		SerdChunk suffix;
+		if (!filter->env ||
+		    serd_env_expand(filter->env, node, &prefix, &suffix)) {
+			return matches(pats, node->buf, node->n_bytes);
+		}
+
+		uint8_t* const buf = reserve(filter, prefix.len + suffix.len);
+		memcpy(buf, prefix.buf, prefix.len);
+		memcpy(buf + prefix.len, suffix.buf, suffix.len);
+		return matches(pats, buf, prefix.len + suffix.len);
+	} else if (node->type != SERD_URI) {
+		return false;
+	} else if (!filter->env || serd_uri_string_has_scheme(node->buf)) {
+		return matches(pats, node->buf, node->n_bytes);
+	}
+
+	// Resolve relative URI, growing the buffer if necessary
+	SerdURI base;
+	if (!serd_env_get_base_uri(filter->env, &base)->buf) {
+		return matches(pats, node->buf, node->n_bytes);
+	}
+
+	const size_t len = serd_uri_resolve_string(
+		node->buf, node->n_bytes, &base, filter->buf, filter->buf_size);
+	if (len >= filter->buf_size) {
+		serd_uri_resolve_string(node->buf, node->n_bytes, &base,
+		                        reserve(filter, len + 1), len + 1);
+	}
+	return matches(pats, filter->buf, len);
+}
+
+static bool
+datatype_matches(SerdFilter*     filter,
+                 const SerdNode* object,
+                 const SerdNode* datatype,
+                 const SerdNode* lang)
+{
+	static const char* const lang_string = NS_RDF "langString";
+	static const char* const string      = NS_XSD "string";
+
+	const Patterns* const pats = &filter->fields[SERD_FILTER_DATATYPE];
+	if (object->type != SERD_LITERAL) {
+		return false;
+	} else if (datatype && datatype->buf) {
+		return uri_matches(filter, pats, datatype);
+	} else if (lang && lang->buf) {
+		return matches(pats, (const uint8_t*)lang_string, strlen(lang_string));
+	}
+	return matches(pats, (const uint8_t*)string, strlen(string));
+}
+
+static bool
+lang_matches(SerdFilter* filter, const SerdNode* lang)
+{
+	if (!lang || !lang->buf) {
+		return false;
+	}
+
+	uint8_t* const buf = reserve(filter, lang->n_bytes);
+	for (size_t i = 0; i < lang->n_bytes; ++i) {
+		buf[i] = to_lower(lang->buf[i]);
+	}
+	return matches(&filter->fields[SERD_FILTER_LANG], buf, lang->n_bytes);
+}
+
+SERD_API
+SerdFilter*
+serd_filter_new(SerdEnv*          env,
+                SerdStatementSink statement_sink,
+                void*             handle)
+{
+	SerdFilter* filter = (SerdFilter*)calloc(1, sizeof(struct SerdFilterImpl));
+	filter->env            = env;
+	filter->statement_sink = statement_sink;
+	filter->handle         = handle;
+	filter->buf            = (uint8_t*)malloc(SERD_PAGE_SIZE);
+	filter->buf_size       = SERD_PAGE_SIZE;
+	return filter;
+}
+
+SERD_API
+void
+serd_filter_free(SerdFilter* filter)
+{
+	if (!filter) {
+		return;
+	}
+
+	for (unsigned f = 0; f < N_FIELDS; ++f) {
+		Patterns* const pats = &filter->fields[f];
+		for (size_t i = 0; i < pats->n_slots; ++i) {
+			free(pats->entries[i].str);
+		}
+		free(pats->entries);
+		free(pats->trie);
+	}
+	free(filter->buf);
+	free(filter);
+}
+
+/** Add a pattern, converting language tags to lower case. */
+static SerdStatus
+add_pattern(SerdFilter*     filter,
+            SerdFilterField field,
+            const uint8_t*  str,
+            bool            prefix)
+{
+	if ((unsigned)field >= N_FIELDS || !str) {
+		return SERD_ERR_BAD_ARG;
+	}
+
+	const size_t len = strlen((const char*)str);
+	if (field == SERD_FILTER_LANG) {
+		uint8_t* const buf = reserve(filter, len);
+		for (size_t i = 0; i < len; ++i) {
+			buf[i] = to_lower(str[i]);
+		}
+		str = buf;
+	}
+
+	if (prefix) {
+		add_prefix(&filter->fields[field], str, len);
+	} else {
+		add_exact(&filter->fields[field], str, len);
+	}
+	return SERD_SUCCESS;
+}
+
+SERD_API
+SerdStatus
+serd_filter_add_exact(SerdFilter*     filter,
+                      SerdFilterField field,
+                      const uint8_t*  str)
+{
+	return add_pattern(filter, field, str, false);
+}
+
+SERD_API
+SerdStatus
+serd_filter_add_prefix(SerdFilter*     filter,
+                       SerdFilterField field,
+                       const uint8_t*  prefix)
+{
+	return add_pattern(filter, field, prefix, true);
+}
+
+SERD_API
+bool
+serd_filter_matches(SerdFilter*     filter,
+                    const SerdNode* graph,
+                    const SerdNode* subject,
+                    const SerdNode* predicate,
+                    const SerdNode* object,
+                    const SerdNode* object_datatype,
+                    const SerdNode* object_lang)
+{
+	const Patterns* const f = filter->fields;
+
+	// Check predicates first, since they are usually the most selective
+	return ((is_empty(&f[SERD_FILTER_PREDICATE]) ||
+	         uri_matches(filter, &f[SERD_FILTER_PREDICATE], predicate)) &&
+	        (is_empty(&f[SERD_FILTER_SUBJECT]) ||
+	         uri_matches(filter, &f[SERD_FILTER_SUBJECT], subject)) &&
+	        (is_empty(&f[SERD_FILTER_OBJECT]) ||
+	         uri_matches(filter, &f[SERD_FILTER_OBJECT], object)) &&
+	        (is_empty(&f[SERD_FILTER_GRAPH]) ||
+	         (graph && graph->buf &&
+	          uri_matches(filter, &f[SERD_FILTER_GRAPH], graph))) &&
+	        (is_empty(&f[SERD_FILTER_DATATYPE]) ||
+	         datatype_matches(filter, object, object_datatype, object_lang)) &&
+	        (is_empty(&f[SERD_FILTER_LANG]) ||
+	         lang_matches(filter, object_lang)));
+}
+
+SERD_API
+SerdStatus
+serd_filter_write_statement(SerdFilter*        filter,
+                            SerdStatementFlags flags,
+                            const SerdNode*    graph,
+                            const SerdNode*    subject,
+                            const SerdNode*    predicate,
+                            const SerdNode*    object,
+                            const SerdNode*    object_datatype,
+                            const SerdNode*    object_lang)
+{
+	if (!serd_filter_matches(filter, graph, subject, predicate, object,
+	                         object_datatype, object_lang)) {
+		return SERD_SUCCESS;
+	}
+
+	return filter->statement_sink(filter->handle, flags & ~ABBREV_FLAGS,
+	                              graph, subject, predicate, object,
+	                              object_datatype, object_lang);
+}
@@ -0,0 +1,306 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#ifndef _FILE_OFFSET_BITS
+#    define _FILE_OFFSET_BITS 64  /* for 64-bit off_t with fseeko */
+#endif
+
+#include "serd_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SERD_INDEX_VERSION 1
+
+typedef struct {
+	size_t   checkpoint;  ///< Number of checkpoints preceding directive
+	SerdNode name;        ///< Prefix name, or null for a base directive
+	SerdNode uri;         ///< Base or namespace URI
+} IndexDirective;
+
+struct SerdIndexImpl {
+	IndexDirective* directives;
+	size_t          n_directives;
+	size_t*         offsets;
+	size_t          n_offsets;
+	unsigned        interval;
+};
+
+SERD_API
+SerdIndex*
+serd_index_new(unsigned interval)
+{
+	SerdIndex* index = (SerdIndex*)calloc(1, sizeof(struct SerdIndexImpl));
+	index->interval = interval ? interval : 1;
+	return index;
+}
+
+SERD_API
+void
+serd_index_free(SerdIndex* index)
+{
+	if (!index) {
+		return;
+	}
+	for (size_t i = 0; i < index->n_directives; ++i) {
+		serd_node_free(&index->directives[i].name);
+		serd_node_free(&index->directives[i].uri);
+	}
+	free(index->directives);
+	free(index->offsets);
+	free(index);
+}
+
+static void
+add_directive(SerdIndex* index, const SerdNode* name, const SerdNode* uri)
+{
+	index->directives = (IndexDirective*)realloc(
+		index->directives, (++index->n_directives) * sizeof(IndexDirective));
+
+	IndexDirective* const d = &index->directives[index->n_directives - 1];
+	d->checkpoint = index->n_offsets;
+	d->name       = serd_node_copy(name);
+	d->uri        = serd_node_copy(uri);
+}
+
+static void
+add_checkpoint(SerdIndex* index, size_t offset)
+{
+	index->offsets = (size_t*)realloc(
+		index->offsets, (++index->n_offsets) * sizeof(size_t));
+	index->offsets[index->n_offsets - 1] = offset;
+}
+
+static SerdStatus
+index_base_sink(void* handle, const SerdNode* uri)
+{
+	add_directive((SerdIndex*)handle, NULL, uri);
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+index_prefix_sink(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	add_directive((SerdIndex*)handle, name, uri);
+	return SERD_SUCCESS;
+}
+
+SERD_API
+SerdStatus
+serd_index_build(SerdIndex*     index,
+                 SerdSyntax     syntax,
+                 FILE*          file,
+                 const uint8_t* name)
+{
+	SerdReader* reader = serd_reader_new(
+		syntax, index, NULL, index_base_sink, index_prefix_sink, NULL, NULL);
+
+	add_checkpoint(index, 0);
+
+	SerdStatus st = serd_reader_start_stream(reader, file, name, true);
+	if (st) {
+		serd_reader_free(reader);
+		return (st > SERD_FAILURE) ? st : SERD_SUCCESS;
+	}
+
+	unsigned n = 0;
+	while (!(st = serd_reader_read_chunk(reader))) {
+		if (++n == index->interval) {
+			add_checkpoint(index, serd_reader_get_offset(reader));
+			n = 0;
+		}
+	}
+
+	serd_reader_end_stream(reader);
+	serd_reader_free(reader);
+	return (st > SERD_FAILURE) ? st : SERD_SUCCESS;
+}
+
+SERD_API
+size_t
+serd_index_get_size(const SerdIndex* index)
+{
+	return index->n_offsets;
+}
+
+SERD_API
+size_t
+serd_index_get_offset(const SerdIndex* index, size_t i)
+{
+	return (i < index->n_offsets) ? index->offsets[i] : 0;
+}
+
+/** Seek to `offset`, which may be beyond the range of long. */
+static int
+seek(FILE* file, size_t offset)
+{
+#if defined(_WIN32)
+	return _fseeki64(file, (__int64)offset, SEEK_SET);
+#elif defined(HAVE_FSEEKO)
+	return fseeko(file, (off_t)offset, SEEK_SET);
+#else
+	return fseek(file, (long)offset, SEEK_SET);
+#endif
+}
+
+SERD_API
+SerdStatus
+serd_index_seek(const SerdIndex* index,
+                size_t           i,
+                FILE*            file,
+                SerdBaseSink     base_sink,
+                SerdPrefixSink   prefix_sink,
+                void*            handle)
+{
+	if (i >= index->n_offsets) {
+		return SERD_ERR_BAD_ARG;
+	}
+
+	for (size_t d = 0; d < index->n_directives; ++d) {
+		const IndexDirective* const dir = &index->directives[d];
+		if (dir->checkpoint > i) {
+			break;
+		} else if (dir->name.buf && prefix_sink) {
+			prefix_sink(handle, &dir->name, &dir->uri);
+		} else if (!dir->name.buf && base_sink) {
+			base_sink(handle, &dir->uri);
+		}
+	}
+
+	if (seek(file, index->offsets[i])) {
+		return SERD_ERR_UNKNOWN;
+	}
+	return SERD_SUCCESS;
+}
+
+SERD_API
+SerdStatus
+serd_index_write(const SerdIndex* index, FILE* out)
+{
+	fprintf(out, "serd-index %d %u\n", SERD_INDEX_VERSION, index->interval);
+	for (size_t i = 0; i < index->n_directives; ++i) {
+		const IndexDirective* const dir = &index->directives[i];
+		if (dir->name.buf) {
+			fprintf(out, "P %lu %s: %s\n", (unsigned long)dir->checkpoint,
+			        (const char*)dir->name.buf, (const char*)dir->uri.buf);
+		} else {
+			fprintf(out, "B %lu %s\n", (unsigned long)dir->checkpoint,
+			        (const char*)dir->uri.buf);
+		}
+	}
+	for (size_t i = 0; i < index->n_offsets; ++i) {
+		fprintf(out, "C %lu\n", (unsigned long)index->offsets[i]);
+	}
+	return ferror(out) ? SERD_ERR_UNKNOWN : SERD_SUCCESS;
+}
+
+/** Read a line from `in` into `*buf`, growing it as necessary. */
+static bool
+read_line(FILE* in, char** buf, size_t* size)
+{
+	size_t len = 0;
+	int    c   = 0;
+	while ((c = fgetc(in)) != EOF && c != '\n') {
+		if (len + 1 >= *size) {
+			*size = *size ? *size * 2 : 256;
+			*buf  = (char*)realloc(*buf, *size);
+		}
+		(*buf)[len++] = (char)c;
+	}
+	if (c == EOF && len == 0) {
+		return false;
+	}
+	if (!*buf) {
+		*size = 256;
+		*buf  = (char*)malloc(*size);
+	}
+	(*buf)[len] = '\0';
+	return true;
+}
+
+static bool
+read_directive(SerdIndex* index, char* line, bool prefix)
+{
+	char*        str        = NULL;
+	const size_t checkpoint = strtoul(line + 2, &str, 10);
+	if (*str++ != ' ') {
+		return false;
+	}
+
+	SerdNode name = SERD_NODE_NULL;
+	if (prefix) {
+		char* const colon = strchr(str, ':');
+		if (!colon || colon[1] != ' ') {
+			return false;
+		}
+		*colon = '\0';
+		name   = serd_node_from_string(SERD_LITERAL, (const uint8_t*)str);
+		str    = colon + 2;
+	}
+
+	const SerdNode uri = serd_node_from_string(SERD_URI, (const uint8_t*)str);
+	add_directive(index, prefix ? &name : NULL, &uri);
+	index->directives[index->n_directives - 1].checkpoint = checkpoint;
+	return true;
+}
+
+SERD_API
+SerdIndex*
+serd_index_read(FILE* in)
+{
+	char*    line     = NULL;
+	size_t   size     = 0;
+	int      version  = 0;
+	unsigned interval = 0;
+	if (!read_line(in, &line, &size) ||
+	    sscanf(line, "serd-index %d %u", &version, &interval) != 2 ||
+	    version != SERD_INDEX_VERSION) {
+		free(line);
+		return NULL;
+	}
+
+	SerdIndex* index = serd_index_new(interval);
+	bool       ok    = true;
+	while (ok && read_line(in, &line, &size)) {
+		if (line[0] && line[1] != ' ') {
+			ok = false;
+			break;
+		}
+		switch (line[0]) {
+		case 'B':
+			ok = read_directive(index, line, false);
+			break;
+		case 'P':
+			ok = read_directive(index, line, true);
+			break;
+		case 'C':
+			add_checkpoint(index, strtoul(line + 2, NULL, 10));
+			break;
+		case '\0':
+			break;
+		default:
+			ok = false;
+		}
+	}
+
+	free(line);
+	if (!ok) {
+		serd_index_free(index);
+		return NULL;
+	}
+	return index;
+}
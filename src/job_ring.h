@@ -0,0 +1,246 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#ifndef SERD_JOB_RING_H
+#define SERD_JOB_RING_H
+
+#include "serd_internal.h"
+
+#include <stdlib.h>
+
+#ifdef HAVE_PTHREAD
+#    include <pthread.h>
+#endif
+
+/** Function called with the handle of a job ring and a slot. */
+typedef void (*SerdJobFunc)(void* handle, void* slot);
+
+/**
+   Ring of job slots which are run by worker threads and emitted in order.
+
+   The caller fills the slot at the tail and submits it, workers run submitted
+   slots in any order, and finished slots are emitted in submission order on
+   the calling thread.  Slots are indices into an array owned by the caller,
+   and the counters only increase, so the ring is full when `tail - head ==
+   n_slots`.  Without threads, slots are run as they are emitted.
+*/
+typedef struct {
+	void*           handle;     ///< Passed to run and emit
+	SerdJobFunc     run;        ///< Run a job, possibly on a worker thread
+	SerdJobFunc     emit;       ///< Emit a finished job on the caller thread
+	char*           slots;      ///< Array of n_slots slots (owned by caller)
+	size_t          slot_size;  ///< Size of a slot in bytes
+	size_t          n_slots;
+	bool*           done;       ///< True iff slot is ready to emit
+	size_t          head;       ///< Index of next slot to emit
+	size_t          tail;       ///< Index of next slot to fill
+	size_t          next;       ///< Index of next slot to run
+#ifdef HAVE_PTHREAD
+	pthread_t*      threads;
+	unsigned        n_threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t  work_cond;  ///< Signalled when a slot is submitted
+	pthread_cond_t  done_cond;  ///< Signalled when a slot is finished
+	bool            exit;
+#endif
+} SerdJobRing;
+
+static inline void*
+serd_job_ring_slot(const SerdJobRing* ring, size_t i)
+{
+	return ring->slots + (i % ring->n_slots) * ring->slot_size;
+}
+
+/** Return the slot at the tail, which the caller may fill and submit. */
+static inline void*
+serd_job_ring_tail(const SerdJobRing* ring)
+{
+	return serd_job_ring_slot(ring, ring->tail);
+}
+
+#ifdef HAVE_PTHREAD
+static void*
+serd_job_ring_worker(void* arg)
+{
+	SerdJobRing* const ring = (SerdJobRing*)arg;
+
+	pthread_mutex_lock(&ring->mutex);
+	while (!ring->exit) {
+		if (ring->next == ring->tail) {
+			pthread_cond_wait(&ring->work_cond, &ring->mutex);
+			continue;
+		}
+
+		const size_t i = ring->next++;
+		pthread_mutex_unlock(&ring->mutex);
+		ring->run(ring->handle, serd_job_ring_slot(ring, i));
+		pthread_mutex_lock(&ring->mutex);
+		ring->done[i % ring->n_slots] = true;
+		pthread_cond_broadcast(&ring->done_cond);
+	}
+	pthread_mutex_unlock(&ring->mutex);
+	return NULL;
+}
+#endif
+
+/**
+   Initialise `ring` for `n_slots` slots of `slot_size` bytes at `slots`.
+
+   If `n_threads` is greater than 1, that many workers are started to run
+   jobs, otherwise they are run on the calling thread.
+*/
+static inline void
+serd_job_ring_init(SerdJobRing* ring,
+                   void*        handle,
+                   SerdJobFunc  run,
+                   SerdJobFunc  emit,
+                   void*        slots,
+                   size_t       slot_size,
+                   size_t       n_slots,
+                   unsigned     n_threads)
+{
+	memset(ring, 0, sizeof(SerdJobRing));
+	ring->handle    = handle;
+	ring->run       = run;
+	ring->emit      = emit;
+	ring->slots     = (char*)slots;
+	ring->slot_size = slot_size;
+	ring->n_slots   = n_slots;
+	ring->done      = (bool*)calloc(n_slots, sizeof(bool));
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_init(&ring->mutex, NULL);
+	pthread_cond_init(&ring->work_cond, NULL);
+	pthread_cond_init(&ring->done_cond, NULL);
+	if (n_threads > 1) {
+		ring->threads = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+		for (unsigned i = 0; i < n_threads; ++i) {
+			if (pthread_create(&ring->threads[i], NULL,
+			                   serd_job_ring_worker, ring)) {
+				break;
+			}
+			++ring->n_threads;
+		}
+		if (!ring->n_threads) {
+			free(ring->threads);
+			ring->threads = NULL;
+		}
+	}
+#else
+	(void)n_threads;
+#endif
+}
+
+/**
+   Emit finished slots in order.
+
+   If `block` is true, wait for the first pending slot, and this returns after
+   emitting at least one slot if any are pending.
+*/
+static inline void
+serd_job_ring_emit(SerdJobRing* ring, bool block)
+{
+#ifdef HAVE_PTHREAD
+	if (ring->threads) {
+		pthread_mutex_lock(&ring->mutex);
+		while (ring->head < ring->tail) {
+			const size_t i = ring->head;
+			if (!ring->done[i % ring->n_slots]) {
+				if (!block) {
+					break;
+				}
+				pthread_cond_wait(&ring->done_cond, &ring->mutex);
+				continue;
+			}
+
+			// Only this thread touches finished slots, so emit unlocked
+			pthread_mutex_unlock(&ring->mutex);
+			ring->emit(ring->handle, serd_job_ring_slot(ring, i));
+			pthread_mutex_lock(&ring->mutex);
+			ring->done[i % ring->n_slots] = false;
+			++ring->head;
+			block = false;
+		}
+		pthread_mutex_unlock(&ring->mutex);
+		return;
+	}
+#endif
+	(void)block;
+	for (; ring->head < ring->tail; ++ring->head) {
+		void* const slot = serd_job_ring_slot(ring, ring->head);
+		ring->run(ring->handle, slot);
+		ring->emit(ring->handle, slot);
+	}
+	ring->next = ring->tail;
+}
+
+/**
+   Submit the slot at the tail to be run.
+
+   This emits any finished slots, and waits until the new tail slot is free.
+*/
+static inline void
+serd_job_ring_submit(SerdJobRing* ring)
+{
+#ifdef HAVE_PTHREAD
+	if (ring->threads) {
+		pthread_mutex_lock(&ring->mutex);
+		++ring->tail;
+		pthread_cond_signal(&ring->work_cond);
+		pthread_mutex_unlock(&ring->mutex);
+		serd_job_ring_emit(ring, false);
+		while (ring->tail - ring->head == ring->n_slots) {
+			serd_job_ring_emit(ring, true);  // Wait for a free slot
+		}
+		return;
+	}
+#endif
+	++ring->tail;
+	serd_job_ring_emit(ring, false);
+}
+
+/** Wait for and emit every submitted slot. */
+static inline void
+serd_job_ring_finish(SerdJobRing* ring)
+{
+	while (ring->head < ring->tail) {
+		serd_job_ring_emit(ring, true);
+	}
+}
+
+/** Stop any workers and free everything but the slots. */
+static inline void
+serd_job_ring_destroy(SerdJobRing* ring)
+{
+#ifdef HAVE_PTHREAD
+	if (ring->threads) {
+		pthread_mutex_lock(&ring->mutex);
+		ring->exit = true;
+		pthread_cond_broadcast(&ring->work_cond);
+		pthread_mutex_unlock(&ring->mutex);
+		for (unsigned i = 0; i < ring->n_threads; ++i) {
+			pthread_join(ring->threads[i], NULL);
+		}
+		free(ring->threads);
+	}
+	pthread_cond_destroy(&ring->done_cond);
+	pthread_cond_destroy(&ring->work_cond);
+	pthread_mutex_destroy(&ring->mutex);
+#endif
+	free(ring->done);
+}
+
+#endif  // SERD_JOB_RING_H
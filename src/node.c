@@ -27,6 +27,20 @@
 #    define isinf(x) (!_finite(x))
 #endif
 
+#define VOCAB_NODE(str) \
+	{ (const uint8_t*)(str), sizeof(str) - 1, sizeof(str) - 1, 0, SERD_URI }
+
+const SerdNode serd_vocab[SERD_N_VOCAB] = {
+	VOCAB_NODE(NS_RDF "first"),
+	VOCAB_NODE(NS_RDF "nil"),
+	VOCAB_NODE(NS_RDF "rest"),
+	VOCAB_NODE(NS_RDF "type"),
+	VOCAB_NODE(NS_XSD "boolean"),
+	VOCAB_NODE(NS_XSD "decimal"),
+	VOCAB_NODE(NS_XSD "double"),
+	VOCAB_NODE(NS_XSD "integer")
+};
+
 SERD_API
 SerdNode
 serd_node_from_string(SerdType type, const uint8_t* buf)
@@ -45,13 +59,21 @@ serd_node_from_string(SerdType type, const uint8_t* buf)
 SERD_API
 SerdNode
 serd_node_copy(const SerdNode* node)
+{
+	return serd_node_copy_with_allocator(NULL, node);
+}
+
+SERD_API
+SerdNode
+serd_node_copy_with_allocator(const SerdAllocator* allocator,
+                              const SerdNode*      node)
 {
 	if (!node || !node->buf) {
 		return SERD_NODE_NULL;
 	}
 
 	SerdNode copy = *node;
-	uint8_t* buf  = (uint8_t*)malloc(copy.n_bytes + 1);
+	uint8_t* buf  = (uint8_t*)serd_malloc(allocator, copy.n_bytes + 1);
 	memcpy(buf, node->buf, copy.n_bytes + 1);
 	copy.buf = buf;
 	return copy;
@@ -70,40 +92,46 @@ serd_node_equals(const SerdNode* a, const SerdNode* b)
 		                                      a->n_bytes + 1)));
 }
 
-static size_t
-serd_uri_string_length(const SerdURI* uri)
+SERD_API
+SerdNode
+serd_node_new_uri_from_node(const SerdNode* uri_node,
+                            const SerdURI*  base,
+                            SerdURI*        out)
 {
-	size_t len = uri->path_base.len;
-
-#define ADD_LEN(field, n_delims) \
-	if ((field).len) { len += (field).len + (n_delims); }
-
-	ADD_LEN(uri->path,      1);  // + possible leading `/'
-	ADD_LEN(uri->scheme,    1);  // + trailing `:'
-	ADD_LEN(uri->authority, 2);  // + leading `//'
-	ADD_LEN(uri->query,     1);  // + leading `?'
-	ADD_LEN(uri->fragment,  1);  // + leading `#'
-
-	return len + 2;  // + 2 for authority `//'
+	return serd_node_new_uri_from_node_with_allocator(NULL, uri_node, base, out);
 }
 
-static size_t
-string_sink(const void* buf, size_t len, void* stream)
+/** Resolve and serialise the `len` bytes of URI string at `str`. */
+static SerdNode
+new_uri_from_chunk(const SerdAllocator* allocator,
+                   const uint8_t*       str,
+                   size_t               len,
+                   const SerdURI*       base,
+                   SerdURI*             out)
 {
-	uint8_t** ptr = (uint8_t**)stream;
-	memcpy(*ptr, buf, len);
-	*ptr += len;
-	return len;
+	if (!len) {
+		if (base) {
+			// Empty URI => Base
+			return serd_node_new_uri_with_allocator(allocator, base, NULL, out);
+		} else {
+			return SERD_NODE_NULL;  // Nonsense
+		}
+	}
+	SerdURI uri;
+	serd_uri_parse_chunk(str, len, &uri);
+	return serd_node_new_uri_with_allocator(allocator, &uri, base, out);
 }
 
 SERD_API
 SerdNode
-serd_node_new_uri_from_node(const SerdNode* uri_node,
-                            const SerdURI*  base,
-                            SerdURI*        out)
+serd_node_new_uri_from_node_with_allocator(const SerdAllocator* allocator,
+                                           const SerdNode*      uri_node,
+                                           const SerdURI*       base,
+                                           SerdURI*             out)
 {
 	return (uri_node->type == SERD_URI && uri_node->buf)
-		? serd_node_new_uri_from_string(uri_node->buf, base, out)
+		? new_uri_from_chunk(
+			allocator, uri_node->buf, uri_node->n_bytes, base, out)
 		: SERD_NODE_NULL;
 }
 
@@ -113,16 +141,18 @@ serd_node_new_uri_from_string(const uint8_t* str,
                               const SerdURI* base,
                               SerdURI*       out)
 {
-	if (!str || str[0] == '\0') {
-		if (base) {
-			return serd_node_new_uri(base, NULL, out);  // Empty URI => Base
-		} else {
-			return SERD_NODE_NULL;  // Nonsense
-		}
-	}
-	SerdURI uri;
-	serd_uri_parse(str, &uri);
-	return serd_node_new_uri(&uri, base, out);  // Resolve/Serialise
+	return serd_node_new_uri_from_string_with_allocator(NULL, str, base, out);
+}
+
+SERD_API
+SerdNode
+serd_node_new_uri_from_string_with_allocator(const SerdAllocator* allocator,
+                                             const uint8_t*       str,
+                                             const SerdURI*       base,
+                                             SerdURI*             out)
+{
+	return new_uri_from_chunk(
+		allocator, str, str ? strlen((const char*)str) : 0, base, out);
 }
 
 static inline bool
@@ -150,6 +180,18 @@ serd_node_new_file_uri(const uint8_t* path,
                        const uint8_t* hostname,
                        SerdURI*       out,
                        bool           escape)
+{
+	return serd_node_new_file_uri_with_allocator(
+		NULL, path, hostname, out, escape);
+}
+
+SERD_API
+SerdNode
+serd_node_new_file_uri_with_allocator(const SerdAllocator* allocator,
+                                      const uint8_t*       path,
+                                      const uint8_t*       hostname,
+                                      SerdURI*             out,
+                                      bool                 escape)
 {
 	const size_t path_len     = strlen((const char*)path);
 	const size_t hostname_len = hostname ? strlen((const char*)hostname) : 0;
@@ -159,30 +201,32 @@ serd_node_new_file_uri(const uint8_t* path,
 
 	if (path[0] == '/' || is_windows_path(path)) {
 		uri_len = strlen("file://") + hostname_len + evil;
-		uri = (uint8_t*)malloc(uri_len + 1);
+		uri = (uint8_t*)serd_malloc(allocator, uri_len + 1);
 		snprintf((char*)uri, uri_len + 1, "file://%s%s",
 		         hostname ? (const char*)hostname : "",
 		         evil ? "/" : "");
 	}
 
-	SerdChunk chunk = { uri, uri_len };
+	SerdBuffer buffer = { allocator, { uri, uri_len } };
 	for (size_t i = 0; i < path_len; ++i) {
 		if (evil && path[i] == '\\') {
-			serd_chunk_sink("/", 1, &chunk);
+			serd_buffer_sink("/", 1, &buffer);
 		} else if (path[i] == '%') {
-			serd_chunk_sink("%%", 2, &chunk);
+			serd_buffer_sink("%%", 2, &buffer);
 		} else if (!escape || is_uri_path_char(path[i])) {
-			serd_chunk_sink(path + i, 1, &chunk);
+			serd_buffer_sink(path + i, 1, &buffer);
 		} else {
 			char escape_str[4] = { '%', 0, 0, 0 };
 			snprintf(escape_str + 1, sizeof(escape_str) - 1, "%X", path[i]);
-			serd_chunk_sink(escape_str, 3, &chunk);
+			serd_buffer_sink(escape_str, 3, &buffer);
 		}
 	}
-	serd_chunk_sink_finish(&chunk);
+	serd_buffer_sink_finish(&buffer);
+
+	const SerdChunk chunk = buffer.chunk;
 
 	if (out) {
-		serd_uri_parse(chunk.buf, out);
+		serd_uri_parse_chunk(chunk.buf, chunk.len - 1, out);
 	}
 
 	return serd_node_from_string(SERD_URI, chunk.buf);
@@ -191,26 +235,30 @@ serd_node_new_file_uri(const uint8_t* path,
 SERD_API
 SerdNode
 serd_node_new_uri(const SerdURI* uri, const SerdURI* base, SerdURI* out)
+{
+	return serd_node_new_uri_with_allocator(NULL, uri, base, out);
+}
+
+SERD_API
+SerdNode
+serd_node_new_uri_with_allocator(const SerdAllocator* allocator,
+                                 const SerdURI*       uri,
+                                 const SerdURI*       base,
+                                 SerdURI*             out)
 {
 	SerdURI abs_uri = *uri;
 	if (base) {
 		serd_uri_resolve(uri, base, &abs_uri);
 	}
 
-	const size_t len = serd_uri_string_length(&abs_uri);
-	uint8_t*     buf = (uint8_t*)malloc(len + 1);
+	const size_t len = serd_uri_serialise_buffer(&abs_uri, NULL, 0);
+	uint8_t*     buf = (uint8_t*)serd_malloc(allocator, len + 1);
 
 	SerdNode node = { buf, len, len, 0, SERD_URI };  // FIXME: UTF-8
-
-	uint8_t*     ptr        = buf;
-	const size_t actual_len = serd_uri_serialise(&abs_uri, string_sink, &ptr);
-
-	buf[actual_len] = '\0';
-	node.n_bytes    = actual_len;
-	node.n_chars    = actual_len;
+	serd_uri_serialise_buffer(&abs_uri, buf, len + 1);
 
 	if (out) {
-		serd_uri_parse(buf, out);  // TODO: cleverly avoid double parse
+		serd_uri_parse_chunk(buf, len, out);  // TODO: avoid double parse
 	}
 
 	return node;
@@ -226,6 +274,15 @@ serd_digits(double abs)
 SERD_API
 SerdNode
 serd_node_new_decimal(double d, unsigned frac_digits)
+{
+	return serd_node_new_decimal_with_allocator(NULL, d, frac_digits);
+}
+
+SERD_API
+SerdNode
+serd_node_new_decimal_with_allocator(const SerdAllocator* allocator,
+                                     double               d,
+                                     unsigned             frac_digits)
 {
 	if (isnan(d) || isinf(d)) {
 		return SERD_NODE_NULL;
@@ -233,7 +290,8 @@ serd_node_new_decimal(double d, unsigned frac_digits)
 
 	const double   abs_d      = fabs(d);
 	const unsigned int_digits = serd_digits(abs_d);
-	char*          buf        = (char*)calloc(int_digits + frac_digits + 3, 1);
+	char*          buf        = (char*)serd_calloc(
+		allocator, int_digits + frac_digits + 3, 1);
 	SerdNode       node       = { (const uint8_t*)buf, 0, 0, 0, SERD_LITERAL };
 	const double   int_part   = floor(abs_d);
 
@@ -278,81 +336,527 @@ serd_node_new_decimal(double d, unsigned frac_digits)
 	return node;
 }
 
+/** Powers of 10 which fit in a uint64_t. */
+static const uint64_t pow10_u64[] = {
+	1ULL,
+	10ULL,
+	100ULL,
+	1000ULL,
+	10000ULL,
+	100000ULL,
+	1000000ULL,
+	10000000ULL,
+	100000000ULL,
+	1000000000ULL,
+	10000000000ULL,
+	100000000000ULL,
+	1000000000000ULL,
+	10000000000000ULL,
+	100000000000000ULL,
+	1000000000000000ULL,
+	10000000000000000ULL,
+	100000000000000000ULL,
+	1000000000000000000ULL,
+	10000000000000000000ULL
+};
+
+/** Decimal digit pairs "00" to "99", for writing two digits at a time. */
+static const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/** Return the number of decimal digits in `i`, without branching on it. */
+static inline unsigned
+count_digits(uint64_t i)
+{
+	unsigned n = 1;
+	for (unsigned k = 1; k < 20; ++k) {
+		n += (i >= pow10_u64[k]);
+	}
+	return n;
+}
+
+/** Write the `n_digits` digits of `i` ending at `end` (right to left). */
+static inline void
+write_digits(uint64_t i, unsigned n_digits, uint8_t* end)
+{
+	uint8_t* s = end;
+	for (; n_digits >= 2; n_digits -= 2) {
+		const unsigned r = (unsigned)(i % 100) * 2;
+		i /= 100;
+		*--s = digit_pairs[r + 1];
+		*--s = digit_pairs[r];
+	}
+	if (n_digits) {
+		*--s = (uint8_t)('0' + i);
+	}
+}
+
+SERD_API
+size_t
+serd_format_integer(int64_t i, uint8_t* buf)
+{
+	// Negate as unsigned, since -INT64_MIN is not representable
+	const uint64_t abs_i    = (i < 0) ? 0 - (uint64_t)i : (uint64_t)i;
+	const unsigned n_digits = count_digits(abs_i);
+	const size_t   len      = n_digits + (i < 0);
+
+	buf[0] = '-';
+	write_digits(abs_i, n_digits, buf + len);
+	buf[len] = '\0';
+	return len;
+}
+
 SERD_API
 SerdNode
 serd_node_new_integer(int64_t i)
 {
-	int64_t        abs_i  = (i < 0) ? -i : i;
-	const unsigned digits = serd_digits(abs_i);
-	char*          buf    = (char*)calloc(digits + 2, 1);
-	SerdNode       node   = { (const uint8_t*)buf, 0, 0, 0, SERD_LITERAL };
+	return serd_node_new_integer_with_allocator(NULL, i);
+}
 
-	// Point s to the end
-	char* s = buf + digits - 1;
-	if (i < 0) {
-		*buf = '-';
-		++s;
+SERD_API
+SerdNode
+serd_node_new_integer_with_allocator(const SerdAllocator* allocator,
+                                     int64_t              i)
+{
+	uint8_t      tmp[SERD_INTEGER_BUF_SIZE];
+	const size_t len = serd_format_integer(i, tmp);
+	uint8_t*     buf = (uint8_t*)serd_malloc(allocator, len + 1);
+	memcpy(buf, tmp, len + 1);
+
+	SerdNode node = { buf, len, len, 0, SERD_LITERAL };
+	return node;
+}
+
+/*
+  Shortest round-trip double formatting.
+
+  This is an implementation of the Grisu3 algorithm described in "Printing
+  Floating-Point Numbers Quickly and Accurately with Integers" by Florian
+  Loitsch (PLDI 2010).  It uses only 64-bit integer arithmetic, and detects
+  the rare cases where it can not be sure the result is the shortest, which
+  are handled by a slower exact fallback.
+*/
+
+/** A "do-it-yourself" floating point number f * 2^e. */
+typedef struct {
+	uint64_t f;
+	int      e;
+} DiyFp;
+
+#define DBL_HIDDEN_BIT 0x0010000000000000ULL
+#define DBL_MANT_MASK  0x000FFFFFFFFFFFFFULL
+
+/** Normalised 64-bit approximations of 10^k for k = -348, -340, ..., 340. */
+static const DiyFp cached_powers[] = {
+	{ 0xfa8fd5a0081c0288ULL, -1220 },  // 1e-348
+	{ 0xbaaee17fa23ebf76ULL, -1193 },  // 1e-340
+	{ 0x8b16fb203055ac76ULL, -1166 },  // 1e-332
+	{ 0xcf42894a5dce35eaULL, -1140 },  // 1e-324
+	{ 0x9a6bb0aa55653b2dULL, -1113 },  // 1e-316
+	{ 0xe61acf033d1a45dfULL, -1087 },  // 1e-308
+	{ 0xab70fe17c79ac6caULL, -1060 },  // 1e-300
+	{ 0xff77b1fcbebcdc4fULL, -1034 },  // 1e-292
+	{ 0xbe5691ef416bd60cULL, -1007 },  // 1e-284
+	{ 0x8dd01fad907ffc3cULL,  -980 },  // 1e-276
+	{ 0xd3515c2831559a83ULL,  -954 },  // 1e-268
+	{ 0x9d71ac8fada6c9b5ULL,  -927 },  // 1e-260
+	{ 0xea9c227723ee8bcbULL,  -901 },  // 1e-252
+	{ 0xaecc49914078536dULL,  -874 },  // 1e-244
+	{ 0x823c12795db6ce57ULL,  -847 },  // 1e-236
+	{ 0xc21094364dfb5637ULL,  -821 },  // 1e-228
+	{ 0x9096ea6f3848984fULL,  -794 },  // 1e-220
+	{ 0xd77485cb25823ac7ULL,  -768 },  // 1e-212
+	{ 0xa086cfcd97bf97f4ULL,  -741 },  // 1e-204
+	{ 0xef340a98172aace5ULL,  -715 },  // 1e-196
+	{ 0xb23867fb2a35b28eULL,  -688 },  // 1e-188
+	{ 0x84c8d4dfd2c63f3bULL,  -661 },  // 1e-180
+	{ 0xc5dd44271ad3cdbaULL,  -635 },  // 1e-172
+	{ 0x936b9fcebb25c996ULL,  -608 },  // 1e-164
+	{ 0xdbac6c247d62a584ULL,  -582 },  // 1e-156
+	{ 0xa3ab66580d5fdaf6ULL,  -555 },  // 1e-148
+	{ 0xf3e2f893dec3f126ULL,  -529 },  // 1e-140
+	{ 0xb5b5ada8aaff80b8ULL,  -502 },  // 1e-132
+	{ 0x87625f056c7c4a8bULL,  -475 },  // 1e-124
+	{ 0xc9bcff6034c13053ULL,  -449 },  // 1e-116
+	{ 0x964e858c91ba2655ULL,  -422 },  // 1e-108
+	{ 0xdff9772470297ebdULL,  -396 },  // 1e-100
+	{ 0xa6dfbd9fb8e5b88fULL,  -369 },  // 1e-92
+	{ 0xf8a95fcf88747d94ULL,  -343 },  // 1e-84
+	{ 0xb94470938fa89bcfULL,  -316 },  // 1e-76
+	{ 0x8a08f0f8bf0f156bULL,  -289 },  // 1e-68
+	{ 0xcdb02555653131b6ULL,  -263 },  // 1e-60
+	{ 0x993fe2c6d07b7facULL,  -236 },  // 1e-52
+	{ 0xe45c10c42a2b3b06ULL,  -210 },  // 1e-44
+	{ 0xaa242499697392d3ULL,  -183 },  // 1e-36
+	{ 0xfd87b5f28300ca0eULL,  -157 },  // 1e-28
+	{ 0xbce5086492111aebULL,  -130 },  // 1e-20
+	{ 0x8cbccc096f5088ccULL,  -103 },  // 1e-12
+	{ 0xd1b71758e219652cULL,   -77 },  // 1e-4
+	{ 0x9c40000000000000ULL,   -50 },  // 1e4
+	{ 0xe8d4a51000000000ULL,   -24 },  // 1e12
+	{ 0xad78ebc5ac620000ULL,     3 },  // 1e20
+	{ 0x813f3978f8940984ULL,    30 },  // 1e28
+	{ 0xc097ce7bc90715b3ULL,    56 },  // 1e36
+	{ 0x8f7e32ce7bea5c70ULL,    83 },  // 1e44
+	{ 0xd5d238a4abe98068ULL,   109 },  // 1e52
+	{ 0x9f4f2726179a2245ULL,   136 },  // 1e60
+	{ 0xed63a231d4c4fb27ULL,   162 },  // 1e68
+	{ 0xb0de65388cc8ada8ULL,   189 },  // 1e76
+	{ 0x83c7088e1aab65dbULL,   216 },  // 1e84
+	{ 0xc45d1df942711d9aULL,   242 },  // 1e92
+	{ 0x924d692ca61be758ULL,   269 },  // 1e100
+	{ 0xda01ee641a708deaULL,   295 },  // 1e108
+	{ 0xa26da3999aef774aULL,   322 },  // 1e116
+	{ 0xf209787bb47d6b85ULL,   348 },  // 1e124
+	{ 0xb454e4a179dd1877ULL,   375 },  // 1e132
+	{ 0x865b86925b9bc5c2ULL,   402 },  // 1e140
+	{ 0xc83553c5c8965d3dULL,   428 },  // 1e148
+	{ 0x952ab45cfa97a0b3ULL,   455 },  // 1e156
+	{ 0xde469fbd99a05fe3ULL,   481 },  // 1e164
+	{ 0xa59bc234db398c25ULL,   508 },  // 1e172
+	{ 0xf6c69a72a3989f5cULL,   534 },  // 1e180
+	{ 0xb7dcbf5354e9beceULL,   561 },  // 1e188
+	{ 0x88fcf317f22241e2ULL,   588 },  // 1e196
+	{ 0xcc20ce9bd35c78a5ULL,   614 },  // 1e204
+	{ 0x98165af37b2153dfULL,   641 },  // 1e212
+	{ 0xe2a0b5dc971f303aULL,   667 },  // 1e220
+	{ 0xa8d9d1535ce3b396ULL,   694 },  // 1e228
+	{ 0xfb9b7cd9a4a7443cULL,   720 },  // 1e236
+	{ 0xbb764c4ca7a44410ULL,   747 },  // 1e244
+	{ 0x8bab8eefb6409c1aULL,   774 },  // 1e252
+	{ 0xd01fef10a657842cULL,   800 },  // 1e260
+	{ 0x9b10a4e5e9913129ULL,   827 },  // 1e268
+	{ 0xe7109bfba19c0c9dULL,   853 },  // 1e276
+	{ 0xac2820d9623bf429ULL,   880 },  // 1e284
+	{ 0x80444b5e7aa7cf85ULL,   907 },  // 1e292
+	{ 0xbf21e44003acdd2dULL,   933 },  // 1e300
+	{ 0x8e679c2f5e44ff8fULL,   960 },  // 1e308
+	{ 0xd433179d9c8cb841ULL,   986 },  // 1e316
+	{ 0x9e19db92b4e31ba9ULL,  1013 },  // 1e324
+	{ 0xeb96bf6ebadf77d9ULL,  1039 },  // 1e332
+	{ 0xaf87023b9bf0ee6bULL,  1066 },  // 1e340
+};
+
+/** Return x * y, rounded, with only the upper 64 bits of the product. */
+static inline DiyFp
+diy_fp_multiply(DiyFp x, DiyFp y)
+{
+	const uint64_t m32 = 0xFFFFFFFFULL;
+	const uint64_t a   = x.f >> 32;
+	const uint64_t b   = x.f & m32;
+	const uint64_t c   = y.f >> 32;
+	const uint64_t d   = y.f & m32;
+	const uint64_t ac  = a * c;
+	const uint64_t bc  = b * c;
+	const uint64_t ad  = a * d;
+	const uint64_t bd  = b * d;
+	const uint64_t mid = (bd >> 32) + (ad & m32) + (bc & m32) + (1ULL << 31);
+
+	const DiyFp r = { ac + (ad >> 32) + (bc >> 32) + (mid >> 32),
+	                  x.e + y.e + 64 };
+	return r;
+}
+
+/** Shift `x` so the highest bit of `x.f` is set. */
+static inline DiyFp
+diy_fp_normalize(DiyFp x)
+{
+	while (!(x.f & 0xFFC0000000000000ULL)) {
+		x.f <<= 10;
+		x.e -= 10;
+	}
+	while (!(x.f & 0x8000000000000000ULL)) {
+		x.f <<= 1;
+		x.e -= 1;
 	}
+	return x;
+}
 
-	node.n_bytes = node.n_chars = (s - buf) + 1;
+/** Return a cached power c = 10^-k so that e(c * 2^e) is in [-60, -32]. */
+static inline DiyFp
+cached_power(int e, int* k)
+{
+	const double dk = (-61 - e) * 0.30102999566398114 + 347;  // log10(2)
+	int          ik = (int)dk;
+	if (dk - ik > 0.0) {
+		++ik;
+	}
 
-	// Write integer part (right to left)
-	do {
-		*s-- = '0' + (abs_i % 10);
-	} while ((abs_i /= 10) > 0);
+	const unsigned index = (unsigned)((ik >> 3) + 1);
+	*k = -(-348 + (int)(index * 8));
+	return cached_powers[index];
+}
 
-	return node;
+/**
+   Move the last digit towards `w` while it stays within the boundaries.
+
+   All values are scaled so `unit` is the maximum error of `w` and the
+   boundaries.  Return true iff the result is certainly the closest shortest
+   representation, otherwise the caller must fall back to an exact method.
+*/
+static inline bool
+grisu_round_weed(uint8_t* buf,
+                 unsigned len,
+                 uint64_t too_high_w,
+                 uint64_t unsafe_interval,
+                 uint64_t rest,
+                 uint64_t ten_kappa,
+                 uint64_t unit)
+{
+	const uint64_t small_distance = too_high_w - unit;
+	const uint64_t big_distance   = too_high_w + unit;
+	while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+	       (rest + ten_kappa < small_distance ||
+	        small_distance - rest >= rest + ten_kappa - small_distance)) {
+		--buf[len - 1];
+		rest += ten_kappa;
+	}
+
+	if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+	    (rest + ten_kappa < big_distance ||
+	     big_distance - rest > rest + ten_kappa - big_distance)) {
+		return false;  // Could be closer to w, but error makes it uncertain
+	}
+
+	return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
 }
 
 /**
-   Base64 encoding table.
-   @see <a href="http://tools.ietf.org/html/rfc3548#section-3">RFC3986 S3</a>.
+   Generate the shortest digits of `w` between the boundaries `low` and `high`.
+
+   @return The number of digits written, or zero if the result is uncertain.
 */
-static const uint8_t b64_map[] =
-	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static unsigned
+grisu_digits(DiyFp low, DiyFp w, DiyFp high, uint8_t* buf, int* k)
+{
+	uint64_t       unit     = 1;
+	const uint64_t too_low  = low.f - unit;
+	const uint64_t too_high = high.f + unit;
+	uint64_t       unsafe   = too_high - too_low;
+	const DiyFp    one      = { 1ULL << -w.e, w.e };
+	uint32_t       p1       = (uint32_t)(too_high >> -one.e);
+	uint64_t       p2       = too_high & (one.f - 1);
+	int            kappa    = (int)count_digits(p1);
+	unsigned       len      = 0;
+
+	// Integral part
+	while (kappa > 0) {
+		const uint32_t div = (uint32_t)pow10_u64[kappa - 1];
+		buf[len++] = (uint8_t)('0' + p1 / div);
+		p1 %= div;
+		--kappa;
+
+		const uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+		if (rest < unsafe) {
+			*k += kappa;
+			return grisu_round_weed(buf, len, too_high - w.f, unsafe, rest,
+			                        (uint64_t)div << -one.e, unit)
+				? len : 0;
+		}
+	}
+
+	// Fractional part
+	for (;;) {
+		p2     *= 10;
+		unit   *= 10;
+		unsafe *= 10;
+		buf[len++] = (uint8_t)('0' + (p2 >> -one.e));
+		p2 &= one.f - 1;
+		--kappa;
+		if (p2 < unsafe) {
+			*k += kappa;
+			return grisu_round_weed(buf, len, (too_high - w.f) * unit, unsafe,
+			                        p2, one.f, unit)
+				? len : 0;
+		}
+	}
+}
 
 /**
-   Encode 3 raw bytes to 4 base64 characters.
+   Write the shortest digits of positive finite `d` to `buf` with Grisu3.
+
+   @param k Set to the decimal exponent, so `d` is about digits * 10^k.
+   @return The number of digits written, or zero if Grisu3 can not be sure
+   that the digits are the shortest, which happens for about 0.5% of doubles.
 */
-static inline void
-encode_chunk(uint8_t out[4], const uint8_t in[3], size_t n_in)
+static unsigned
+grisu3(double d, uint8_t* buf, int* k)
 {
-	out[0] = b64_map[in[0] >> 2];
-	out[1] = b64_map[((in[0] & 0x03) << 4) | ((in[1] & 0xF0) >> 4)];
-	out[2] = ((n_in > 1)
-	          ? (b64_map[((in[1] & 0x0F) << 2) | ((in[2] & 0xC0) >> 6)])
-	          : (uint8_t)'=');
-	out[3] = ((n_in > 2) ? b64_map[in[2] & 0x3F] : (uint8_t)'=');
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+
+	const int biased_e = (int)((bits >> 52) & 0x7FF);
+	DiyFp     v        = { bits & DBL_MANT_MASK, -1074 };
+	if (biased_e) {
+		v.f += DBL_HIDDEN_BIT;
+		v.e  = biased_e - 1075;
+	}
+
+	// Boundaries halfway to the neighbouring doubles
+	DiyFp mp = { (v.f << 1) + 1, v.e - 1 };
+	mp = diy_fp_normalize(mp);
+	DiyFp mm = (v.f == DBL_HIDDEN_BIT && biased_e > 1)
+		? (DiyFp){ (v.f << 2) - 1, v.e - 2 }
+		: (DiyFp){ (v.f << 1) - 1, v.e - 1 };
+	mm.f <<= mm.e - mp.e;
+	mm.e = mp.e;
+
+	const DiyFp c  = cached_power(mp.e, k);
+	const DiyFp w  = diy_fp_multiply(diy_fp_normalize(v), c);
+	const DiyFp wp = diy_fp_multiply(mp, c);
+	const DiyFp wm = diy_fp_multiply(mm, c);
+	return grisu_digits(wm, w, wp, buf, k);
 }
 
-SERD_API
-SerdNode
-serd_node_new_blob(const void* buf, size_t size, bool wrap_lines)
-{
-	const size_t len  = ((size + 2) / 3) * 4 + (wrap_lines ? (size / 57) : 0);
-	uint8_t*     str  = (uint8_t*)calloc(1, len + 2);
-	SerdNode     node = { str, len, len, 0, SERD_LITERAL };
-	for (size_t i = 0, j = 0; i < size; i += 3, j += 4) {
-		uint8_t in[4] = { 0, 0, 0, 0 };
-		size_t  n_in  = MIN(3, size - i);
-		memcpy(in, (const uint8_t*)buf + i, n_in);
-
-		if (wrap_lines && i > 0 && (i % 57) == 0) {
-			str[j++] = '\n';
-			node.flags |= SERD_HAS_NEWLINE;
+/** Return true iff `len` digits at `buf` times 10^`k` read back as `d`. */
+static bool
+digits_read_back(double d, const uint8_t* buf, unsigned len, int k)
+{
+	char str[40];
+	snprintf(str, sizeof(str), "%.*se%d", (int)len, (const char*)buf, k);
+	return serd_strtod(str, NULL) == d;
+}
+
+/**
+   Write the shortest digits of positive finite `d` to `buf` exactly.
+
+   This is the slow fallback for when Grisu3 fails, which tries more and more
+   correctly rounded digits until they read back as `d`.  The lower boundary
+   of a power of 2 is closer than the upper, so the next larger digits may
+   read back when the closest do not, and are tried as well.
+*/
+static unsigned
+exact_digits(double d, uint8_t* buf, int* k)
+{
+	char     str[32];
+	unsigned len = 0;
+	for (int precision = 0; precision < 17; ++precision) {
+		snprintf(str, sizeof(str), "%.*e", precision, d);
+
+		// Copy digits without the point, and parse the exponent
+		const char* c = str;
+		for (len = 0; *c != 'e'; ++c) {
+			if (*c != '.') {
+				buf[len++] = (uint8_t)*c;
+			}
 		}
+		*k = atoi(c + 1) - precision;
+
+		const double closest = serd_strtod(str, NULL);
+		if (closest == d) {
+			break;
+		} else if (closest < d) {
+			// Increment last digit, carrying into a new leading 1 if necessary
+			uint8_t  next[20];
+			unsigned i = len;
+			memcpy(next, buf, len);
+			while (i > 0 && next[i - 1] == '9') {
+				next[--i] = '0';
+			}
+			const int next_k = i ? *k : *k + 1;
+			if (i) {
+				++next[i - 1];
+			} else {
+				next[0] = '1';
+			}
+
+			if (digits_read_back(d, next, len, next_k)) {
+				memcpy(buf, next, len);
+				*k = next_k;
+				break;
+			}
+		}
+	}
+
+	// Remove trailing zeros (from carrying)
+	while (len > 1 && buf[len - 1] == '0') {
+		--len;
+		++*k;
+	}
+	return len;
+}
+
+SERD_API
+size_t
+serd_format_double(double d, uint8_t* buf)
+{
+	uint8_t* s = buf;
+	if (isnan(d)) {
+		memcpy(buf, "NaN", 4);
+		return 3;
+	} else if (d < 0.0 || (d == 0.0 && 1.0 / d < 0.0)) {
+		*s++ = '-';
+		d    = -d;
+	}
+
+	if (isinf(d)) {
+		memcpy(s, "INF", 4);
+		return (size_t)(s - buf) + 3;
+	} else if (d == 0.0) {
+		memcpy(s, "0.0E0", 6);
+		return (size_t)(s - buf) + 5;
+	}
 
-		encode_chunk(str + j, in, n_in);
+	// Generate digits after the leading digit and its point
+	int      k        = 0;
+	unsigned n_digits = grisu3(d, s + 1, &k);
+	if (!n_digits) {
+		n_digits = exact_digits(d, s + 1, &k);
 	}
+	s[0] = s[1];
+	s[1] = '.';
+	s   += n_digits + 1;
+	if (n_digits == 1) {
+		*s++ = '0';
+	}
+
+	// Write exponent of the leading digit
+	*s++ = 'E';
+	return (size_t)(s - buf) + serd_format_integer(k + (int)n_digits - 1, s);
+}
+
+SERD_API
+SerdNode
+serd_node_new_double(double d)
+{
+	return serd_node_new_double_with_allocator(NULL, d);
+}
+
+SERD_API
+SerdNode
+serd_node_new_double_with_allocator(const SerdAllocator* allocator, double d)
+{
+	uint8_t      tmp[SERD_DOUBLE_BUF_SIZE];
+	const size_t len = serd_format_double(d, tmp);
+	uint8_t*     buf = (uint8_t*)serd_malloc(allocator, len + 1);
+	memcpy(buf, tmp, len + 1);
+
+	SerdNode node = { buf, len, len, 0, SERD_LITERAL };
 	return node;
 }
 
 SERD_API
 void
 serd_node_free(SerdNode* node)
+{
+	serd_node_free_with_allocator(NULL, node);
+}
+
+SERD_API
+void
+serd_node_free_with_allocator(const SerdAllocator* allocator, SerdNode* node)
 {
 	if (node && node->buf) {
-		free((uint8_t*)node->buf);
+		serd_free(allocator, (uint8_t*)node->buf);
 		node->buf = NULL;
 	}
 }
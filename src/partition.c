@@ -0,0 +1,215 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_SLOTS 64
+
+/* Every blank node is kept with the same sink as where it first appeared.  A
+   blank node first seen as an object goes to the sink of that statement, so
+   its description goes with the statement that refers to it, even if it comes
+   much later (as is common in NTriples).  A blank node first seen as a
+   subject goes to the sink for its label.  These choices are kept in an open
+   addressing hash table of blank node hashes, where zero marks an empty slot,
+   which grows with the number of distinct blank nodes. */
+
+typedef struct {
+	uint64_t hash;   ///< Hash of blank node label, or zero if empty
+	unsigned index;  ///< Index of sink for the blank node
+} Blank;
+
+struct SerdPartitionerImpl {
+	SerdEnv*          env;
+	SerdStatementSink statement_sink;
+	SerdEndSink       end_sink;
+	void**            handles;
+	unsigned          n_sinks;
+	unsigned          current;  ///< Index of sink for the last statement
+	Blank*            blanks;   ///< Hash table of blank nodes seen so far
+	size_t            n_blanks;
+	size_t            n_slots;  ///< Size of blanks (a power of 2)
+};
+
+static size_t
+hash_sink(const void* buf, size_t len, void* stream)
+{
+	uint64_t* const hash = (uint64_t*)stream;
+	*hash = serd_hash_bytes(*hash, buf, len);
+	return len;
+}
+
+/** Return the hash of a blank node, which is never zero. */
+static uint64_t
+hash_blank(const SerdNode* node)
+{
+	const uint64_t hash = serd_hash_finish(
+		serd_hash_bytes(SERD_HASH_SEED, node->buf, node->n_bytes));
+	return hash ? hash : 1;
+}
+
+/** Return the slot for `hash` in `blanks`, which may be empty. */
+static Blank*
+blanks_find(Blank* blanks, size_t n_slots, uint64_t hash)
+{
+	const size_t mask = n_slots - 1;
+	size_t       s    = hash & mask;
+	while (blanks[s].hash && blanks[s].hash != hash) {
+		s = (s + 1) & mask;
+	}
+	return &blanks[s];
+}
+
+/** Return the entry for blank `node`, which has no sink if it is new. */
+static Blank*
+blanks_get(SerdPartitioner* part, const SerdNode* node)
+{
+	if ((part->n_blanks + 1) * 2 > part->n_slots) {
+		// Grow to keep the load factor at most 1/2
+		const size_t n_slots = part->n_slots * 2;
+		Blank* const blanks  = (Blank*)calloc(n_slots, sizeof(Blank));
+		for (size_t i = 0; i < part->n_slots; ++i) {
+			if (part->blanks[i].hash) {
+				*blanks_find(blanks, n_slots, part->blanks[i].hash) =
+					part->blanks[i];
+			}
+		}
+		free(part->blanks);
+		part->blanks  = blanks;
+		part->n_slots = n_slots;
+	}
+
+	const uint64_t hash  = hash_blank(node);
+	Blank* const   blank = blanks_find(part->blanks, part->n_slots, hash);
+	if (!blank->hash) {
+		blank->hash  = hash;
+		blank->index = part->n_sinks;
+		++part->n_blanks;
+	}
+	return blank;
+}
+
+SERD_API
+SerdPartitioner*
+serd_partitioner_new(SerdEnv*          env,
+                     unsigned          n_sinks,
+                     SerdStatementSink statement_sink,
+                     SerdEndSink       end_sink,
+                     void* const*      handles)
+{
+	if (!n_sinks) {
+		return NULL;
+	}
+
+	SerdPartitioner* part = (SerdPartitioner*)calloc(
+		1, sizeof(struct SerdPartitionerImpl));
+	part->env            = env;
+	part->statement_sink = statement_sink;
+	part->end_sink       = end_sink;
+	part->handles        = (void**)malloc(n_sinks * sizeof(void*));
+	part->n_sinks        = n_sinks;
+	part->blanks         = (Blank*)calloc(INITIAL_SLOTS, sizeof(Blank));
+	part->n_slots        = INITIAL_SLOTS;
+	memcpy(part->handles, handles, n_sinks * sizeof(void*));
+	return part;
+}
+
+SERD_API
+void
+serd_partitioner_free(SerdPartitioner* part)
+{
+	if (part) {
+		free(part->blanks);
+		free(part->handles);
+		free(part);
+	}
+}
+
+SERD_API
+unsigned
+serd_partitioner_get_index(const SerdPartitioner* part,
+                           const SerdNode*        subject)
+{
+	uint64_t  hash = SERD_HASH_SEED;
+	SerdChunk prefix;
+	SerdChunk suffix;
+	if (subject->type == SERD_CURIE &&
+	    !serd_env_expand(part->env, subject, &prefix, &suffix)) {
+		hash = serd_hash_bytes(hash, prefix.buf, prefix.len);
+		hash = serd_hash_bytes(hash, suffix.buf, suffix.len);
+	} else if (subject->type == SERD_URI &&
+	           !serd_uri_string_has_scheme(subject->buf)) {
+		// Resolve relative URI and hash the result as it is serialised
+		SerdURI base;
+		SerdURI uri;
+		SerdURI abs_uri;
+		serd_env_get_base_uri(part->env, &base);
+		serd_uri_parse_chunk(subject->buf, subject->n_bytes, &uri);
+		serd_uri_resolve(&uri, &base, &abs_uri);
+		serd_uri_serialise(&abs_uri, hash_sink, &hash);
+	} else {
+		hash = serd_hash_bytes(hash, subject->buf, subject->n_bytes);
+	}
+
+	return (unsigned)(serd_hash_finish(hash) % part->n_sinks);
+}
+
+SERD_API
+SerdStatus
+serd_partitioner_write_statement(SerdPartitioner*   part,
+                                 SerdStatementFlags flags,
+                                 const SerdNode*    graph,
+                                 const SerdNode*    subject,
+                                 const SerdNode*    predicate,
+                                 const SerdNode*    object,
+                                 const SerdNode*    object_datatype,
+                                 const SerdNode*    object_lang)
+{
+	if (subject->type == SERD_BLANK) {
+		Blank* const blank = blanks_get(part, subject);
+		if (blank->index == part->n_sinks) {
+			// Not referred to before, so use the sink for its label
+			blank->index = serd_partitioner_get_index(part, subject);
+		}
+		part->current = blank->index;
+	} else {
+		part->current = serd_partitioner_get_index(part, subject);
+	}
+
+	if (object->type == SERD_BLANK) {
+		Blank* const blank = blanks_get(part, object);
+		if (blank->index == part->n_sinks) {
+			// First reference, so keep the description with this statement
+			blank->index = part->current;
+		}
+	}
+
+	return part->statement_sink(part->handles[part->current], flags, graph,
+	                            subject, predicate, object,
+	                            object_datatype, object_lang);
+}
+
+SERD_API
+SerdStatus
+serd_partitioner_end_anon(SerdPartitioner* part,
+                          const SerdNode*  node)
+{
+	return part->end_sink
+		? part->end_sink(part->handles[part->current], node)
+		: SERD_SUCCESS;
+}
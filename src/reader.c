@@ -24,9 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#define NS_XSD "http://www.w3.org/2001/XMLSchema#"
-#define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
+#include <time.h>
 
 #define TRY_THROW(exp) if (!(exp)) goto except;
 #define TRY_RET(exp)   if (!(exp)) return 0;
@@ -38,6 +36,12 @@
 #    define SERD_STACK_ASSERT_TOP(reader, ref)
 #endif
 
+#ifdef SERD_NO_STATS
+#    define SERD_STAT_ADD(reader, field, n)
+#else
+#    define SERD_STAT_ADD(reader, field, n) ((reader)->stats.field += (n))
+#endif
+
 typedef struct {
 	const uint8_t* filename;
 	unsigned       line;
@@ -51,6 +55,17 @@ typedef uint32_t uchar;
 */
 typedef size_t Ref;
 
+/* Reference to a well-known node in serd_vocab, which is not in the stack.
+   These count down from the maximum Ref, so are never valid stack offsets.
+*/
+#define VOCAB_REF(id) ((Ref)-1 - (Ref)(id))
+
+static inline bool
+is_vocab_ref(const Ref ref)
+{
+	return ref > VOCAB_REF(SERD_N_VOCAB);
+}
+
 typedef struct {
 	Ref                 graph;
 	Ref                 subject;
@@ -59,38 +74,45 @@ typedef struct {
 } ReadContext;
 
 struct SerdReaderImpl {
-	void*             handle;
-	void              (*free_handle)(void* ptr);
-	SerdBaseSink      base_sink;
-	SerdPrefixSink    prefix_sink;
-	SerdStatementSink statement_sink;
-	SerdEndSink       end_sink;
-	SerdErrorSink     error_sink;
-	void*             error_handle;
-	Ref               rdf_first;
-	Ref               rdf_rest;
-	Ref               rdf_nil;
-	SerdNode          default_graph;
-	FILE*             fd;
-	SerdStack         stack;
-	SerdSyntax        syntax;
-	Cursor            cur;
-	uint8_t*          buf;
-	uint8_t*          bprefix;
-	size_t            bprefix_len;
-	unsigned          next_id;
-	const uint8_t*    read_buf;
-	uint8_t*          file_buf;
-	int32_t           read_head;  ///< Offset into read_buf
-	uint8_t           read_byte;  ///< 1-byte 'buffer' used when not paging
-	bool              from_file;  ///< True iff reading from `fd`
-	bool              paging;     ///< True iff reading a page at a time
-	bool              strict;     ///< True iff strict parsing
-	bool              eof;
-	bool              seen_genid;
+	const SerdAllocator* allocator;
+	void*                handle;
+	void                 (*free_handle)(void* ptr);
+	SerdBaseSink         base_sink;
+	SerdPrefixSink       prefix_sink;
+	SerdStatementSink    statement_sink;
+	SerdEndSink          end_sink;
+	SerdErrorSink        error_sink;
+	void*                error_handle;
+	SerdLiteralBeginSink literal_begin_sink;
+	SerdLiteralChunkSink literal_chunk_sink;
+	SerdLiteralEndSink   literal_end_sink;
+	size_t               literal_limit;  ///< Length to stream literals, or 0
+	SerdNode             default_graph;
+	FILE*                fd;
+	SerdStack            stack;
+	SerdSyntax           syntax;
+	Cursor               cur;
+	uint8_t*             buf;
+	uint8_t*             bprefix;
+	size_t               bprefix_len;
+	unsigned             next_id;
+	const uint8_t*       read_buf;
+	uint8_t*             file_buf;
+	size_t               n_read;     ///< Number of input bytes consumed
+	int32_t              read_head;  ///< Offset into read_buf
+	uint8_t              read_byte;  ///< 1-byte 'buffer' used when not paging
+	bool                 from_file;  ///< True iff reading from `fd`
+	bool                 paging;     ///< True iff reading a page at a time
+	bool                 strict;     ///< True iff strict parsing
+	bool                 eof;
+	bool                 seen_genid;
+	bool                 timing;     ///< True iff measuring time
 #ifdef SERD_STACK_CHECK
-	Ref*              allocs;     ///< Stack of push offsets
-	size_t            n_allocs;   ///< Number of stack pushes
+	Ref*                 allocs;     ///< Stack of push offsets
+	size_t               n_allocs;   ///< Number of stack pushes
+#endif
+#ifndef SERD_NO_STATS
+	SerdReaderStats      stats;      ///< Performance counters
 #endif
 };
 
@@ -107,9 +129,55 @@ r_err(SerdReader* reader, SerdStatus st, const char* fmt, ...)
 	return 0;
 }
 
+/** Return the current time in seconds if timing is enabled, or zero. */
+static inline double
+stats_now(const SerdReader* reader)
+{
+#if defined(SERD_NO_STATS)
+	(void)reader;
+	return 0.0;
+#else
+	if (!reader->timing) {
+		return 0.0;
+	}
+#    if defined(HAVE_CLOCK_GETTIME)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+#    else
+	return (double)clock() / CLOCKS_PER_SEC;
+#    endif
+#endif
+}
+
+/** Add the time since `start` to the time spent in user sinks. */
+static inline void
+stats_end_sink(SerdReader* reader, double start)
+{
+#ifndef SERD_NO_STATS
+	reader->stats.sink_time += stats_now(reader) - start;
+#else
+	(void)reader;
+	(void)start;
+#endif
+}
+
+/** Add the time since `start` to the total time spent reading. */
+static inline void
+stats_end_read(SerdReader* reader, double start)
+{
+#ifndef SERD_NO_STATS
+	reader->stats.parse_time += stats_now(reader) - start;
+#else
+	(void)reader;
+	(void)start;
+#endif
+}
+
 static inline SerdStatus
 page(SerdReader* reader)
 {
+	SERD_STAT_ADD(reader, n_pages, 1);
 	reader->read_head = 0;
 	size_t n_read = fread(reader->file_buf, 1, SERD_PAGE_SIZE, reader->fd);
 	if (n_read == 0) {
@@ -138,6 +206,7 @@ eat_byte_safe(SerdReader* reader, const uint8_t byte)
 	default:   ++reader->cur.col;
 	}
 
+	++reader->n_read;
 	if (reader->from_file && !reader->paging) {
 		const int c = fgetc(reader->fd);
 		reader->read_byte = (c == EOF) ? 0 : (uint8_t)c;
@@ -169,12 +238,30 @@ eat_string(SerdReader* reader, const char* str, unsigned n)
 	}
 }
 
+static inline uint8_t*
+stack_push(SerdReader* reader, size_t n_bytes)
+{
+#ifndef SERD_NO_STATS
+	const size_t buf_size = reader->stack.buf_size;
+	uint8_t*     mem      = serd_stack_push(&reader->stack, n_bytes);
+	if (reader->stack.buf_size != buf_size) {
+		++reader->stats.stack_reallocs;
+	}
+	if (reader->stack.size > reader->stats.stack_peak) {
+		reader->stats.stack_peak = reader->stack.size;
+	}
+	return mem;
+#else
+	return serd_stack_push(&reader->stack, n_bytes);
+#endif
+}
+
 static Ref
 push_node_padded(SerdReader* reader, size_t maxlen,
                  SerdType type, const char* str, size_t n_bytes)
 {
-	uint8_t* mem = serd_stack_push(&reader->stack,
-	                               sizeof(SerdNode) + maxlen + 1);
+	SERD_STAT_ADD(reader, n_nodes, 1);
+	uint8_t* mem = stack_push(reader, sizeof(SerdNode) + maxlen + 1);
 
 	SerdNode* const node = (SerdNode*)mem;
 	node->n_bytes = node->n_chars = n_bytes;
@@ -186,8 +273,9 @@ push_node_padded(SerdReader* reader, size_t maxlen,
 	memcpy(buf, str, n_bytes + 1);
 
 #ifdef SERD_STACK_CHECK
-	reader->allocs = realloc(
-		reader->allocs, sizeof(uint8_t*) * (++reader->n_allocs));
+	reader->allocs = serd_realloc(
+		reader->allocator, reader->allocs,
+		sizeof(uint8_t*) * (++reader->n_allocs));
 	reader->allocs[reader->n_allocs - 1] = (mem - reader->stack.buf);
 #endif
 	return (uint8_t*)node - reader->stack.buf;
@@ -202,7 +290,9 @@ push_node(SerdReader* reader, SerdType type, const char* str, size_t n_bytes)
 static inline SerdNode*
 deref(SerdReader* reader, const Ref ref)
 {
-	if (ref) {
+	if (is_vocab_ref(ref)) {
+		return (SerdNode*)&serd_vocab[VOCAB_REF(0) - ref];
+	} else if (ref) {
 		SerdNode* node = (SerdNode*)(reader->stack.buf + ref);
 		node->buf = (uint8_t*)node + sizeof(SerdNode);
 		return node;
@@ -214,7 +304,7 @@ static inline void
 push_byte(SerdReader* reader, Ref ref, const uint8_t c)
 {
 	SERD_STACK_ASSERT_TOP(reader, ref);
-	uint8_t* const  s    = serd_stack_push(&reader->stack, 1);
+	uint8_t* const  s    = stack_push(reader, 1);
 	SerdNode* const node = (SerdNode*)(reader->stack.buf + ref);
 	++node->n_bytes;
 	if (!(c & 0x80)) {  // Starts with 0 bit, start of new character
@@ -235,8 +325,7 @@ push_replacement(SerdReader* reader, Ref dest)
 static Ref
 pop_node(SerdReader* reader, Ref ref)
 {
-	if (ref && ref != reader->rdf_first && ref != reader->rdf_rest
-	    && ref != reader->rdf_nil) {
+	if (ref && !is_vocab_ref(ref)) {
 #ifdef SERD_STACK_CHECK
 		SERD_STACK_ASSERT_TOP(reader, ref);
 		--reader->n_allocs;
@@ -255,11 +344,14 @@ emit_statement(SerdReader* reader, ReadContext ctx, Ref o, Ref d, Ref l)
 	if (!graph && reader->default_graph.buf) {
 		graph = &reader->default_graph;
 	}
+	SERD_STAT_ADD(reader, n_statements, 1);
+	const double start = stats_now(reader);
 	bool ret = !reader->statement_sink ||
 		!reader->statement_sink(
 			reader->handle, *ctx.flags, graph,
 			deref(reader, ctx.subject), deref(reader, ctx.predicate),
 			deref(reader, o), deref(reader, d), deref(reader, l));
+	stats_end_sink(reader, start);
 	*ctx.flags &= SERD_ANON_CONT|SERD_LIST_CONT;  // Preserve only cont flags
 	return ret;
 }
@@ -518,15 +610,68 @@ eat_delim(SerdReader* reader, const char delim)
 	return false;
 }
 
+// Pass the value of literal `ref` to the literal sink and clear it
+static bool
+flush_literal(SerdReader* reader, Ref ref, bool* streaming)
+{
+	if (!*streaming) {
+		*streaming = true;
+		if (reader->literal_begin_sink &&
+		    reader->literal_begin_sink(reader->handle)) {
+			return false;
+		}
+	}
+
+	SerdNode* const node  = deref(reader, ref);
+	const SerdChunk chunk = { node->buf, node->n_bytes };
+	if (node->n_bytes && reader->literal_chunk_sink &&
+	    reader->literal_chunk_sink(reader->handle, &chunk)) {
+		return false;
+	}
+
+	serd_stack_pop(&reader->stack, node->n_bytes);
+	node->n_bytes = node->n_chars = 0;
+	*(uint8_t*)node->buf = '\0';
+	return true;
+}
+
+// Stream literal `ref` if it has reached the length limit
+static inline bool
+check_literal(SerdReader* reader, Ref ref, bool* streaming)
+{
+	const size_t n_bytes = reader->stack.size - ref - sizeof(SerdNode) - 1;
+	return !reader->literal_limit || n_bytes < reader->literal_limit ||
+		flush_literal(reader, ref, streaming);
+}
+
+// Finish reading literal `ref`, passing the rest to the sink if streaming
+static Ref
+end_literal(SerdReader* reader, Ref ref, SerdNodeFlags* flags, bool streaming)
+{
+	if (streaming) {
+		if (!flush_literal(reader, ref, &streaming) ||
+		    (reader->literal_end_sink &&
+		     reader->literal_end_sink(reader->handle))) {
+			return pop_node(reader, ref);
+		}
+		*flags |= SERD_IS_STREAMED;
+	}
+	return ref;
+}
+
 // STRING_LITERAL_LONG_QUOTE and STRING_LITERAL_LONG_SINGLE_QUOTE
 // Initial triple quotes are already eaten by caller
 static Ref
 read_STRING_LITERAL_LONG(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 {
-	Ref ref = push_node(reader, SERD_LITERAL, "", 0);
+	Ref  ref       = push_node(reader, SERD_LITERAL, "", 0);
+	bool streaming = false;
 	while (true) {
 		const uint8_t c = peek_byte(reader);
 		uint32_t      code;
+		if (!check_literal(reader, ref, &streaming)) {
+			return pop_node(reader, ref);
+		}
 		switch (c) {
 		case '\\':
 			eat_byte_safe(reader, c);
@@ -536,6 +681,7 @@ read_STRING_LITERAL_LONG(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 				      "invalid escape `\\%c'\n", peek_byte(reader));
 				return pop_node(reader, ref);
 			}
+			SERD_STAT_ADD(reader, n_escaped, 1);
 			break;
 		default:
 			if (c == q) {
@@ -544,7 +690,7 @@ read_STRING_LITERAL_LONG(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 				const uint8_t q3 = peek_byte(reader);
 				if (q2 == q && q3 == q) {  // End of string
 					eat_byte_safe(reader, q3);
-					return ref;
+					return end_literal(reader, ref, flags, streaming);
 				} else {
 					*flags |= SERD_HAS_QUOTE;
 					push_byte(reader, ref, c);
@@ -563,10 +709,14 @@ read_STRING_LITERAL_LONG(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 static Ref
 read_STRING_LITERAL(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 {
-	Ref ref = push_node(reader, SERD_LITERAL, "", 0);
+	Ref  ref       = push_node(reader, SERD_LITERAL, "", 0);
+	bool streaming = false;
 	while (true) {
 		const uint8_t c = peek_byte(reader);
 		uint32_t      code;
+		if (!check_literal(reader, ref, &streaming)) {
+			return pop_node(reader, ref);
+		}
 		switch (c) {
 		case '\n': case '\r':
 			r_err(reader, SERD_ERR_BAD_SYNTAX, "line end in short string\n");
@@ -579,11 +729,12 @@ read_STRING_LITERAL(SerdReader* reader, SerdNodeFlags* flags, uint8_t q)
 				      "invalid escape `\\%c'\n", peek_byte(reader));
 				return pop_node(reader, ref);
 			}
+			SERD_STAT_ADD(reader, n_escaped, 1);
 			break;
 		default:
 			if (c == q) {
 				eat_byte_check(reader, q);
-				return ref;
+				return end_literal(reader, ref, flags, streaming);
 			} else {
 				read_character(reader, ref, flags, eat_byte_safe(reader, c));
 			}
@@ -795,6 +946,7 @@ read_IRIREF(SerdReader* reader)
 				r_err(reader, SERD_ERR_BAD_SYNTAX, "invalid IRI escape\n");
 				return pop_node(reader, ref);
 			}
+			SERD_STAT_ADD(reader, n_escaped, 1);
 			switch (code) {
 			case 0: case ' ': case '<': case '>':
 				r_err(reader, SERD_ERR_BAD_SYNTAX,
@@ -855,9 +1007,6 @@ read_0_9(SerdReader* reader, Ref str, bool at_least_one)
 static bool
 read_number(SerdReader* reader, Ref* dest, Ref* datatype, bool* ate_dot)
 {
-	#define XSD_DECIMAL NS_XSD "decimal"
-	#define XSD_DOUBLE  NS_XSD "double"
-	#define XSD_INTEGER NS_XSD "integer"
 	Ref     ref         = push_node(reader, SERD_LITERAL, "", 0);
 	uint8_t c           = peek_byte(reader);
 	bool    has_decimal = false;
@@ -899,14 +1048,11 @@ read_number(SerdReader* reader, Ref* dest, Ref* datatype, bool* ate_dot)
 		default: break;
 		}
 		TRY_THROW(read_0_9(reader, ref, true));
-		*datatype = push_node(reader, SERD_URI,
-		                      XSD_DOUBLE, sizeof(XSD_DOUBLE) - 1);
+		*datatype = VOCAB_REF(SERD_XSD_DOUBLE);
 	} else if (has_decimal) {
-		*datatype = push_node(reader, SERD_URI,
-		                      XSD_DECIMAL, sizeof(XSD_DECIMAL) - 1);
+		*datatype = VOCAB_REF(SERD_XSD_DECIMAL);
 	} else {
-		*datatype = push_node(reader, SERD_URI,
-		                      XSD_INTEGER, sizeof(XSD_INTEGER) - 1);
+		*datatype = VOCAB_REF(SERD_XSD_INTEGER);
 	}
 	*dest = ref;
 	return true;
@@ -989,7 +1135,7 @@ read_verb(SerdReader* reader, Ref* dest)
 		if (!st && node->n_bytes == 1 && node->buf[0] == 'a' &&
 		    is_token_end(peek_byte(reader))) {
 			pop_node(reader, *dest);
-			return (*dest = push_node(reader, SERD_URI, NS_RDF "type", 47));
+			return (*dest = VOCAB_REF(SERD_RDF_TYPE));
 		} else if (st > SERD_FAILURE ||
 		           !read_PrefixedName(reader, *dest, false, &ate_dot) ||
 		           ate_dot) {
@@ -1126,7 +1272,9 @@ read_anon(SerdReader* reader, ReadContext ctx, bool subject, Ref* dest)
 		}
 		read_ws_star(reader);
 		if (reader->end_sink) {
+			const double start = stats_now(reader);
 			reader->end_sink(reader->handle, deref(reader, *dest));
+			stats_end_sink(reader, start);
 		}
 		*ctx.flags = old_flags;
 	}
@@ -1138,9 +1286,6 @@ read_anon(SerdReader* reader, ReadContext ctx, bool subject, Ref* dest)
 static bool
 read_object(SerdReader* reader, ReadContext ctx, bool* ate_dot)
 {
-	static const char* const XSD_BOOLEAN     = NS_XSD "boolean";
-	static const size_t      XSD_BOOLEAN_LEN = 40;
-
 #ifndef NDEBUG
 	const size_t orig_stack_size = reader->stack.size;
 #endif
@@ -1188,8 +1333,7 @@ read_object(SerdReader* reader, ReadContext ctx, bool* ate_dot)
 		if ((node->n_bytes == 4 && !memcmp(node->buf, "true", 4)) ||
 		    (node->n_bytes == 5 && !memcmp(node->buf, "false", 5))) {
 			node->type = SERD_LITERAL;
-			datatype   = push_node(
-				reader, SERD_URI, XSD_BOOLEAN, XSD_BOOLEAN_LEN);
+			datatype   = VOCAB_REF(SERD_XSD_BOOLEAN);
 			ret = true;
 		} else if (read_PN_PREFIX_tail(reader, o) > SERD_FAILURE) {
 			ret = false;
@@ -1271,7 +1415,7 @@ read_collection(SerdReader* reader, ReadContext ctx, Ref* dest)
 {
 	eat_byte_safe(reader, '(');
 	bool end = peek_delim(reader, ')');
-	*dest = end ? reader->rdf_nil : blank_id(reader);
+	*dest = end ? VOCAB_REF(SERD_RDF_NIL) : blank_id(reader);
 	if (ctx.subject) {
 		// subject predicate _:head
 		*ctx.flags |= (end ? 0 : SERD_LIST_O_BEGIN);
@@ -1295,7 +1439,7 @@ read_collection(SerdReader* reader, ReadContext ctx, Ref* dest)
 	ctx.subject = *dest;
 	while (!(end = peek_delim(reader, ')'))) {
 		// _:node rdf:first object
-		ctx.predicate = reader->rdf_first;
+		ctx.predicate = VOCAB_REF(SERD_RDF_FIRST);
 		bool ate_dot = false;
 		if (!read_object(reader, ctx, &ate_dot) || ate_dot) {
 			return end_collection(reader, ctx, n1, n2, false);
@@ -1313,9 +1457,9 @@ read_collection(SerdReader* reader, ReadContext ctx, Ref* dest)
 
 		// _:node rdf:rest _:rest
 		*ctx.flags |= SERD_LIST_CONT;
-		ctx.predicate = reader->rdf_rest;
+		ctx.predicate = VOCAB_REF(SERD_RDF_REST);
 		TRY_RET(emit_statement(reader, ctx,
-		                       (end ? reader->rdf_nil : rest), 0, 0));
+		                       (end ? VOCAB_REF(SERD_RDF_NIL) : rest), 0, 0));
 
 		ctx.subject = rest;         // _:node = _:rest
 		rest        = node;         // _:rest = (old)_:node
@@ -1384,7 +1528,9 @@ read_base(SerdReader* reader)
 	Ref uri;
 	TRY_RET(uri = read_IRIREF(reader));
 	if (reader->base_sink) {
+		const double start = stats_now(reader);
 		reader->base_sink(reader->handle, deref(reader, uri));
+		stats_end_sink(reader, start);
 	}
 	pop_node(reader, uri);
 	return true;
@@ -1416,9 +1562,11 @@ read_prefixID(SerdReader* reader)
 	}
 
 	if (reader->prefix_sink) {
+		const double start = stats_now(reader);
 		ret = !reader->prefix_sink(reader->handle,
 		                           deref(reader, name),
 		                           deref(reader, uri));
+		stats_end_sink(reader, start);
 	}
 	pop_node(reader, uri);
 	pop_node(reader, name);
@@ -1484,39 +1632,71 @@ serd_reader_new(SerdSyntax        syntax,
                 SerdPrefixSink    prefix_sink,
                 SerdStatementSink statement_sink,
                 SerdEndSink       end_sink)
+{
+	return serd_reader_new_with_allocator(NULL,
+	                                      syntax,
+	                                      handle,
+	                                      free_handle,
+	                                      base_sink,
+	                                      prefix_sink,
+	                                      statement_sink,
+	                                      end_sink);
+}
+
+SERD_API
+SerdReader*
+serd_reader_new_with_allocator(const SerdAllocator* allocator,
+                               SerdSyntax           syntax,
+                               void*                handle,
+                               void                 (*free_handle)(void*),
+                               SerdBaseSink         base_sink,
+                               SerdPrefixSink       prefix_sink,
+                               SerdStatementSink    statement_sink,
+                               SerdEndSink          end_sink)
 {
 	const Cursor cur = { NULL, 0, 0 };
-	SerdReader*  me  = (SerdReader*)malloc(sizeof(struct SerdReaderImpl));
-	me->handle           = handle;
-	me->free_handle      = free_handle;
-	me->base_sink        = base_sink;
-	me->prefix_sink      = prefix_sink;
-	me->statement_sink   = statement_sink;
-	me->end_sink         = end_sink;
-	me->error_sink       = NULL;
-	me->error_handle     = NULL;
-	me->default_graph    = SERD_NODE_NULL;
-	me->fd               = 0;
-	me->stack            = serd_stack_new(SERD_PAGE_SIZE);
-	me->syntax           = syntax;
-	me->cur              = cur;
-	me->bprefix          = NULL;
-	me->bprefix_len      = 0;
-	me->next_id          = 1;
-	me->read_buf         = 0;
-	me->file_buf         = 0;
-	me->read_head        = 0;
-	me->strict           = false;
-	me->eof              = false;
-	me->seen_genid       = false;
+	SerdReader*  me  = (SerdReader*)serd_malloc(
+		allocator, sizeof(struct SerdReaderImpl));
+	if (!me) {
+		return NULL;
+	}
+
+	me->allocator          = allocator;
+	me->handle             = handle;
+	me->free_handle        = free_handle;
+	me->base_sink          = base_sink;
+	me->prefix_sink        = prefix_sink;
+	me->statement_sink     = statement_sink;
+	me->end_sink           = end_sink;
+	me->error_sink         = NULL;
+	me->error_handle       = NULL;
+	me->literal_begin_sink = NULL;
+	me->literal_chunk_sink = NULL;
+	me->literal_end_sink   = NULL;
+	me->literal_limit      = 0;
+	me->default_graph      = SERD_NODE_NULL;
+	me->fd                 = 0;
+	me->stack              = serd_stack_new(allocator, SERD_PAGE_SIZE);
+	me->syntax             = syntax;
+	me->cur                = cur;
+	me->bprefix            = NULL;
+	me->bprefix_len        = 0;
+	me->next_id            = 1;
+	me->read_buf           = 0;
+	me->file_buf           = 0;
+	me->n_read             = 0;
+	me->read_head          = 0;
+	me->strict             = false;
+	me->eof                = false;
+	me->seen_genid         = false;
+	me->timing             = false;
 #ifdef SERD_STACK_CHECK
-	me->allocs           = 0;
-	me->n_allocs         = 0;
+	me->allocs             = 0;
+	me->n_allocs           = 0;
+#endif
+#ifndef SERD_NO_STATS
+	memset(&me->stats, 0, sizeof(me->stats));
 #endif
-
-	me->rdf_first = push_node(me, SERD_URI, NS_RDF "first", 48);
-	me->rdf_rest  = push_node(me, SERD_URI, NS_RDF "rest", 47);
-	me->rdf_nil   = push_node(me, SERD_URI, NS_RDF "nil", 46);
 
 	return me;
 }
@@ -1528,6 +1708,13 @@ serd_reader_set_strict(SerdReader* reader, bool strict)
 	reader->strict = strict;
 }
 
+SERD_API
+void
+serd_reader_set_timing(SerdReader* reader, bool timing)
+{
+	reader->timing = timing;
+}
+
 SERD_API
 void
 serd_reader_set_error_sink(SerdReader*   reader,
@@ -1538,24 +1725,37 @@ serd_reader_set_error_sink(SerdReader*   reader,
 	reader->error_handle = error_handle;
 }
 
+SERD_API
+void
+serd_reader_set_literal_sink(SerdReader*          reader,
+                             size_t               threshold,
+                             SerdLiteralBeginSink begin_sink,
+                             SerdLiteralChunkSink chunk_sink,
+                             SerdLiteralEndSink   end_sink)
+{
+	reader->literal_begin_sink = begin_sink;
+	reader->literal_chunk_sink = chunk_sink;
+	reader->literal_end_sink   = end_sink;
+	reader->literal_limit      = threshold;
+}
+
 SERD_API
 void
 serd_reader_free(SerdReader* reader)
 {
-	pop_node(reader, reader->rdf_nil);
-	pop_node(reader, reader->rdf_rest);
-	pop_node(reader, reader->rdf_first);
-	serd_node_free(&reader->default_graph);
+	const SerdAllocator* const allocator = reader->allocator;
+
+	serd_node_free_with_allocator(allocator, &reader->default_graph);
 
 #ifdef SERD_STACK_CHECK
-	free(reader->allocs);
+	serd_free(allocator, reader->allocs);
 #endif
-	free(reader->stack.buf);
-	free(reader->bprefix);
+	serd_stack_free(&reader->stack);
+	serd_free(allocator, reader->bprefix);
 	if (reader->free_handle) {
 		reader->free_handle(reader->handle);
 	}
-	free(reader);
+	serd_free(allocator, reader);
 }
 
 SERD_API
@@ -1570,12 +1770,13 @@ void
 serd_reader_add_blank_prefix(SerdReader*    reader,
                              const uint8_t* prefix)
 {
-	free(reader->bprefix);
+	serd_free(reader->allocator, reader->bprefix);
 	reader->bprefix_len = 0;
 	reader->bprefix     = NULL;
 	if (prefix) {
 		reader->bprefix_len = strlen((const char*)prefix);
-		reader->bprefix     = (uint8_t*)malloc(reader->bprefix_len + 1);
+		reader->bprefix     = (uint8_t*)serd_malloc(
+			reader->allocator, reader->bprefix_len + 1);
 		memcpy(reader->bprefix, prefix, reader->bprefix_len + 1);
 	}
 }
@@ -1585,8 +1786,9 @@ void
 serd_reader_set_default_graph(SerdReader*     reader,
                               const SerdNode* graph)
 {
-	serd_node_free(&reader->default_graph);
-	reader->default_graph = serd_node_copy(graph);
+	serd_node_free_with_allocator(reader->allocator, &reader->default_graph);
+	reader->default_graph = serd_node_copy_with_allocator(
+		reader->allocator, graph);
 }
 
 SERD_API
@@ -1617,6 +1819,7 @@ skip_bom(SerdReader* me)
 	const uint8_t* const b = me->read_buf;
 	if (me->paging && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) {
 		me->read_head += 3;
+		me->n_read    += 3;
 	}
 }
 
@@ -1628,7 +1831,9 @@ serd_reader_start_stream(SerdReader*    me,
                          bool           bulk)
 {
 	const Cursor cur = { name, 1, 1 };
+	SERD_STAT_ADD(me, n_bytes, me->n_read);
 	me->fd        = file;
+	me->n_read    = 0;
 	me->read_head = 0;
 	me->cur       = cur;
 	me->from_file = true;
@@ -1636,7 +1841,8 @@ serd_reader_start_stream(SerdReader*    me,
 	me->paging    = bulk;
 
 	if (bulk) {
-		me->file_buf = (uint8_t*)serd_bufalloc(SERD_PAGE_SIZE);
+		me->file_buf = (uint8_t*)serd_bufalloc_with(
+			me->allocator, SERD_PAGE_SIZE);
 		me->read_buf = me->file_buf;
 		memset(me->file_buf, '\0', SERD_PAGE_SIZE);
 		SerdStatus st = page(me);
@@ -1657,7 +1863,7 @@ SERD_API
 SerdStatus
 serd_reader_read_chunk(SerdReader* me)
 {
-	if (!me->read_byte) {
+	if (!me->paging && !me->read_byte) {
 		// Read initial byte
 		const int c = fgetc(me->fd);
 		me->read_byte = (c == EOF) ? 0 : (uint8_t)c;
@@ -1665,8 +1871,44 @@ serd_reader_read_chunk(SerdReader* me)
 			me->eof = true;
 			return SERD_FAILURE;
 		}
+	} else if (me->eof) {
+		return SERD_FAILURE;
+	}
+
+	const double start = stats_now(me);
+	read_ws_star(me);
+	if (peek_byte(me) == '\0') {
+		me->eof = true;
+		stats_end_read(me, start);
+		return SERD_FAILURE;
 	}
-	return read_statement(me) ? SERD_SUCCESS : SERD_FAILURE;
+
+	const bool ret = read_statement(me);
+	stats_end_read(me, start);
+	return ret ? SERD_SUCCESS : SERD_ERR_BAD_SYNTAX;
+}
+
+SERD_API
+size_t
+serd_reader_get_offset(const SerdReader* me)
+{
+	return me->n_read;
+}
+
+SERD_API
+SerdReaderStats
+serd_reader_get_stats(const SerdReader* reader)
+{
+#ifndef SERD_NO_STATS
+	SerdReaderStats stats = reader->stats;
+	stats.n_bytes    += reader->n_read;
+	stats.parse_time -= stats.sink_time;
+	return stats;
+#else
+	const SerdReaderStats stats = { 0, 0, 0, 0, 0, 0, 0, 0.0, 0.0 };
+	(void)reader;
+	return stats;
+#endif
 }
 
 SERD_API
@@ -1674,7 +1916,7 @@ SerdStatus
 serd_reader_end_stream(SerdReader* me)
 {
 	if (me->paging) {
-		free(me->file_buf);
+		serd_free(me->allocator, me->file_buf);
 	}
 	me->fd       = NULL;
 	me->read_buf = me->file_buf = NULL;
@@ -1685,11 +1927,13 @@ SERD_API
 SerdStatus
 serd_reader_read_file_handle(SerdReader* me, FILE* file, const uint8_t* name)
 {
-	SerdStatus st = serd_reader_start_stream(me, file, name, true);
+	const double start = stats_now(me);
+	SerdStatus   st    = serd_reader_start_stream(me, file, name, true);
 	if (!st) {
 		st = read_turtleDoc(me) ? SERD_SUCCESS : SERD_ERR_UNKNOWN;
 		serd_reader_end_stream(me);
 	}
+	stats_end_read(me, start);
 	return st;
 }
 
@@ -1697,9 +1941,12 @@ SERD_API
 SerdStatus
 serd_reader_read_string(SerdReader* me, const uint8_t* utf8)
 {
-	const Cursor cur = { (const uint8_t*)"(string)", 1, 1 };
+	const Cursor cur   = { (const uint8_t*)"(string)", 1, 1 };
+	const double start = stats_now(me);
 
+	SERD_STAT_ADD(me, n_bytes, me->n_read);
 	me->read_buf  = utf8;
+	me->n_read    = 0;
 	me->read_head = 0;
 	me->cur       = cur;
 	me->from_file = false;
@@ -1710,5 +1957,6 @@ serd_reader_read_string(SerdReader* me, const uint8_t* utf8)
 	const bool ret = read_turtleDoc(me);
 
 	me->read_buf = NULL;
+	stats_end_read(me, start);
 	return ret ? SERD_SUCCESS : SERD_ERR_UNKNOWN;
 }
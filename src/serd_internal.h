@@ -66,23 +66,72 @@ serd_bufalloc(size_t size)
 #endif
 }
 
+/* Allocation */
+
+static inline void*
+serd_malloc(const SerdAllocator* allocator, size_t size)
+{
+	return allocator ? allocator->allocate(allocator->handle, size)
+	                 : malloc(size);
+}
+
+static inline void*
+serd_calloc(const SerdAllocator* allocator, size_t nmemb, size_t size)
+{
+	if (!allocator) {
+		return calloc(nmemb, size);
+	}
+
+	void* const ptr = allocator->allocate(allocator->handle, nmemb * size);
+	if (ptr) {
+		memset(ptr, 0, nmemb * size);
+	}
+	return ptr;
+}
+
+static inline void*
+serd_realloc(const SerdAllocator* allocator, void* ptr, size_t size)
+{
+	return allocator ? allocator->reallocate(allocator->handle, ptr, size)
+	                 : realloc(ptr, size);
+}
+
+static inline void
+serd_free(const SerdAllocator* allocator, void* ptr)
+{
+	if (allocator) {
+		allocator->deallocate(allocator->handle, ptr);
+	} else {
+		free(ptr);
+	}
+}
+
+/** Allocate a page-aligned buffer, or an unaligned one from `allocator`. */
+static inline void*
+serd_bufalloc_with(const SerdAllocator* allocator, size_t size)
+{
+	return allocator ? serd_malloc(allocator, size) : serd_bufalloc(size);
+}
+
 /* Stack */
 
 /** A dynamic stack in memory. */
 typedef struct {
-	uint8_t* buf;       ///< Stack memory
-	size_t   buf_size;  ///< Allocated size of buf (>= size)
-	size_t   size;      ///< Conceptual size of stack in buf
+	const SerdAllocator* allocator;  ///< Allocator for buf, or NULL
+	uint8_t*             buf;        ///< Stack memory
+	size_t               buf_size;   ///< Allocated size of buf (>= size)
+	size_t               size;       ///< Conceptual size of stack in buf
 } SerdStack;
 
 /** An offset to start the stack at. Note 0 is reserved for NULL. */
 #define SERD_STACK_BOTTOM sizeof(void*)
 
 static inline SerdStack
-serd_stack_new(size_t size)
+serd_stack_new(const SerdAllocator* allocator, size_t size)
 {
 	SerdStack stack;
-	stack.buf       = (uint8_t*)malloc(size);
+	stack.allocator = allocator;
+	stack.buf       = (uint8_t*)serd_malloc(allocator, size);
 	stack.buf_size  = size;
 	stack.size      = SERD_STACK_BOTTOM;
 	return stack;
@@ -97,7 +146,7 @@ serd_stack_is_empty(SerdStack* stack)
 static inline void
 serd_stack_free(SerdStack* stack)
 {
-	free(stack->buf);
+	serd_free(stack->allocator, stack->buf);
 	stack->buf      = NULL;
 	stack->buf_size = 0;
 	stack->size     = 0;
@@ -108,8 +157,11 @@ serd_stack_push(SerdStack* stack, size_t n_bytes)
 {
 	const size_t new_size = stack->size + n_bytes;
 	if (stack->buf_size < new_size) {
-		stack->buf_size *= 2;
-		stack->buf = (uint8_t*)realloc(stack->buf, stack->buf_size);
+		while (stack->buf_size < new_size) {
+			stack->buf_size *= 2;
+		}
+		stack->buf = (uint8_t*)serd_realloc(
+			stack->allocator, stack->buf, stack->buf_size);
 	}
 	uint8_t* const ret = (stack->buf + stack->size);
 	stack->size = new_size;
@@ -126,22 +178,27 @@ serd_stack_pop(SerdStack* stack, size_t n_bytes)
 /* Bulk Sink */
 
 typedef struct SerdBulkSinkImpl {
-	SerdSink sink;
-	void*    stream;
-	uint8_t* buf;
-	size_t   size;
-	size_t   block_size;
+	const SerdAllocator* allocator;
+	SerdSink             sink;
+	void*                stream;
+	uint8_t*             buf;
+	size_t               size;
+	size_t               block_size;
 } SerdBulkSink;
 
 static inline SerdBulkSink
-serd_bulk_sink_new(SerdSink sink, void* stream, size_t block_size)
+serd_bulk_sink_new(const SerdAllocator* allocator,
+                   SerdSink             sink,
+                   void*                stream,
+                   size_t               block_size)
 {
 	SerdBulkSink bsink;
+	bsink.allocator  = allocator;
 	bsink.sink       = sink;
 	bsink.stream     = stream;
 	bsink.size       = 0;
 	bsink.block_size = block_size;
-	bsink.buf        = (uint8_t*)serd_bufalloc(block_size);
+	bsink.buf        = (uint8_t*)serd_bufalloc_with(allocator, block_size);
 	return bsink;
 }
 
@@ -158,13 +215,20 @@ static inline void
 serd_bulk_sink_free(SerdBulkSink* bsink)
 {
 	serd_bulk_sink_flush(bsink);
-	free(bsink->buf);
+	serd_free(bsink->allocator, bsink->buf);
 	bsink->buf = NULL;
 }
 
 static inline size_t
 serd_bulk_sink_write(const void* buf, size_t len, SerdBulkSink* bsink)
 {
+	if (len < bsink->block_size - bsink->size) {
+		// Fast path for small writes that fit in the remaining space
+		memcpy(bsink->buf + bsink->size, buf, len);
+		bsink->size += len;
+		return len;
+	}
+
 	const size_t orig_len = len;
 	while (len) {
 		const size_t space = bsink->block_size - bsink->size;
@@ -185,6 +249,64 @@ serd_bulk_sink_write(const void* buf, size_t len, SerdBulkSink* bsink)
 	return orig_len;
 }
 
+/* Buffer */
+
+/** A growing string allocated with an allocator (like serd_chunk_sink). */
+typedef struct {
+	const SerdAllocator* allocator;
+	SerdChunk            chunk;
+} SerdBuffer;
+
+static inline size_t
+serd_buffer_sink(const void* buf, size_t len, void* stream)
+{
+	SerdBuffer* const buffer = (SerdBuffer*)stream;
+	uint8_t* const    mem    = (uint8_t*)serd_realloc(
+		buffer->allocator, (uint8_t*)buffer->chunk.buf, buffer->chunk.len + len);
+	if (!mem) {
+		return 0;
+	}
+
+	memcpy(mem + buffer->chunk.len, buf, len);
+	buffer->chunk.buf  = mem;
+	buffer->chunk.len += len;
+	return len;
+}
+
+static inline uint8_t*
+serd_buffer_sink_finish(SerdBuffer* buffer)
+{
+	serd_buffer_sink("", 1, buffer);
+	return (uint8_t*)buffer->chunk.buf;
+}
+
+/* Hashing */
+
+#define SERD_HASH_SEED 14695981039346656037ULL  ///< 64-bit FNV offset basis
+
+/** Return the 64-bit FNV-1a hash of `len` bytes at `buf` continuing `hash`. */
+static inline uint64_t
+serd_hash_bytes(uint64_t hash, const void* buf, size_t len)
+{
+	const uint8_t* const bytes = (const uint8_t*)buf;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+/** Mix `hash` so that every bit depends on every input byte. */
+static inline uint64_t
+serd_hash_finish(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
 /* Character utilities */
 
 /** Return true if `c` lies within [`min`...`max`] (inclusive) */
@@ -282,6 +404,40 @@ uri_is_under(const SerdURI* uri, const SerdURI* root)
 	return true;
 }
 
+/* Well-known vocabulary */
+
+#define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
+#define NS_XSD "http://www.w3.org/2001/XMLSchema#"
+
+typedef enum {
+	SERD_RDF_FIRST,
+	SERD_RDF_NIL,
+	SERD_RDF_REST,
+	SERD_RDF_TYPE,
+	SERD_XSD_BOOLEAN,
+	SERD_XSD_DECIMAL,
+	SERD_XSD_DOUBLE,
+	SERD_XSD_INTEGER,
+	SERD_N_VOCAB
+} SerdVocab;
+
+/** Shared nodes for well-known URIs, indexed by SerdVocab. */
+extern const SerdNode serd_vocab[SERD_N_VOCAB];
+
+/**
+   Return true iff `node` is the well-known URI `id`.
+
+   This is a pointer comparison for nodes from the reader, which emits nodes
+   from serd_vocab, otherwise a length check and memcmp().
+*/
+static inline bool
+serd_node_is_vocab(const SerdNode* node, SerdVocab id)
+{
+	const SerdNode* const v = &serd_vocab[id];
+	return node == v || (node->n_bytes == v->n_bytes &&
+	                     !memcmp(node->buf, v->buf, v->n_bytes));
+}
+
 /* Error reporting */
 
 static inline void
@@ -18,8 +18,14 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD
+#    include <pthread.h>
+#endif
 
 #define SERDI_ERROR(msg)       fprintf(stderr, "serdi: " msg);
 #define SERDI_ERRORF(fmt, ...) fprintf(stderr, "serdi: " fmt, __VA_ARGS__);
@@ -27,8 +33,97 @@
 typedef struct {
 	SerdEnv*    env;
 	SerdWriter* writer;
+	SerdSorter* sorter;
+	SerdFilter* filter;
 } State;
 
+/** Output partitioned into several files by subject (see -P). */
+typedef struct {
+	SerdWriter**     writers;
+	SerdPartitioner* partitioner;
+	SerdFilter*      filter;
+	unsigned         n_shards;
+} Shards;
+
+/** Options for converting an input. */
+typedef struct {
+	SerdSyntax         input_syntax;
+	SerdSyntax         output_syntax;
+	SerdStyle          output_style;
+	bool               bulk_read;
+	bool               sort;
+	bool               lax;
+	bool               quiet;
+	unsigned long      sort_mib;
+	const uint8_t*     chop_prefix;
+	const uint8_t*     root_uri;
+	const char* const* patterns;    ///< Filter patterns given with -M
+	unsigned           n_patterns;
+} Options;
+
+/** An input file converted by a worker. */
+typedef struct {
+	const uint8_t* arg;       ///< Input path or file URI
+	const uint8_t* path;      ///< Input path, or NULL if arg is not a file
+	char*          out_path;  ///< Output file in the output directory
+	SerdBuffer     output;    ///< Output waiting to be merged
+	SerdStatus     st;
+	bool           done;
+} Job;
+
+/**
+   Workers that convert several input files.
+
+   Each worker takes the next job in order until there are none left.  When
+   output is merged into a single stream, the output of each job is kept in
+   memory until all previous jobs have been written, so the merged output is
+   in the same order as the inputs.
+*/
+typedef struct {
+	const Options*  opts;
+	Job*            jobs;
+	size_t          n_jobs;
+	const SerdNode* base;         ///< Base URI for all inputs, or null
+	const uint8_t*  add_prefix;   ///< Blank node prefix given with -p
+	const char*     out_dir;      ///< Directory for outputs, or NULL to merge
+	SerdCompression compression;  ///< Compression of output files
+	SerdSink        sink;         ///< Sink for merged output
+	void*           stream;       ///< Stream for merged output
+	size_t          next_job;     ///< Index of the next job to start
+	size_t          next_out;     ///< Index of the next job to write
+	SerdStatus      out_st;       ///< Status of writing merged output
+#ifdef HAVE_PTHREAD
+	pthread_mutex_t mutex;
+#endif
+} Pool;
+
+/** Number of index bits in a HyperLogLog sketch. */
+#define SKETCH_BITS 14
+
+/**
+   HyperLogLog sketch for estimating the number of distinct values.
+
+   Each register holds the maximum rank (position of the first set bit) of the
+   hashes that were mapped to it.  This uses constant memory regardless of
+   the number of values, with a standard error of about 1%.
+*/
+typedef struct {
+	uint8_t registers[1 << SKETCH_BITS];
+} Sketch;
+
+/** Statistics gathered when reading with -S. */
+typedef struct {
+	size_t n_statements;
+	size_t n_prefixes;
+	size_t n_literal_bytes;  ///< Total size of literals
+	size_t n_uri_bytes;      ///< Total size of URIs and CURIEs
+	size_t depth;            ///< Current anonymous node nesting depth
+	size_t max_depth;        ///< Maximum anonymous node nesting depth
+	Sketch subjects;
+	Sketch predicates;
+	Sketch objects;
+} Stats;
+
 static int
 print_version(void)
 {
@@ -46,21 +141,39 @@ print_usage(const char* name, bool error)
 	FILE* const os = error ? stderr : stdout;
 	fprintf(os, "%s", error ? "\n" : "");
 	fprintf(os, "Usage: %s [OPTION]... INPUT [BASE_URI]\n", name);
+	fprintf(os, "       %s [OPTION]... INPUT...\n", name);
 	fprintf(os, "Read and write RDF syntax.\n");
-	fprintf(os, "Use - for INPUT to read from standard input.\n\n");
+	fprintf(os, "Use - for INPUT to read from standard input.\n");
+	fprintf(os, "All arguments are inputs if there are more than two, or if\n"
+	        "-B or -O is given.\n\n");
+	fprintf(os, "  -a           Write output asynchronously on a separate thread.\n");
 	fprintf(os, "  -b           Fast bulk output for large serialisations.\n");
+	fprintf(os, "  -B BASE_URI  Base URI for all inputs.\n");
 	fprintf(os, "  -c PREFIX    Chop PREFIX from matching blank node IDs.\n");
+	fprintf(os, "  -C FORMAT    Compress output (`gzip' or `zstd').\n");
 	fprintf(os, "  -e           Eat input one character at a time.\n");
 	fprintf(os, "  -f           Keep full URIs in input (don't qualify).\n");
+	fprintf(os, "  -g           Group output statements by subject (sort).\n");
 	fprintf(os, "  -h           Display this help and exit.\n");
 	fprintf(os, "  -i SYNTAX    Input syntax (`turtle' or `ntriples').\n");
+	fprintf(os, "  -j N         Convert inputs and compress output on N threads.\n");
+	fprintf(os, "  -k N         Start reading at checkpoint N of index (see -X).\n");
 	fprintf(os, "  -l           Lax (non-strict) parsing.\n");
+	fprintf(os, "  -L           Like -S, but only count lines of NTriples input.\n");
+	fprintf(os, "  -m MIB       Memory limit for sorting with -g (default 64).\n");
+	fprintf(os, "  -M PATTERN   Only write statements that match PATTERN (see man page).\n");
 	fprintf(os, "  -o SYNTAX    Output syntax (`turtle' or `ntriples').\n");
+	fprintf(os, "  -O DIR       Write the output of each input to a file in DIR.\n");
 	fprintf(os, "  -p PREFIX    Add PREFIX to blank node IDs.\n");
+	fprintf(os, "  -P N         Partition output into N files by subject (see -w).\n");
 	fprintf(os, "  -q           Suppress all output except data.\n");
 	fprintf(os, "  -r ROOT_URI  Keep relative URIs within ROOT_URI.\n");
 	fprintf(os, "  -s INPUT     Parse INPUT as string (terminates options).\n");
+	fprintf(os, "  -S           Print statistics about the input instead of output.\n");
 	fprintf(os, "  -v           Display version information and exit.\n");
+	fprintf(os, "  -w FILE      Write output to FILE (compressed if *.gz or *.zst).\n");
+	fprintf(os, "  -x INTERVAL  Write an index of every INTERVAL statements and exit.\n");
+	fprintf(os, "  -X INDEX     Read from a position in INDEX (see -x and -k).\n");
 	return error ? 1 : 0;
 }
 
@@ -78,6 +191,78 @@ set_syntax(SerdSyntax* syntax, const char* name)
 	return true;
 }
 
+static bool
+set_compression(SerdCompression* format, const char* name)
+{
+	if (!strcmp(name, "gzip")) {
+		*format = SERD_GZIP;
+	} else if (!strcmp(name, "zstd")) {
+		*format = SERD_ZSTD;
+	} else {
+		SERDI_ERRORF("unknown compression format `%s'\n", name);
+		return false;
+	}
+	return true;
+}
+
+static SerdCompression
+guess_compression(const char* path)
+{
+	const char*     ext    = strrchr(path, '.');
+	SerdCompression format = (SerdCompression)0;
+	if (ext && !strcmp(ext, ".gz")) {
+		format = SERD_GZIP;
+	} else if (ext && !strcmp(ext, ".zst")) {
+		format = SERD_ZSTD;
+	}
+	return format;
+}
+
+/** Parse a filter pattern like "p=URI" and return the URI, or NULL. */
+static const char*
+parse_pattern(const char* str, SerdFilterField* field)
+{
+	static const char* const fields = "spogdl";
+
+	const char* const f = str[0] ? strchr(fields, str[0]) : NULL;
+	if (!f || str[1] != '=') {
+		return NULL;
+	}
+
+	*field = (SerdFilterField)(f - fields);
+	return str + 2;
+}
+
+/** Create a filter for the patterns in `opts` that passes on to `sink`. */
+static SerdFilter*
+new_filter(const Options*    opts,
+           SerdEnv*          env,
+           SerdStatementSink sink,
+           void*             handle)
+{
+	SerdFilter* const filter = serd_filter_new(env, sink, handle);
+	for (unsigned i = 0; i < opts->n_patterns; ++i) {
+		SerdFilterField   field = SERD_FILTER_SUBJECT;
+		const char* const value = parse_pattern(opts->patterns[i], &field);
+		const size_t      len   = strlen(value);
+		char* const       str   = (char*)calloc(len + 2, 1);
+		memcpy(str, value, len);
+		if (len && value[len - 1] == '*') {
+			str[len - 1] = '\0';
+			serd_filter_add_prefix(filter, field, (const uint8_t*)str);
+		} else if (field == SERD_FILTER_LANG) {
+			// Match the language and any subtags, like SPARQL langMatches
+			serd_filter_add_exact(filter, field, (const uint8_t*)str);
+			str[len] = '-';
+			serd_filter_add_prefix(filter, field, (const uint8_t*)str);
+		} else {
+			serd_filter_add_exact(filter, field, (const uint8_t*)str);
+		}
+		free(str);
+	}
+	return filter;
+}
+
 static int
 missing_arg(const char* name, char opt)
 {
@@ -91,6 +276,861 @@ quiet_error_sink(void* handle, const SerdError* e)
 	return SERD_SUCCESS;
 }
 
+static SerdStatus
+on_base(void* handle, const SerdNode* uri)
+{
+	return serd_writer_set_base_uri(((State*)handle)->writer, uri);
+}
+
+static SerdStatus
+on_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	return serd_writer_set_prefix(((State*)handle)->writer, name, uri);
+}
+
+static SerdStatus
+on_statement(void*              handle,
+             SerdStatementFlags flags,
+             const SerdNode*    graph,
+             const SerdNode*    subject,
+             const SerdNode*    predicate,
+             const SerdNode*    object,
+             const SerdNode*    object_datatype,
+             const SerdNode*    object_lang)
+{
+	const State* const state = (const State*)handle;
+	if (state->filter) {
+		return serd_filter_write_statement(state->filter, flags, graph,
+		                                   subject, predicate, object,
+		                                   object_datatype, object_lang);
+	}
+	return serd_sorter_add_statement(state->sorter, flags, graph,
+	                                 subject, predicate, object,
+	                                 object_datatype, object_lang);
+}
+
+/** Read a document from `in_fd`, or the string `str` if it is NULL. */
+static SerdStatus
+read_input(const Options* opts,
+           SerdReader*    reader,
+           FILE*          in_fd,
+           const uint8_t* str,
+           const uint8_t* in_name)
+{
+	SerdStatus st = SERD_SUCCESS;
+	if (!in_fd) {
+		st = serd_reader_read_string(reader, str);
+	} else if (opts->bulk_read) {
+		st = serd_reader_read_file_handle(reader, in_fd, in_name);
+	} else {
+		st = serd_reader_start_stream(reader, in_fd, in_name, false);
+		while (!st) {
+			st = serd_reader_read_chunk(reader);
+		}
+		serd_reader_end_stream(reader);
+	}
+	return st;
+}
+
+/**
+   Read a document from `in_fd`, or the string `str`, and write it to `sink`.
+
+   Relative URIs in the input are resolved against `base`, and written
+   relative to `out_base`.  If `write_base` is true, `base` is written first
+   so the output does not depend on any preceding output.  If `index` is
+   given, reading starts at `checkpoint`.
+*/
+static SerdStatus
+convert(const Options*  opts,
+        FILE*           in_fd,
+        const uint8_t*  str,
+        const uint8_t*  in_name,
+        const SerdNode* base,
+        const SerdURI*  out_base,
+        bool            write_base,
+        const uint8_t*  blank_prefix,
+        SerdIndex*      index,
+        unsigned long   checkpoint,
+        SerdSink        sink,
+        void*           stream)
+{
+	SerdEnv*    env    = serd_env_new(base);
+	SerdWriter* writer = serd_writer_new(
+		opts->output_syntax, opts->output_style,
+		env, out_base, sink, stream);
+
+	State       state  = { env, writer, NULL, NULL };
+	SerdReader* reader = NULL;
+	if (opts->sort) {
+		// Send statements through a sorter, and directives to the writer
+		state.sorter = serd_sorter_new(
+			env, opts->sort_mib * 1024 * 1024,
+			(SerdStatementSink)serd_writer_write_statement, writer);
+	}
+	if (opts->n_patterns) {
+		// Drop statements that don't match before they are sorted or written
+		state.filter = state.sorter
+			? new_filter(opts, env,
+			             (SerdStatementSink)serd_sorter_add_statement,
+			             state.sorter)
+			: new_filter(opts, env,
+			             (SerdStatementSink)serd_writer_write_statement,
+			             writer);
+	}
+
+	if (state.sorter || state.filter) {
+		reader = serd_reader_new(
+			opts->input_syntax, &state, NULL,
+			on_base, on_prefix, on_statement, NULL);
+	} else {
+		reader = serd_reader_new(
+			opts->input_syntax, writer, NULL,
+			(SerdBaseSink)serd_writer_set_base_uri,
+			(SerdPrefixSink)serd_writer_set_prefix,
+			(SerdStatementSink)serd_writer_write_statement,
+			(SerdEndSink)serd_writer_end_anon);
+	}
+
+	serd_reader_set_strict(reader, !opts->lax);
+	if (opts->quiet) {
+		serd_reader_set_error_sink(reader, quiet_error_sink, NULL);
+		serd_writer_set_error_sink(writer, quiet_error_sink, NULL);
+	}
+
+	if (write_base) {
+		serd_writer_set_base_uri(writer, base);
+	}
+
+	SerdNode root = serd_node_from_string(SERD_URI, opts->root_uri);
+	serd_writer_set_root_uri(writer, &root);
+	serd_writer_chop_blank_prefix(writer, opts->chop_prefix);
+	serd_reader_add_blank_prefix(reader, blank_prefix);
+
+	SerdStatus status = SERD_SUCCESS;
+	if (index) {
+		status = serd_index_seek(index, checkpoint, in_fd,
+		                         (SerdBaseSink)serd_writer_set_base_uri,
+		                         (SerdPrefixSink)serd_writer_set_prefix,
+		                         writer);
+	}
+
+	if (status) {
+		SERDI_ERRORF("failed to seek to checkpoint %lu\n", checkpoint);
+	} else {
+		status = read_input(opts, reader, in_fd, str, in_name);
+	}
+
+	serd_reader_free(reader);
+	serd_filter_free(state.filter);
+
+	if (state.sorter) {
+		const SerdStatus st = serd_sorter_finish(state.sorter);
+		status = status ? status : st;
+		serd_sorter_free(state.sorter);
+	}
+
+	serd_writer_finish(writer);
+	serd_writer_free(writer);
+	serd_env_free(env);
+	return status;
+}
+
+static SerdStatus
+on_shards_base(void* handle, const SerdNode* uri)
+{
+	const Shards* const shards = (const Shards*)handle;
+	SerdStatus          st     = SERD_SUCCESS;
+	for (unsigned i = 0; i < shards->n_shards && !st; ++i) {
+		st = serd_writer_set_base_uri(shards->writers[i], uri);
+	}
+	return st;
+}
+
+static SerdStatus
+on_shards_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	const Shards* const shards = (const Shards*)handle;
+	SerdStatus          st     = SERD_SUCCESS;
+	for (unsigned i = 0; i < shards->n_shards && !st; ++i) {
+		st = serd_writer_set_prefix(shards->writers[i], name, uri);
+	}
+	return st;
+}
+
+static SerdStatus
+on_shards_statement(void*              handle,
+                    SerdStatementFlags flags,
+                    const SerdNode*    graph,
+                    const SerdNode*    subject,
+                    const SerdNode*    predicate,
+                    const SerdNode*    object,
+                    const SerdNode*    object_datatype,
+                    const SerdNode*    object_lang)
+{
+	const Shards* const shards = (const Shards*)handle;
+	if (shards->filter) {
+		return serd_filter_write_statement(
+			shards->filter, flags, graph,
+			subject, predicate, object, object_datatype, object_lang);
+	}
+	return serd_partitioner_write_statement(
+		shards->partitioner, flags, graph,
+		subject, predicate, object, object_datatype, object_lang);
+}
+
+static SerdStatus
+on_shards_end(void* handle, const SerdNode* node)
+{
+	const Shards* const shards = (const Shards*)handle;
+	return shards->filter  // Filtered statements have no anonymous nodes
+		? SERD_SUCCESS
+		: serd_partitioner_end_anon(shards->partitioner, node);
+}
+
+/** Return the path of shard `i` of `path`, like "out.3.nt" for "out.nt". */
+static char*
+shard_path(const char* path, unsigned i)
+{
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+
+	const char* ext = strchr(name, '.');
+	if (!ext || ext == name) {
+		ext = path + strlen(path);
+	}
+
+	const size_t len = strlen(path) + 16;
+	char* const  out = (char*)malloc(len);
+	snprintf(out, len, "%.*s.%u%s", (int)(ext - path), path, i, ext);
+	return out;
+}
+
+/**
+   Read a document and write it to `n_shards` files partitioned by subject.
+
+   Each shard has its own writer, which buffers output, and the files are
+   named after `out_path` (see shard_path()).
+*/
+static SerdStatus
+convert_shards(const Options*  opts,
+               FILE*           in_fd,
+               const uint8_t*  str,
+               const uint8_t*  in_name,
+               const SerdNode* base,
+               const SerdURI*  out_base,
+               const uint8_t*  blank_prefix,
+               const char*     out_path,
+               unsigned        n_shards,
+               SerdCompression compression)
+{
+	if (compression && !serd_compression_supported(compression)) {
+		SERDI_ERROR("compression format not supported by this build\n");
+		return SERD_ERR_BAD_ARG;
+	}
+
+	FILE**           files   = (FILE**)calloc(n_shards, sizeof(FILE*));
+	SerdCompressor** comps   = (SerdCompressor**)calloc(
+		n_shards, sizeof(SerdCompressor*));
+	SerdEnv**        envs    = (SerdEnv**)calloc(n_shards, sizeof(SerdEnv*));
+	SerdWriter**     writers = (SerdWriter**)calloc(
+		n_shards, sizeof(SerdWriter*));
+
+	SerdStatus st = SERD_SUCCESS;
+	for (unsigned i = 0; i < n_shards && !st; ++i) {
+		char* const path = shard_path(out_path, i);
+		if (!(files[i] = serd_fopen(path, "wb"))) {
+			st = SERD_ERR_UNKNOWN;
+			free(path);
+			break;
+		}
+		free(path);
+
+		SerdSink sink   = serd_file_sink;
+		void*    stream = files[i];
+		if (compression) {
+			comps[i] = serd_compressor_new(compression, 0, 1, sink, stream);
+			sink     = serd_compressor_sink;
+			stream   = comps[i];
+		}
+
+		envs[i]    = serd_env_new(base);
+		writers[i] = serd_writer_new(opts->output_syntax, opts->output_style,
+		                             envs[i], out_base, sink, stream);
+		if (opts->quiet) {
+			serd_writer_set_error_sink(writers[i], quiet_error_sink, NULL);
+		}
+
+		SerdNode root = serd_node_from_string(SERD_URI, opts->root_uri);
+		serd_writer_set_root_uri(writers[i], &root);
+		serd_writer_chop_blank_prefix(writers[i], opts->chop_prefix);
+	}
+
+	if (!st) {
+		// Directives go to every shard, and statements to one by subject
+		Shards shards = {
+			writers,
+			serd_partitioner_new(
+				envs[0], n_shards,
+				(SerdStatementSink)serd_writer_write_statement,
+				(SerdEndSink)serd_writer_end_anon,
+				(void* const*)writers),
+			NULL,
+			n_shards };
+
+		if (opts->n_patterns) {
+			shards.filter = new_filter(
+				opts, envs[0],
+				(SerdStatementSink)serd_partitioner_write_statement,
+				shards.partitioner);
+		}
+
+		SerdReader* reader = serd_reader_new(
+			opts->input_syntax, &shards, NULL,
+			on_shards_base, on_shards_prefix,
+			on_shards_statement, on_shards_end);
+
+		serd_reader_set_strict(reader, !opts->lax);
+		if (opts->quiet) {
+			serd_reader_set_error_sink(reader, quiet_error_sink, NULL);
+		}
+		serd_reader_add_blank_prefix(reader, blank_prefix);
+
+		st = read_input(opts, reader, in_fd, str, in_name);
+		serd_reader_free(reader);
+		serd_filter_free(shards.filter);
+		serd_partitioner_free(shards.partitioner);
+	}
+
+	for (unsigned i = 0; i < n_shards; ++i) {
+		if (writers[i]) {
+			serd_writer_finish(writers[i]);
+			serd_writer_free(writers[i]);
+			serd_env_free(envs[i]);
+		}
+		if (comps[i]) {
+			const SerdStatus cst = serd_compressor_finish(comps[i]);
+			st = st ? st : cst;
+			serd_compressor_free(comps[i]);
+		}
+		if (files[i] && fclose(files[i])) {
+			SERDI_ERRORF("error writing shard %u (%s)\n", i, strerror(errno));
+			st = st ? st : SERD_ERR_UNKNOWN;
+		}
+	}
+
+	free(writers);
+	free(envs);
+	free(comps);
+	free(files);
+	return st;
+}
+
+static void
+pool_lock(Pool* pool)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_lock(&pool->mutex);
+#endif
+}
+
+static void
+pool_unlock(Pool* pool)
+{
+#ifdef HAVE_PTHREAD
+	pthread_mutex_unlock(&pool->mutex);
+#endif
+}
+
+/** Return the path in the output directory for the input file at `path`. */
+static char*
+output_path(const Pool* pool, const char* path)
+{
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+
+	const char*  dot      = strrchr(name, '.');
+	const size_t stem_len = (dot && dot != name) ? (size_t)(dot - name)
+	                                             : strlen(name);
+	const char*  ext      = (pool->opts->output_syntax == SERD_NTRIPLES)
+		? ".nt" : ".ttl";
+	const char*  comp_ext = (pool->compression == SERD_GZIP) ? ".gz"
+		: (pool->compression == SERD_ZSTD) ? ".zst" : "";
+
+	const size_t len = strlen(pool->out_dir) + 1 + stem_len + strlen(ext) +
+		strlen(comp_ext);
+	char* const  out      = (char*)malloc(len + 1);
+	snprintf(out, len + 1, "%s/%.*s%s%s",
+	         pool->out_dir, (int)stem_len, name, ext, comp_ext);
+	return out;
+}
+
+static int
+compare_paths(const void* a, const void* b)
+{
+	return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/** Set the output path of every job, or fail if two are the same. */
+static SerdStatus
+set_output_paths(Pool* pool)
+{
+	const char** paths = (const char**)calloc(pool->n_jobs, sizeof(char*));
+	size_t       n     = 0;
+	for (size_t i = 0; i < pool->n_jobs; ++i) {
+		Job* const job = &pool->jobs[i];
+		if (job->path) {
+			job->out_path = output_path(pool, (const char*)job->path);
+			paths[n++]    = job->out_path;
+		}
+	}
+
+	// Sort paths so that any duplicates are adjacent
+	qsort(paths, n, sizeof(const char*), compare_paths);
+
+	SerdStatus st = SERD_SUCCESS;
+	for (size_t i = 1; i < n && !st; ++i) {
+		if (!strcmp(paths[i - 1], paths[i])) {
+			SERDI_ERRORF("several inputs would be written to `%s'\n",
+			             paths[i]);
+			st = SERD_ERR_BAD_ARG;
+		}
+	}
+
+	free(paths);
+	return st;
+}
+
+/** Convert the input of job `i` to its own output file. */
+static SerdStatus
+run_file_job(Pool*           pool,
+             size_t          i,
+             FILE*           in_fd,
+             const SerdNode* base,
+             const SerdURI*  base_uri)
+{
+	const char* const out_path = pool->jobs[i].out_path;
+	FILE* const       out_fd   = serd_fopen(out_path, "wb");
+	if (!out_fd) {
+		return SERD_ERR_UNKNOWN;
+	}
+
+	SerdSink        sink   = serd_file_sink;
+	void*           stream = out_fd;
+	SerdCompressor* comp   = NULL;
+	if (pool->compression) {
+		comp   = serd_compressor_new(pool->compression, 0, 1, sink, stream);
+		sink   = serd_compressor_sink;
+		stream = comp;
+	}
+
+	SerdStatus st = convert(pool->opts, in_fd, NULL, pool->jobs[i].arg,
+	                        base, base_uri, false, pool->add_prefix, NULL, 0,
+	                        sink, stream);
+
+	if (comp) {
+		const SerdStatus cst = serd_compressor_finish(comp);
+		st = st ? st : cst;
+		serd_compressor_free(comp);
+	}
+
+	if (fclose(out_fd)) {
+		SERDI_ERRORF("error writing `%s' (%s)\n", out_path, strerror(errno));
+		st = st ? st : SERD_ERR_UNKNOWN;
+	}
+
+	return st;
+}
+
+/** Convert the input of job `i` to memory, and write any merged output. */
+static SerdStatus
+run_merged_job(Pool*           pool,
+               size_t          i,
+               FILE*           in_fd,
+               const SerdNode* base,
+               const SerdURI*  base_uri)
+{
+	Job* const job = &pool->jobs[i];
+
+	// Give blank nodes in each input a distinct prefix, like "f3_"
+	const uint8_t* blank_prefix = pool->add_prefix;
+	uint8_t*       file_prefix  = NULL;
+	if (pool->n_jobs > 1) {
+		const char*  add = pool->add_prefix ? (const char*)pool->add_prefix
+		                                    : "";
+		const size_t len = strlen(add) + 24;
+		file_prefix = (uint8_t*)malloc(len);
+		snprintf((char*)file_prefix, len, "%sf%lu_", add, (unsigned long)i);
+		blank_prefix = file_prefix;
+	}
+
+	// Write the base URI for each input, since a previous one may change it
+	const bool       has_base = pool->base->buf;
+	const SerdStatus st       = !in_fd ? SERD_ERR_UNKNOWN : convert(
+		pool->opts, in_fd, NULL, job->arg, base,
+		has_base ? base_uri : NULL, has_base && i > 0, blank_prefix,
+		NULL, 0, serd_buffer_sink, &job->output);
+
+	free(file_prefix);
+
+	// Write the output of every finished job that is next in order
+	pool_lock(pool);
+	job->done = true;
+	while (pool->next_out < pool->n_jobs && pool->jobs[pool->next_out].done) {
+		Job* const next = &pool->jobs[pool->next_out++];
+		if (!pool->out_st && next->output.chunk.len &&
+		    pool->sink(next->output.chunk.buf, next->output.chunk.len,
+		               pool->stream) != next->output.chunk.len) {
+			pool->out_st = SERD_ERR_UNKNOWN;
+		}
+		free((uint8_t*)next->output.chunk.buf);
+		next->output.chunk.buf = NULL;
+		next->output.chunk.len = 0;
+	}
+	pool_unlock(pool);
+
+	return st;
+}
+
+static void
+run_job(Pool* pool, size_t i)
+{
+	Job* const     job   = &pool->jobs[i];
+	const uint8_t* path  = job->path;
+	FILE*          in_fd = path ? serd_fopen((const char*)path, "r") : NULL;
+	SerdStatus     st    = SERD_ERR_UNKNOWN;
+
+	SerdURI  base_uri = SERD_URI_NULL;
+	SerdNode base     = SERD_NODE_NULL;
+	if (in_fd) {
+		if (pool->base->buf) {  // Base URI given with -B
+			base = serd_node_new_uri_from_node(pool->base, NULL, &base_uri);
+		} else {  // Use input file URI
+			base = serd_node_new_file_uri(path, NULL, &base_uri, false);
+		}
+	}
+
+	if (pool->out_dir) {
+		st = in_fd ? run_file_job(pool, i, in_fd, &base, &base_uri) : st;
+	} else {
+		// Finish even if the input could not be read, to keep writing in order
+		st = run_merged_job(pool, i, in_fd, &base, &base_uri);
+	}
+
+	if (in_fd) {
+		fclose(in_fd);
+	}
+
+	serd_node_free(&base);
+	job->st = st;
+}
+
+#ifdef HAVE_PTHREAD
+static void*
+worker_run(void* arg)
+{
+	Pool* const pool = (Pool*)arg;
+	for (;;) {
+		pool_lock(pool);
+		const size_t i = pool->next_job++;
+		pool_unlock(pool);
+		if (i >= pool->n_jobs) {
+			break;
+		}
+		run_job(pool, i);
+	}
+	return NULL;
+}
+#endif
+
+/** Run all jobs in `pool` on up to `n_threads` threads. */
+static SerdStatus
+run_pool(Pool* pool, unsigned long n_threads)
+{
+	n_threads = (n_threads < pool->n_jobs) ? n_threads : pool->n_jobs;
+
+#ifdef HAVE_PTHREAD
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_t*    threads   = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+	unsigned long n_started = 0;
+	for (; n_started + 1 < n_threads; ++n_started) {
+		if (pthread_create(&threads[n_started], NULL, worker_run, pool)) {
+			break;
+		}
+	}
+
+	worker_run(pool);  // Work on this thread too
+	for (unsigned long t = 0; t < n_started; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	free(threads);
+	pthread_mutex_destroy(&pool->mutex);
+#else
+	(void)n_threads;
+	for (size_t i = 0; i < pool->n_jobs; ++i) {
+		run_job(pool, i);
+	}
+#endif
+
+	SerdStatus st = SERD_SUCCESS;
+	for (size_t i = 0; i < pool->n_jobs && !st; ++i) {
+		st = (pool->jobs[i].st > SERD_FAILURE) ? pool->jobs[i].st : st;
+	}
+	return st ? st : pool->out_st;
+}
+
+static double
+now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void
+sketch_add(Sketch* sketch, uint64_t hash)
+{
+	// Use the high bits as the index, and the rank of the rest as the value
+	const size_t index = (size_t)(hash >> (64 - SKETCH_BITS));
+	uint64_t     rest  = hash << SKETCH_BITS;
+	uint8_t      rank  = 1;
+	for (; rank <= 64 - SKETCH_BITS && !(rest & (1ULL << 63)); ++rank) {
+		rest <<= 1;
+	}
+
+	if (rank > sketch->registers[index]) {
+		sketch->registers[index] = rank;
+	}
+}
+
+static double
+sketch_estimate(const Sketch* sketch)
+{
+	const size_t n_registers = (size_t)1 << SKETCH_BITS;
+	const double m           = (double)n_registers;
+	double       sum         = 0.0;
+	size_t       n_zeros     = 0;
+	for (size_t i = 0; i < n_registers; ++i) {
+		sum     += ldexp(1.0, -sketch->registers[i]);
+		n_zeros += !sketch->registers[i];
+	}
+
+	const double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+	if (estimate <= 2.5 * m && n_zeros) {
+		return m * log(m / (double)n_zeros);  // Linear counting for small sets
+	}
+	return estimate;
+}
+
+static uint64_t
+hash_node(uint64_t hash, const SerdNode* node)
+{
+	if (node && node->buf) {
+		const uint8_t type = (uint8_t)node->type;
+		hash = serd_hash_bytes(hash, &type, 1);
+		hash = serd_hash_bytes(hash, node->buf, node->n_bytes);
+	}
+	return hash;
+}
+
+static void
+count_node(Stats* stats, const SerdNode* node)
+{
+	if (!node) {
+		return;
+	} else if (node->type == SERD_URI || node->type == SERD_CURIE) {
+		stats->n_uri_bytes += node->n_bytes;
+	} else if (node->type == SERD_LITERAL) {
+		stats->n_literal_bytes += node->n_bytes;
+	}
+}
+
+static SerdStatus
+stats_prefix(void* handle, const SerdNode* name, const SerdNode* uri)
+{
+	(void)name;
+	(void)uri;
+	++((Stats*)handle)->n_prefixes;
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+stats_statement(void*              handle,
+                SerdStatementFlags flags,
+                const SerdNode*    graph,
+                const SerdNode*    subject,
+                const SerdNode*    predicate,
+                const SerdNode*    object,
+                const SerdNode*    object_datatype,
+                const SerdNode*    object_lang)
+{
+	Stats* const stats = (Stats*)handle;
+
+	++stats->n_statements;
+	stats->depth += !!(flags & SERD_ANON_S_BEGIN);
+	stats->depth += !!(flags & SERD_ANON_O_BEGIN);
+	if (stats->depth > stats->max_depth) {
+		stats->max_depth = stats->depth;
+	}
+
+	count_node(stats, graph);
+	count_node(stats, subject);
+	count_node(stats, predicate);
+	count_node(stats, object);
+	count_node(stats, object_datatype);
+
+	const uint64_t o = hash_node(hash_node(hash_node(SERD_HASH_SEED, object),
+	                                       object_datatype),
+	                             object_lang);
+
+	sketch_add(&stats->subjects,
+	           serd_hash_finish(hash_node(SERD_HASH_SEED, subject)));
+	sketch_add(&stats->predicates,
+	           serd_hash_finish(hash_node(SERD_HASH_SEED, predicate)));
+	sketch_add(&stats->objects, serd_hash_finish(o));
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+stats_end(void* handle, const SerdNode* node)
+{
+	(void)node;
+
+	Stats* const stats = (Stats*)handle;
+	stats->depth -= (stats->depth > 0);
+	return SERD_SUCCESS;
+}
+
+/** Print the size, time, and rates that are common to all statistics. */
+static void
+print_rates(size_t n_statements, size_t n_bytes, double seconds)
+{
+	const double s = (seconds > 0.0) ? seconds : 1.0e-9;
+	printf("bytes             %lu\n", (unsigned long)n_bytes);
+	printf("seconds           %.3f\n", seconds);
+	printf("mb_per_s          %.2f\n", (double)n_bytes / s / 1.0e6);
+	printf("statements_per_s  %.0f\n", (double)n_statements / s);
+}
+
+/** Read a document with a counting sink and print statistics about it. */
+static SerdStatus
+print_stats(const Options* opts,
+            FILE*          in_fd,
+            const uint8_t* str,
+            const uint8_t* in_name)
+{
+	Stats* const stats  = (Stats*)calloc(1, sizeof(Stats));
+	SerdReader*  reader = serd_reader_new(
+		opts->input_syntax, stats, NULL,
+		NULL, stats_prefix, stats_statement, stats_end);
+
+	serd_reader_set_strict(reader, !opts->lax);
+	if (opts->quiet) {
+		serd_reader_set_error_sink(reader, quiet_error_sink, NULL);
+	}
+
+	const double     start   = now();
+	const SerdStatus st      = read_input(opts, reader, in_fd, str, in_name);
+	const double     seconds = now() - start;
+
+	// Use the reader's count if available, since the input may be a pipe
+	size_t n_bytes = serd_reader_get_stats(reader).n_bytes;
+	if (!n_bytes && in_fd) {
+		const long pos = ftell(in_fd);
+		n_bytes = (pos > 0) ? (size_t)pos : 0;
+	} else if (!n_bytes) {
+		n_bytes = strlen((const char*)str);
+	}
+
+	serd_reader_free(reader);
+
+	printf("statements        %lu\n", (unsigned long)stats->n_statements);
+	printf("subjects          %.0f\n", sketch_estimate(&stats->subjects));
+	printf("predicates        %.0f\n", sketch_estimate(&stats->predicates));
+	printf("objects           %.0f\n", sketch_estimate(&stats->objects));
+	printf("prefixes          %lu\n", (unsigned long)stats->n_prefixes);
+	printf("literal_bytes     %lu\n", (unsigned long)stats->n_literal_bytes);
+	printf("uri_bytes         %lu\n", (unsigned long)stats->n_uri_bytes);
+	printf("max_depth         %lu\n", (unsigned long)stats->max_depth);
+	print_rates(stats->n_statements, n_bytes, seconds);
+
+	free(stats);
+	return st;
+}
+
+/** State for counting statement lines in NTriples across blocks of input. */
+typedef struct {
+	size_t n_lines;  ///< Number of statement lines
+	bool   in_line;  ///< True if a line with content has started
+	bool   comment;  ///< True if the current line is a comment
+} LineCounter;
+
+/** Count lines that are not blank or comments in `len` bytes of NTriples. */
+static void
+count_lines(LineCounter* counter, const uint8_t* buf, size_t len)
+{
+	for (size_t i = 0; i < len;) {
+		if (!counter->in_line) {
+			// Skip leading whitespace and blank lines
+			const uint8_t c = buf[i];
+			if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+				++i;
+				continue;
+			}
+			counter->in_line = true;
+			counter->comment = (c == '#');
+		}
+
+		// Jump to the end of the line
+		const uint8_t* nl = (const uint8_t*)memchr(buf + i, '\n', len - i);
+		if (!nl) {
+			break;  // Line continues in the next block
+		}
+
+		counter->n_lines += !counter->comment;
+		counter->in_line  = false;
+		i                 = (size_t)(nl - buf) + 1;
+	}
+}
+
+/** Count the statements in NTriples input by counting lines. */
+static SerdStatus
+print_line_stats(FILE* in_fd, const uint8_t* str)
+{
+	LineCounter  counter = { 0, false, false };
+	size_t       n_bytes = 0;
+	SerdStatus   st      = SERD_SUCCESS;
+	const double start   = now();
+	if (!in_fd) {
+		n_bytes = strlen((const char*)str);
+		count_lines(&counter, str, n_bytes);
+	} else {
+		const size_t   block_size = SERD_PAGE_SIZE * 16;
+		uint8_t* const block      = (uint8_t*)malloc(block_size);
+		size_t         n_read     = 0;
+		while ((n_read = fread(block, 1, block_size, in_fd)) > 0) {
+			count_lines(&counter, block, n_read);
+			n_bytes += n_read;
+		}
+		if (ferror(in_fd)) {
+			SERDI_ERRORF("error reading input (%s)\n", strerror(errno));
+			st = SERD_ERR_UNKNOWN;
+		}
+		free(block);
+	}
+
+	// Count a final line without a newline
+	counter.n_lines += (counter.in_line && !counter.comment);
+
+	const double seconds = now() - start;
+	printf("statements        %lu\n", (unsigned long)counter.n_lines);
+	print_rates(counter.n_lines, n_bytes, seconds);
+	return st;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -98,37 +1138,62 @@ main(int argc, char** argv)
 		return print_usage(argv[0], true);
 	}
 
-	FILE*          in_fd         = NULL;
-	SerdSyntax     input_syntax  = SERD_TURTLE;
-	SerdSyntax     output_syntax = SERD_NTRIPLES;
-	bool           from_file     = true;
-	bool           bulk_read     = true;
-	bool           bulk_write    = false;
-	bool           full_uris     = false;
-	bool           lax           = false;
-	bool           quiet         = false;
-	const uint8_t* in_name       = NULL;
-	const uint8_t* add_prefix    = NULL;
-	const uint8_t* chop_prefix   = NULL;
-	const uint8_t* root_uri      = NULL;
-	int            a             = 1;
+	FILE*           in_fd         = NULL;
+	SerdSyntax      input_syntax  = SERD_TURTLE;
+	SerdSyntax      output_syntax = SERD_NTRIPLES;
+	bool            from_file     = true;
+	bool            bulk_read     = true;
+	bool            bulk_write    = false;
+	bool            async_write   = false;
+	bool            full_uris     = false;
+	bool            sort          = false;
+	bool            lax           = false;
+	bool            quiet         = false;
+	bool            stats         = false;
+	bool            line_stats    = false;
+	const uint8_t*  in_name       = NULL;
+	const uint8_t*  add_prefix    = NULL;
+	const uint8_t*  chop_prefix   = NULL;
+	const uint8_t*  root_uri      = NULL;
+	const uint8_t*  base_arg      = NULL;
+	const char*     index_path    = NULL;
+	const char*     out_path      = NULL;
+	const char*     out_dir       = NULL;
+	SerdCompression compression   = (SerdCompression)0;
+	unsigned long   interval      = 0;
+	unsigned long   checkpoint    = 0;
+	unsigned long   sort_mib      = 64;
+	unsigned long   n_threads     = 1;
+	unsigned long   n_shards      = 0;
+	const char**    patterns      = NULL;
+	unsigned        n_patterns    = 0;
+	int             a             = 1;
 	for (; a < argc && argv[a][0] == '-'; ++a) {
 		if (argv[a][1] == '\0') {
 			in_name = (const uint8_t*)"(stdin)";
 			in_fd   = stdin;
 			break;
+		} else if (argv[a][1] == 'a') {
+			async_write = true;
 		} else if (argv[a][1] == 'b') {
 			bulk_write = true;
 		} else if (argv[a][1] == 'e') {
 			bulk_read = false;
 		} else if (argv[a][1] == 'f') {
 			full_uris = true;
+		} else if (argv[a][1] == 'g') {
+			sort = true;
 		} else if (argv[a][1] == 'h') {
 			return print_usage(argv[0], false);
 		} else if (argv[a][1] == 'l') {
 			lax = true;
+		} else if (argv[a][1] == 'L') {
+			stats      = true;
+			line_stats = true;
 		} else if (argv[a][1] == 'q') {
 			quiet = true;
+		} else if (argv[a][1] == 'S') {
+			stats = true;
 		} else if (argv[a][1] == 'v') {
 			return print_version();
 		} else if (argv[a][1] == 's') {
@@ -163,6 +1228,77 @@ main(int argc, char** argv)
 				return missing_arg(argv[0], 'r');
 			}
 			root_uri = (const uint8_t*)argv[a];
+		} else if (argv[a][1] == 'x') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'x');
+			} else if (!(interval = strtoul(argv[a], NULL, 10))) {
+				SERDI_ERRORF("invalid index interval `%s'\n", argv[a]);
+				return print_usage(argv[0], true);
+			}
+		} else if (argv[a][1] == 'X') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'X');
+			}
+			index_path = argv[a];
+		} else if (argv[a][1] == 'm') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'm');
+			} else if (!(sort_mib = strtoul(argv[a], NULL, 10))) {
+				SERDI_ERRORF("invalid memory limit `%s'\n", argv[a]);
+				return print_usage(argv[0], true);
+			}
+		} else if (argv[a][1] == 'C') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'C');
+			} else if (!set_compression(&compression, argv[a])) {
+				return print_usage(argv[0], true);
+			}
+		} else if (argv[a][1] == 'j') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'j');
+			} else if (!(n_threads = strtoul(argv[a], NULL, 10))) {
+				SERDI_ERRORF("invalid number of threads `%s'\n", argv[a]);
+				return print_usage(argv[0], true);
+			}
+		} else if (argv[a][1] == 'M') {
+			SerdFilterField field;
+			if (++a == argc) {
+				return missing_arg(argv[0], 'M');
+			} else if (!parse_pattern(argv[a], &field)) {
+				SERDI_ERRORF("invalid pattern `%s'\n", argv[a]);
+				return print_usage(argv[0], true);
+			}
+			if (!patterns) {
+				patterns = (const char**)calloc((size_t)argc, sizeof(char*));
+			}
+			patterns[n_patterns++] = argv[a];
+		} else if (argv[a][1] == 'P') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'P');
+			} else if (!(n_shards = strtoul(argv[a], NULL, 10))) {
+				SERDI_ERRORF("invalid number of partitions `%s'\n", argv[a]);
+				return print_usage(argv[0], true);
+			}
+		} else if (argv[a][1] == 'w') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'w');
+			}
+			out_path = argv[a];
+		} else if (argv[a][1] == 'O') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'O');
+			}
+			out_dir = argv[a];
+		} else if (argv[a][1] == 'B') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'B');
+			}
+			base_arg = (const uint8_t*)argv[a];
+		} else if (argv[a][1] == 'k') {
+			if (++a == argc) {
+				return missing_arg(argv[0], 'k');
+			}
+			checkpoint = strtoul(argv[a], NULL, 10);
 		} else {
 			SERDI_ERRORF("invalid option -- '%s'\n", argv[a] + 1);
 			return print_usage(argv[0], true);
@@ -174,8 +1310,60 @@ main(int argc, char** argv)
 		return 1;
 	}
 
-	const uint8_t* input = (const uint8_t*)argv[a++];
-	if (from_file) {
+	// All arguments are inputs if there are several, or -B or -O is given
+	const bool multi = from_file && !in_fd &&
+		(base_arg || out_dir || argc - a > 2);
+	if (multi && (interval || index_path)) {
+		SERDI_ERROR("indexing requires a single input file\n");
+		return 1;
+	} else if (multi && stats) {
+		SERDI_ERROR("statistics require a single input\n");
+		return 1;
+	} else if (out_dir && out_path) {
+		SERDI_ERROR("-O and -w can not be used together\n");
+		return print_usage(argv[0], true);
+	} else if (n_shards && (!out_path || multi || stats || sort ||
+	                        interval || index_path)) {
+		SERDI_ERROR("-P requires -w and a single input, without -g, -S, "
+		            "or indexing\n");
+		return print_usage(argv[0], true);
+	} else if (n_patterns && (stats || interval)) {
+		SERDI_ERROR("-M can not be used with -S, -L, or -x\n");
+		return print_usage(argv[0], true);
+	} else if (line_stats && input_syntax != SERD_NTRIPLES) {
+		SERDI_ERROR("-L requires NTriples input (-i ntriples)\n");
+		return print_usage(argv[0], true);
+	} else if (out_dir && compression &&
+	           !serd_compression_supported(compression)) {
+		SERDI_ERROR("compression format not supported by this build\n");
+		return 1;
+	}
+
+	int output_style = 0;
+	if (output_syntax == SERD_NTRIPLES) {
+		output_style |= SERD_STYLE_ASCII;
+	} else {
+		output_style |= SERD_STYLE_ABBREVIATED;
+		if (!full_uris) {
+			output_style |= SERD_STYLE_CURIED;
+		}
+	}
+
+	if (input_syntax != SERD_NTRIPLES || (output_style & SERD_STYLE_CURIED)) {
+		// Base URI may change and/or we're abbreviating URIs, so must resolve
+		output_style |= SERD_STYLE_RESOLVED;  // Base may chan
+	}
+
+	if (bulk_write) {
+		output_style |= SERD_STYLE_BULK;
+	}
+
+	const Options opts = { input_syntax, output_syntax, (SerdStyle)output_style,
+	                       bulk_read, sort, lax, quiet, sort_mib,
+	                       chop_prefix, root_uri, patterns, n_patterns };
+
+	const uint8_t* input = multi ? NULL : (const uint8_t*)argv[a++];
+	if (from_file && !multi) {
 		in_name = in_name ? in_name : input;
 		if (!in_fd) {
 			input = serd_uri_to_path(in_name);
@@ -185,82 +1373,165 @@ main(int argc, char** argv)
 		}
 	}
 
+	if (stats) {
+		const SerdStatus st = line_stats
+			? print_line_stats(from_file ? in_fd : NULL, input)
+			: print_stats(&opts, from_file ? in_fd : NULL, input, in_name);
+		if (from_file) {
+			fclose(in_fd);
+		}
+		return (st > SERD_FAILURE) ? 1 : 0;
+	}
+
+	if (interval) {
+		if (!from_file || in_fd == stdin) {
+			SERDI_ERROR("indexing requires an input file\n");
+			return 1;
+		}
+		SerdIndex* const index = serd_index_new((unsigned)interval);
+		SerdStatus       st    = serd_index_build(
+			index, input_syntax, in_fd, in_name);
+		if (!st) {
+			st = serd_index_write(index, stdout);
+		}
+		serd_index_free(index);
+		fclose(in_fd);
+		return st ? 1 : 0;
+	}
+
+	SerdIndex* index = NULL;
+	if (index_path) {
+		FILE* const index_fd = serd_fopen(index_path, "r");
+		if (!index_fd) {
+			return 1;
+		} else if (!(index = serd_index_read(index_fd))) {
+			SERDI_ERRORF("invalid index `%s'\n", index_path);
+		}
+		fclose(index_fd);
+		if (!index) {
+			return 1;
+		} else if (!from_file || in_fd == stdin ||
+		           checkpoint >= serd_index_get_size(index)) {
+			SERDI_ERRORF("no checkpoint %lu in index `%s'\n",
+			             checkpoint, index_path);
+			serd_index_free(index);
+			return 1;
+		}
+	}
+
 	SerdURI  base_uri = SERD_URI_NULL;
 	SerdNode base     = SERD_NODE_NULL;
-	if (a < argc) {  // Base URI given on command line
+	if (base_arg) {  // Base URI given with -B
+		base = serd_node_new_uri_from_string(base_arg, NULL, &base_uri);
+	} else if (!multi && a < argc) {  // Base URI given on command line
 		base = serd_node_new_uri_from_string(
 			(const uint8_t*)argv[a], NULL, &base_uri);
-	} else if (from_file && in_fd != stdin) {  // Use input file URI
+	} else if (!multi && from_file && in_fd != stdin) {  // Use input file URI
 		base = serd_node_new_file_uri(input, NULL, &base_uri, false);
 	}
 
-	FILE*    out_fd = stdout;
-	SerdEnv* env    = serd_env_new(&base);
-
-	int output_style = 0;
-	if (output_syntax == SERD_NTRIPLES) {
-		output_style |= SERD_STYLE_ASCII;
-	} else {
-		output_style |= SERD_STYLE_ABBREVIATED;
-		if (!full_uris) {
-			output_style |= SERD_STYLE_CURIED;
+	if (n_shards) {
+		compression = compression ? compression : guess_compression(out_path);
+		const SerdStatus st = convert_shards(
+			&opts, from_file ? in_fd : NULL, input, in_name, &base, &base_uri,
+			add_prefix, out_path, (unsigned)n_shards, compression);
+		if (from_file) {
+			fclose(in_fd);
 		}
+		serd_node_free(&base);
+		free(patterns);
+		return (st > SERD_FAILURE) ? 1 : 0;
 	}
 
-	if (input_syntax != SERD_NTRIPLES || (output_style & SERD_STYLE_CURIED)) {
-		// Base URI may change and/or we're abbreviating URIs, so must resolve
-		output_style |= SERD_STYLE_RESOLVED;  // Base may chan
+	FILE* out_fd = stdout;
+	if (out_path && !(out_fd = serd_fopen(out_path, "wb"))) {
+		serd_node_free(&base);
+		return 1;
+	} else if (out_path && !compression) {
+		compression = guess_compression(out_path);
 	}
 
-	if (bulk_write) {
-		output_style |= SERD_STYLE_BULK;
+	SerdSink        sink   = serd_file_sink;
+	void*           stream = out_fd;
+	SerdCompressor* comp   = NULL;
+	if (compression && !out_dir) {
+		if (!(comp = serd_compressor_new(
+			      compression, 0, (unsigned)n_threads, sink, stream))) {
+			SERDI_ERROR("compression format not supported by this build\n");
+			if (out_fd != stdout) {
+				fclose(out_fd);
+			}
+			serd_node_free(&base);
+			return 1;
+		}
+		sink   = serd_compressor_sink;
+		stream = comp;
 	}
 
-	SerdWriter* writer = serd_writer_new(
-		output_syntax, (SerdStyle)output_style,
-		env, &base_uri, serd_file_sink, out_fd);
-
-	SerdReader* reader = serd_reader_new(
-		input_syntax, writer, NULL,
-		(SerdBaseSink)serd_writer_set_base_uri,
-		(SerdPrefixSink)serd_writer_set_prefix,
-		(SerdStatementSink)serd_writer_write_statement,
-		(SerdEndSink)serd_writer_end_anon);
-
-	serd_reader_set_strict(reader, !lax);
-	if (quiet) {
-		serd_reader_set_error_sink(reader, quiet_error_sink, NULL);
-		serd_writer_set_error_sink(writer, quiet_error_sink, NULL);
+	SerdAsyncSink* async = NULL;
+	if (async_write && !out_dir) {
+		// Write (and compress) output on a separate thread
+		async  = serd_async_sink_new(SERD_PAGE_SIZE * 16, 4, sink, stream);
+		sink   = serd_async_sink_write;
+		stream = async;
 	}
 
-	SerdNode root = serd_node_from_string(SERD_URI, root_uri);
-	serd_writer_set_root_uri(writer, &root);
-	serd_writer_chop_blank_prefix(writer, chop_prefix);
-	serd_reader_add_blank_prefix(reader, add_prefix);
-
 	SerdStatus status = SERD_SUCCESS;
-	if (!from_file) {
-		status = serd_reader_read_string(reader, input);
-	} else if (bulk_read) {
-		status = serd_reader_read_file_handle(reader, in_fd, in_name);
+	if (multi) {
+		const size_t n_jobs = (size_t)(argc - a);
+		Pool         pool;
+		memset(&pool, 0, sizeof(pool));
+		pool.opts        = &opts;
+		pool.jobs        = (Job*)calloc(n_jobs, sizeof(Job));
+		pool.n_jobs      = n_jobs;
+		pool.base        = &base;
+		pool.add_prefix  = add_prefix;
+		pool.out_dir     = out_dir;
+		pool.compression = compression;
+		pool.sink        = sink;
+		pool.stream      = stream;
+		for (size_t i = 0; i < n_jobs; ++i) {
+			pool.jobs[i].arg  = (const uint8_t*)argv[a + i];
+			pool.jobs[i].path = serd_uri_to_path(pool.jobs[i].arg);
+		}
+
+		if (!out_dir || !(status = set_output_paths(&pool))) {
+			status = run_pool(&pool, n_threads);
+		}
+
+		for (size_t i = 0; i < n_jobs; ++i) {
+			free(pool.jobs[i].out_path);
+		}
+		free(pool.jobs);
 	} else {
-		status = serd_reader_start_stream(reader, in_fd, in_name, false);
-		while (!status) {
-			status = serd_reader_read_chunk(reader);
+		status = convert(&opts, from_file ? in_fd : NULL, input, in_name,
+		                 &base, &base_uri, false, add_prefix, index, checkpoint,
+		                 sink, stream);
+		serd_index_free(index);
+		if (from_file) {
+			fclose(in_fd);
 		}
-		serd_reader_end_stream(reader);
 	}
 
-	serd_reader_free(reader);
+	if (async) {
+		const SerdStatus st = serd_async_sink_flush(async);
+		status = status ? status : st;
+		serd_async_sink_free(async);
+	}
 
-	if (from_file) {
-		fclose(in_fd);
+	if (comp) {
+		const SerdStatus st = serd_compressor_finish(comp);
+		status = status ? status : st;
+		serd_compressor_free(comp);
+	}
+
+	if (out_fd != stdout && fclose(out_fd)) {
+		SERDI_ERRORF("error writing `%s' (%s)\n", out_path, strerror(errno));
+		status = status ? status : SERD_ERR_UNKNOWN;
 	}
 
-	serd_writer_finish(writer);
-	serd_writer_free(writer);
-	serd_env_free(env);
 	serd_node_free(&base);
+	free(patterns);
 
 	return (status > SERD_FAILURE) ? 1 : 0;
 }
@@ -0,0 +1,472 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "serd_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	SORT_GRAPH,
+	SORT_SUBJECT,
+	SORT_PREDICATE,
+	SORT_OBJECT,
+	SORT_DATATYPE,
+	SORT_LANG,
+	SORT_N_NODES
+} SortField;
+
+/**
+   A statement record.
+
+   Records are stored contiguously, both in memory and in run files.  Each is
+   this header followed by SORT_N_NODES nodes, each of which is a SortNode
+   header followed by its null terminated string, padded to alignment.
+*/
+typedef struct {
+	size_t size;  ///< Total size of record in bytes
+} SortRecord;
+
+typedef struct {
+	size_t        n_bytes;
+	size_t        n_chars;
+	SerdNodeFlags flags;
+	SerdType      type;
+} SortNode;
+
+/** A record in memory, ordered by key then input order. */
+typedef struct {
+	size_t         offset;  ///< Offset of record in text stack
+	const uint8_t* record;  ///< Pointer to record, only valid when sorting
+} SortEntry;
+
+/** A sorted run of records in a temporary file. */
+typedef struct {
+	FILE*    file;
+	uint8_t* record;  ///< Current record
+	size_t   size;    ///< Allocated size of record
+} SortRun;
+
+struct SerdSorterImpl {
+	SerdEnv*          env;
+	SerdStatementSink sink;
+	void*             handle;
+	size_t            budget;
+	SerdStack         records;
+	SortEntry*        entries;
+	size_t            n_entries;
+	size_t            entries_size;
+	SortRun*          runs;
+	size_t            n_runs;
+	SerdStatus        st;
+};
+
+static inline size_t
+pad_size(size_t size)
+{
+	return (size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+}
+
+static inline bool
+is_node(const SerdNode* node)
+{
+	return node->buf && node->type;
+}
+
+static inline size_t
+node_size(const SerdNode* node)
+{
+	return sizeof(SortNode) + pad_size(is_node(node) ? node->n_bytes + 1 : 0);
+}
+
+/** Return the node after `node` in a record. */
+static inline const SortNode*
+next_node(const SortNode* node)
+{
+	const size_t len = node->type ? node->n_bytes + 1 : 0;
+	return (const SortNode*)((const uint8_t*)(node + 1) + pad_size(len));
+}
+
+static inline const SortNode*
+record_node(const uint8_t* record, SortField field)
+{
+	const SortNode* node = (const SortNode*)(record + sizeof(SortRecord));
+	for (unsigned i = 0; i < (unsigned)field; ++i) {
+		node = next_node(node);
+	}
+	return node;
+}
+
+static int
+node_cmp(const SortNode* a, const SortNode* b)
+{
+	if (a->type != b->type) {
+		return (int)a->type - (int)b->type;
+	}
+
+	const size_t len = MIN(a->n_bytes, b->n_bytes);
+	const int    cmp = memcmp(a + 1, b + 1, len);
+	if (cmp) {
+		return cmp;
+	}
+	return (a->n_bytes < b->n_bytes) ? -1 : (a->n_bytes > b->n_bytes);
+}
+
+/** Compare records by subject, then predicate. */
+static int
+record_cmp(const uint8_t* a, const uint8_t* b)
+{
+	const SortNode* as  = record_node(a, SORT_SUBJECT);
+	const SortNode* bs  = record_node(b, SORT_SUBJECT);
+	const int       cmp = node_cmp(as, bs);
+	return cmp ? cmp : node_cmp(next_node(as), next_node(bs));
+}
+
+static int
+entry_cmp(const void* a, const void* b)
+{
+	const SortEntry* ea  = (const SortEntry*)a;
+	const SortEntry* eb  = (const SortEntry*)b;
+	const int        cmp = record_cmp(ea->record, eb->record);
+	if (cmp) {
+		return cmp;
+	}
+	return (ea->offset < eb->offset) ? -1 : (ea->offset > eb->offset);
+}
+
+SERD_API
+SerdSorter*
+serd_sorter_new(SerdEnv*          env,
+                size_t            budget,
+                SerdStatementSink statement_sink,
+                void*             handle)
+{
+	SerdSorter* sorter = (SerdSorter*)calloc(1, sizeof(struct SerdSorterImpl));
+	sorter->env     = env;
+	sorter->sink    = statement_sink;
+	sorter->handle  = handle;
+	sorter->budget  = budget;
+	sorter->records = serd_stack_new(NULL, SERD_PAGE_SIZE);
+	return sorter;
+}
+
+static void
+free_runs(SerdSorter* sorter)
+{
+	for (size_t i = 0; i < sorter->n_runs; ++i) {
+		fclose(sorter->runs[i].file);
+		free(sorter->runs[i].record);
+	}
+	free(sorter->runs);
+	sorter->runs   = NULL;
+	sorter->n_runs = 0;
+}
+
+SERD_API
+void
+serd_sorter_free(SerdSorter* sorter)
+{
+	if (!sorter) {
+		return;
+	}
+	free_runs(sorter);
+	free(sorter->entries);
+	serd_stack_free(&sorter->records);
+	free(sorter);
+}
+
+/** Sort the records in memory, setting record pointers in entries. */
+static void
+sort_entries(SerdSorter* sorter)
+{
+	for (size_t i = 0; i < sorter->n_entries; ++i) {
+		SortEntry* const e = &sorter->entries[i];
+		e->record = sorter->records.buf + e->offset;
+	}
+	qsort(sorter->entries, sorter->n_entries, sizeof(SortEntry), entry_cmp);
+}
+
+static void
+clear_entries(SerdSorter* sorter)
+{
+	sorter->records.size = SERD_STACK_BOTTOM;
+	sorter->n_entries    = 0;
+}
+
+/** Write the records in memory to a new sorted run file. */
+static SerdStatus
+spill(SerdSorter* sorter)
+{
+	FILE* const file = tmpfile();
+	if (!file) {
+		fprintf(stderr, "Error creating temporary file (%s)\n",
+		        strerror(errno));
+		return SERD_ERR_UNKNOWN;
+	}
+
+	sort_entries(sorter);
+	for (size_t i = 0; i < sorter->n_entries; ++i) {
+		const uint8_t* const record = sorter->entries[i].record;
+		const size_t         size   = ((const SortRecord*)record)->size;
+		if (fwrite(record, size, 1, file) != 1) {
+			fprintf(stderr, "Error writing temporary file (%s)\n",
+			        strerror(errno));
+			fclose(file);
+			return SERD_ERR_UNKNOWN;
+		}
+	}
+
+	sorter->runs = (SortRun*)realloc(
+		sorter->runs, (++sorter->n_runs) * sizeof(SortRun));
+	SortRun* const run = &sorter->runs[sorter->n_runs - 1];
+	run->file   = file;
+	run->record = NULL;
+	run->size   = 0;
+
+	clear_entries(sorter);
+	return SERD_SUCCESS;
+}
+
+static void
+add_node(uint8_t** ptr, const SerdNode* node)
+{
+	SortNode* const header = (SortNode*)*ptr;
+	if (!is_node(node)) {
+		memset(header, 0, sizeof(SortNode));
+		*ptr += sizeof(SortNode);
+		return;
+	}
+
+	header->n_bytes = node->n_bytes;
+	header->n_chars = node->n_chars;
+	header->flags   = node->flags;
+	header->type    = node->type;
+
+	uint8_t* const buf = (uint8_t*)(header + 1);
+	memcpy(buf, node->buf, node->n_bytes);
+	buf[node->n_bytes] = '\0';
+	*ptr = buf + pad_size(node->n_bytes + 1);
+}
+
+/**
+   Set `out` to an absolute version of `node`.
+
+   Statements are written long after they are read, by which time the base URI
+   and prefixes may have changed, so relative URIs and CURIEs are expanded.
+   Return true iff `out` was allocated and must be freed.
+*/
+static bool
+expand_node(const SerdSorter* sorter, const SerdNode* node, SerdNode* out)
+{
+	*out = node ? *node : SERD_NODE_NULL;
+	if (!node || !node->buf ||
+	    (node->type != SERD_CURIE && (node->type != SERD_URI ||
+	                                  serd_uri_string_has_scheme(node->buf)))) {
+		return false;
+	}
+
+	const SerdNode expanded = serd_env_expand_node(sorter->env, node);
+	if (!expanded.buf) {
+		return false;  // Leave as is for writer to report
+	}
+	*out = expanded;
+	return true;
+}
+
+SERD_API
+SerdStatus
+serd_sorter_add_statement(SerdSorter*        sorter,
+                          SerdStatementFlags flags,
+                          const SerdNode*    graph,
+                          const SerdNode*    subject,
+                          const SerdNode*    predicate,
+                          const SerdNode*    object,
+                          const SerdNode*    object_datatype,
+                          const SerdNode*    object_lang)
+{
+	(void)flags;  // Dropped, since sorting reorders statements
+
+	if (!subject || !predicate || !object) {
+		return SERD_ERR_BAD_ARG;
+	}
+
+	const SerdNode* in[SORT_N_NODES] = { graph, subject, predicate, object,
+	                                     object_datatype, object_lang };
+	SerdNode nodes[SORT_N_NODES];
+	bool     owned[SORT_N_NODES];
+	size_t   size = sizeof(SortRecord);
+	for (unsigned i = 0; i < SORT_N_NODES; ++i) {
+		owned[i] = expand_node(sorter, in[i], &nodes[i]);
+		size    += node_size(&nodes[i]);
+	}
+
+	if (sorter->n_entries == sorter->entries_size) {
+		sorter->entries_size = sorter->entries_size * 2 + 64;
+		sorter->entries      = (SortEntry*)realloc(
+			sorter->entries, sorter->entries_size * sizeof(SortEntry));
+	}
+
+	SortEntry* const entry = &sorter->entries[sorter->n_entries++];
+	entry->offset = sorter->records.size;
+	entry->record = NULL;
+
+	uint8_t* const    ptr    = serd_stack_push(&sorter->records, size);
+	SortRecord* const record = (SortRecord*)ptr;
+	record->size = size;
+
+	uint8_t* p = ptr + sizeof(SortRecord);
+	for (unsigned i = 0; i < SORT_N_NODES; ++i) {
+		add_node(&p, &nodes[i]);
+		if (owned[i]) {
+			serd_node_free(&nodes[i]);
+		}
+	}
+
+	if (sorter->records.size + sorter->n_entries * sizeof(SortEntry)
+	    > sorter->budget) {
+		return (sorter->st = spill(sorter));
+	}
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+emit(SerdSorter* sorter, const uint8_t* record)
+{
+	SerdNode        nodes[SORT_N_NODES];
+	const SortNode* node = (const SortNode*)(record + sizeof(SortRecord));
+	for (unsigned i = 0; i < SORT_N_NODES; ++i, node = next_node(node)) {
+		if (node->type) {
+			const SerdNode n = { (const uint8_t*)(node + 1),
+			                     node->n_bytes,
+			                     node->n_chars,
+			                     node->flags,
+			                     node->type };
+			nodes[i] = n;
+		} else {
+			nodes[i] = SERD_NODE_NULL;
+		}
+	}
+
+	// Flags are dropped since sorting splits up anonymous nodes and lists
+	return sorter->sink(sorter->handle,
+	                    0,
+	                    &nodes[SORT_GRAPH],
+	                    &nodes[SORT_SUBJECT],
+	                    &nodes[SORT_PREDICATE],
+	                    &nodes[SORT_OBJECT],
+	                    &nodes[SORT_DATATYPE],
+	                    &nodes[SORT_LANG]);
+}
+
+/** Read the next record in `run`, or return false at the end. */
+static bool
+run_next(SortRun* run)
+{
+	size_t size = 0;
+	if (fread(&size, sizeof(size), 1, run->file) != 1) {
+		return false;
+	}
+	if (run->size < size) {
+		run->size   = size;
+		run->record = (uint8_t*)realloc(run->record, size);
+	}
+	((SortRecord*)run->record)->size = size;
+	return fread(run->record + sizeof(size), size - sizeof(size), 1,
+	             run->file) == 1;
+}
+
+static inline bool
+run_less(const SerdSorter* sorter, size_t a, size_t b)
+{
+	// Earlier runs contain earlier statements, so ties go to the lower index
+	const int cmp = record_cmp(sorter->runs[a].record,
+	                           sorter->runs[b].record);
+	return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/** Restore the heap property of `heap` below index `i`. */
+static void
+sift_down(const SerdSorter* sorter, size_t* heap, size_t n, size_t i)
+{
+	for (size_t c; (c = 2 * i + 1) < n; i = c) {
+		if (c + 1 < n && run_less(sorter, heap[c + 1], heap[c])) {
+			++c;
+		}
+		if (!run_less(sorter, heap[c], heap[i])) {
+			break;
+		}
+		const size_t tmp = heap[i];
+		heap[i] = heap[c];
+		heap[c] = tmp;
+	}
+}
+
+/** Merge all runs, emitting every record in order. */
+static SerdStatus
+merge(SerdSorter* sorter)
+{
+	size_t* heap = (size_t*)malloc(sorter->n_runs * sizeof(size_t));
+	size_t  n    = 0;
+	for (size_t i = 0; i < sorter->n_runs; ++i) {
+		rewind(sorter->runs[i].file);
+		if (run_next(&sorter->runs[i])) {
+			heap[n++] = i;
+		}
+	}
+	for (size_t i = n / 2; i-- > 0;) {
+		sift_down(sorter, heap, n, i);
+	}
+
+	SerdStatus st = SERD_SUCCESS;
+	while (n > 0) {
+		SortRun* const run = &sorter->runs[heap[0]];
+		const SerdStatus est = emit(sorter, run->record);
+		st = st ? st : est;
+		if (!run_next(run)) {
+			heap[0] = heap[--n];
+		}
+		sift_down(sorter, heap, n, 0);
+	}
+
+	free(heap);
+	return st;
+}
+
+SERD_API
+SerdStatus
+serd_sorter_finish(SerdSorter* sorter)
+{
+	SerdStatus st = sorter->st;
+	if (!st && sorter->n_runs) {
+		// Spill the remainder and merge all runs from disk
+		if (!sorter->n_entries || !(st = spill(sorter))) {
+			st = merge(sorter);
+		}
+	} else if (!st) {
+		// Everything fits in memory, so just sort and emit
+		sort_entries(sorter);
+		for (size_t i = 0; i < sorter->n_entries; ++i) {
+			const SerdStatus est = emit(sorter, sorter->entries[i].record);
+			st = st ? st : est;
+		}
+	}
+
+	clear_entries(sorter);
+	free_runs(sorter);
+	sorter->st = SERD_SUCCESS;
+	return st;
+}
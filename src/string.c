@@ -15,8 +15,11 @@
 */
 
 #include "serd_internal.h"
+#include "pow5.h"
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 SERD_API
 const uint8_t*
@@ -62,104 +65,285 @@ serd_strlen(const uint8_t* str, size_t* n_bytes, SerdNodeFlags* flags)
 	return n_chars;
 }
 
-static inline double
-read_sign(const char** sptr)
+/** Powers of 10 which are exactly representable as a double. */
+static const double exact_pow10[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/** A number w * 10^expt read from a string, before conversion to double. */
+typedef struct {
+	uint64_t    w;           ///< Up to the first 19 significant digits
+	int64_t     expt;        ///< Decimal exponent of w
+	int64_t     e10;         ///< Exponent written after 'e' or 'E'
+	const char* digits;      ///< Start of mantissa digits
+	const char* digits_end;  ///< End of mantissa digits
+	bool        negative;    ///< True iff there is a leading '-'
+	bool        truncated;   ///< True iff nonzero digits were dropped from w
+} Decimal;
+
+/** Return the character at `s`, or 0 if `s` is at `end` (if `end` is set). */
+static inline char
+peek(const char* s, const char* end)
 {
-	double sign = 1.0;
-	switch (**sptr) {
-	case '-': sign = -1.0;
-	case '+': ++(*sptr);
-	default:  return sign;
-	}
+	return (!end || s < end) ? *s : '\0';
 }
 
-SERD_API
-double
-serd_strtod(const char* str, char** endptr)
+static const char*
+read_decimal(const char* s, const char* end, Decimal* dec)
 {
-	double result = 0.0;
+	memset(dec, 0, sizeof(Decimal));
 
-	// Point s at the first non-whitespace character
-	const char* s = str;
-	while (is_space(*s)) { ++s; }
-
-	// Read leading sign if necessary
-	const double sign = read_sign(&s);
+	// Skip leading whitespace and read sign if present
+	while (is_space(peek(s, end))) { ++s; }
+	switch (peek(s, end)) {
+	case '-': dec->negative = true;  // fall through
+	case '+': ++s;
+	default:  break;
+	}
 
-	// Parse integer part
-	for (; is_digit(*s); ++s) {
-		result = (result * 10.0) + (*s - '0');
+	// Read integer part, keeping at most 19 significant digits
+	unsigned n_sig = 0;
+	char     c     = '\0';
+	dec->digits = s;
+	for (; is_digit(c = peek(s, end)); ++s) {
+		if (n_sig < 19 && (dec->w || c != '0')) {
+			dec->w = (dec->w * 10) + (uint64_t)(c - '0');
+			++n_sig;
+		} else if (n_sig == 19) {
+			++dec->expt;
+			dec->truncated |= (c != '0');
+		}
 	}
 
-	// Parse fractional part
-	if (*s == '.') {
-		double denom = 10.0;
-		for (++s; is_digit(*s); ++s) {
-			result += (*s - '0') / denom;
-			denom *= 10.0;
+	// Read fractional part, where leading zeros only shift the exponent
+	if (c == '.') {
+		for (++s; is_digit(c = peek(s, end)); ++s) {
+			if (n_sig < 19) {
+				dec->w = (dec->w * 10) + (uint64_t)(c - '0');
+				n_sig += (dec->w != 0);
+				--dec->expt;
+			} else {
+				dec->truncated |= (c != '0');
+			}
 		}
 	}
+	dec->digits_end = s;
 
-	// Parse exponent
-	if (*s == 'e' || *s == 'E') {
+	// Read exponent, clamped to a value far beyond the range of double
+	if (c == 'e' || c == 'E') {
 		++s;
-		double expt      = 0.0;
-		double expt_sign = read_sign(&s);
-		for (; is_digit(*s); ++s) {
-			expt = (expt * 10.0) + (*s - '0');
+		bool expt_negative = false;
+		switch (peek(s, end)) {
+		case '-': expt_negative = true;  // fall through
+		case '+': ++s;
+		default:  break;
+		}
+		for (; is_digit(c = peek(s, end)); ++s) {
+			if (dec->e10 < 100000) {
+				dec->e10 = (dec->e10 * 10) + (c - '0');
+			}
 		}
-		result *= pow(10, expt * expt_sign);
+		dec->e10   = expt_negative ? -dec->e10 : dec->e10;
+		dec->expt += dec->e10;
 	}
 
-	if (endptr) {
-		*endptr = (char*)s;
+	return s;
+}
+
+/** Return the number of leading zero bits in non-zero `x`. */
+static inline unsigned
+count_leading_zeros(uint64_t x)
+{
+#ifdef __GNUC__
+	return (unsigned)__builtin_clzll(x);
+#else
+	unsigned n = 0;
+	for (; !(x & 0x8000000000000000ULL); x <<= 1) {
+		++n;
 	}
+	return n;
+#endif
+}
+
+/** Set `hi` and `lo` to the high and low halves of the product `a` * `b`. */
+static inline void
+multiply_128(uint64_t a, uint64_t b, uint64_t* hi, uint64_t* lo)
+{
+	const uint64_t m32 = 0xFFFFFFFFULL;
+	const uint64_t p00 = (a & m32) * (b & m32);
+	const uint64_t p01 = (a & m32) * (b >> 32);
+	const uint64_t p10 = (a >> 32) * (b & m32);
+	const uint64_t p11 = (a >> 32) * (b >> 32);
+	const uint64_t mid = (p00 >> 32) + (p01 & m32) + (p10 & m32);
 
-	return result * sign;
+	*lo = (mid << 32) | (p00 & m32);
+	*hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
 }
 
 /**
-   Base64 decoding table.
-   This is indexed by encoded characters and returns the numeric value used
-   for decoding, shifted up by 47 to be in the range of printable ASCII.
-   A '$' is a placeholder for characters not in the base64 alphabet.
+   Convert w * 10^q to the nearest double with the Eisel-Lemire algorithm.
+
+   See "Number Parsing at a Gigabyte per Second" by Daniel Lemire (Software:
+   Practice and Experience, 2021).  The product of the normalised mantissa
+   and a truncated 128-bit power of five is nearly always precise enough to
+   determine the correctly rounded result.
+
+   @return False if the result can not be determined this way.
 */
-static const char b64_unmap[] =
-	"$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$m$$$ncdefghijkl$$$$$$"
-	"$/0123456789:;<=>?@ABCDEFGH$$$$$$IJKLMNOPQRSTUVWXYZ[\\]^_`ab$$$$"
-	"$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$"
-	"$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$";
+static bool
+eisel_lemire(uint64_t w, int64_t q, double* out)
+{
+	if (q < SERD_POW5_MIN_EXPT) {
+		*out = 0.0;  // Less than half the smallest subnormal
+		return true;
+	} else if (q > SERD_POW5_MAX_EXPT) {
+		*out = HUGE_VAL;
+		return true;
+	}
+
+	// Multiply normalised mantissa by 5^q (the 2^q is added to the exponent)
+	const unsigned  lz = count_leading_zeros(w);
+	const uint64_t* p5 = serd_pow5[q - SERD_POW5_MIN_EXPT];
+	uint64_t        hi = 0;
+	uint64_t        lo = 0;
+	multiply_128(w << lz, p5[0], &hi, &lo);
+	if ((hi & 0x1FF) == 0x1FF) {
+		// Low bits may carry into the result, so use the full 128-bit power
+		uint64_t hi2 = 0;
+		uint64_t lo2 = 0;
+		multiply_128(w << lz, p5[1], &hi2, &lo2);
+		lo += hi2;
+		hi += (hi2 > lo);
+		if (lo == UINT64_MAX && (q < -27 || q > 55)) {
+			return false;
+		}
+	}
+
+	// Take the top 54 bits, and calculate the biased binary exponent
+	const unsigned upper = (unsigned)(hi >> 63);
+	const unsigned shift = upper + 9;
+	const int64_t  t     = 217706 * q;  // floor(q * log2(10) * 2^16)
+	uint64_t       m     = hi >> shift;
+	int            p2    = (int)((t >= 0 ? t : t - 65535) / 65536) + 63 +
+	                       (int)upper - (int)lz + 1023;
+
+	if (p2 <= 0) {
+		// Subnormal, shift and round (which may produce the smallest normal)
+		if (-p2 + 1 >= 64) {
+			*out = 0.0;
+			return true;
+		}
+		m >>= -p2 + 1;
+		m += (m & 1);
+		m >>= 1;
+		p2 = (m < (1ULL << 52)) ? 0 : 1;
+	} else {
+		// Round to even if exactly halfway, which is only possible for small q
+		if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 &&
+		    (m << shift) == hi) {
+			m &= ~1ULL;
+		}
+		m += (m & 1);
+		m >>= 1;
+		if (m >= (2ULL << 52)) {
+			m = 1ULL << 52;
+			++p2;
+		}
+		m &= ~(1ULL << 52);
+		if (p2 >= 0x7FF) {
+			*out = HUGE_VAL;
+			return true;
+		}
+	}
 
-static inline uint8_t unmap(const uint8_t in) { return b64_unmap[in] - 47; }
+	const uint64_t bits = ((uint64_t)p2 << 52) | m;
+	memcpy(out, &bits, sizeof(bits));
+	return true;
+}
 
 /**
-   Decode 4 base64 characters to 3 raw bytes.
+   Convert `dec` to a double using the C library.
+
+   This is only used for the rare numbers which are too close to halfway
+   between two doubles to round with 19 digits.  The digits are written
+   without a decimal point so the result does not depend on the locale.
 */
-static inline size_t
-decode_chunk(const uint8_t in[4], uint8_t out[3])
+static double
+read_exact(const Decimal* dec)
 {
-	out[0] = (uint8_t)(((unmap(in[0]) << 2))        | unmap(in[1]) >> 4);
-	out[1] = (uint8_t)(((unmap(in[1]) << 4) & 0xF0) | unmap(in[2]) >> 2);
-	out[2] = (uint8_t)(((unmap(in[2]) << 6) & 0xC0) | unmap(in[3]));
-	return 1 + (in[2] != '=') + ((in[2] != '=') && (in[3] != '='));
+	const size_t max_len = (size_t)(dec->digits_end - dec->digits) + 32;
+	char*        buf     = (char*)malloc(max_len);
+	int64_t      expt    = dec->e10;
+	size_t       len     = 0;
+	bool         frac    = false;
+	for (const char* s = dec->digits; s < dec->digits_end; ++s) {
+		if (*s == '.') {
+			frac = true;
+		} else {
+			buf[len++] = *s;
+			expt      -= frac;
+		}
+	}
+
+	buf[len++] = 'e';
+	serd_format_integer(expt, (uint8_t*)buf + len);
+
+	const double result = strtod(buf, NULL);
+	free(buf);
+	return result;
 }
 
-SERD_API
-void*
-serd_base64_decode(const uint8_t* str, size_t len, size_t* size)
+static double
+decimal_to_double(const Decimal* dec)
 {
-	void* buf = malloc((len * 3) / 4 + 2);
-	*size = 0;
-	for (size_t i = 0, j = 0; i < len; j += 3) {
-		uint8_t in[] = "====";
-		size_t  n_in = 0;
-		for (; i < len && n_in < 4; ++n_in) {
-			for (; i < len && !is_base64(str[i]); ++i) {}  // Skip junk
-			in[n_in] = str[i++];
-		}
-		if (n_in > 1) {
-			*size += decode_chunk(in, (uint8_t*)buf + j);
+	if (!dec->w) {
+		return 0.0;
+	} else if (!dec->truncated && dec->w <= (1ULL << 53) &&
+	           dec->expt >= -22 && dec->expt <= 22) {
+		// Both w and 10^expt are exact, so one operation rounds correctly
+		const double w = (double)dec->w;
+		return (dec->expt < 0) ? w / exact_pow10[-dec->expt]
+		                       : w * exact_pow10[dec->expt];
+	}
+
+	double result = 0.0;
+	if (eisel_lemire(dec->w, dec->expt, &result)) {
+		// If digits were dropped, the result must not depend on them
+		double upper = 0.0;
+		if (!dec->truncated ||
+		    (eisel_lemire(dec->w + 1, dec->expt, &upper) && upper == result)) {
+			return result;
 		}
 	}
-	return buf;
+
+	return read_exact(dec);
+}
+
+SERD_API
+double
+serd_strtod(const char* str, char** endptr)
+{
+	Decimal           dec;
+	const char* const s = read_decimal(str, NULL, &dec);
+	if (endptr) {
+		*endptr = (char*)s;
+	}
+
+	const double result = decimal_to_double(&dec);
+	return dec.negative ? -result : result;
+}
+
+SERD_API
+double
+serd_strntod(const char* str, size_t len, char** endptr)
+{
+	Decimal           dec;
+	const char* const s = read_decimal(str, str + len, &dec);
+	if (endptr) {
+		*endptr = (char*)s;
+	}
+
+	const double result = decimal_to_double(&dec);
+	return dec.negative ? -result : result;
 }
@@ -142,108 +142,89 @@ serd_uri_dump(const SerdURI* uri, FILE* file)
 SERD_API
 SerdStatus
 serd_uri_parse(const uint8_t* utf8, SerdURI* uri)
+{
+	return serd_uri_parse_chunk(utf8, strlen((const char*)utf8), uri);
+}
+
+SERD_API
+SerdStatus
+serd_uri_parse_chunk(const uint8_t* buf, size_t len, SerdURI* uri)
 {
 	*uri = SERD_URI_NULL;
 
-	const uint8_t* ptr = utf8;
+	const uint8_t* const end = buf + len;
+	const uint8_t*       ptr = buf;
 
 	/* See http://tools.ietf.org/html/rfc3986#section-3
 	   URI = scheme ":" hier-part [ "?" query ] [ "#" fragment ]
 	*/
 
-	/* S3.1: scheme ::= ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) */
-	if (is_alpha(*ptr)) {
-		for (uint8_t c = *++ptr; true; c = *++ptr) {
-			switch (c) {
-			case '\0': case '/': case '?': case '#':
-				ptr = utf8;
-				goto path;  // Relative URI (starts with path by definition)
-			case ':':
-				uri->scheme.buf = utf8;
-				uri->scheme.len = (ptr++) - utf8;
-				goto maybe_authority;  // URI with scheme
-			case '+': case '-': case '.':
-				continue;
-			default:
-				if (is_alpha(c) || is_digit(c)) {
-					continue;
-				}
+	/* S3.1: scheme ::= ALPHA *( ALPHA / DIGIT / "+" / "-" / "." )
+	   This is short, so scan for the first delimiter byte by byte.
+	*/
+	if (len && is_alpha(*ptr)) {
+		for (++ptr; ptr < end; ++ptr) {
+			const uint8_t c = *ptr;
+			if (c == ':') {
+				uri->scheme.buf = buf;
+				uri->scheme.len = (size_t)(ptr++ - buf);
+				break;
+			} else if (c == '/' || c == '?' || c == '#') {
+				break;
 			}
 		}
+		if (!uri->scheme.buf) {
+			ptr = buf;  // Relative URI (starts with path by definition)
+		}
 	}
 
 	/* S3.2: The authority component is preceded by a double slash ("//")
 	   and is terminated by the next slash ("/"), question mark ("?"),
 	   or number sign ("#") character, or by the end of the URI.
 	*/
-maybe_authority:
-	if (*ptr == '/' && *(ptr + 1) == '/') {
+	if (end - ptr >= 2 && ptr[0] == '/' && ptr[1] == '/') {
 		ptr += 2;
 		uri->authority.buf = ptr;
-		for (uint8_t c; (c = *ptr) != '\0'; ++ptr) {
-			switch (c) {
-			case '/': goto path;
-			case '?': goto query;
-			case '#': goto fragment;
-			default:
-				++uri->authority.len;
-			}
-		}
+		for (; ptr < end && *ptr != '/' && *ptr != '?' && *ptr != '#'; ++ptr) {}
+		uri->authority.len = (size_t)(ptr - uri->authority.buf);
 	}
 
+	/* The rest is split by the first "#", and the first "?" before it, which
+	   are found with memchr() since paths and queries can be long.
+	*/
+	const uint8_t* const hash = (const uint8_t*)memchr(ptr, '#', end - ptr);
+	const uint8_t* const rest = hash ? hash : end;
+	const uint8_t* const qmark = (const uint8_t*)memchr(ptr, '?', rest - ptr);
+
 	/* RFC3986 S3.3: The path is terminated by the first question mark ("?")
 	   or number sign ("#") character, or by the end of the URI.
 	*/
-path:
-	switch (*ptr) {
-	case '?':  goto query;
-	case '#':  goto fragment;
-	case '\0': goto end;
-	default:  break;
-	}
-	uri->path.buf = ptr;
-	uri->path.len = 0;
-	for (uint8_t c; (c = *ptr) != '\0'; ++ptr) {
-		switch (c) {
-		case '?': goto query;
-		case '#': goto fragment;
-		default:
-			++uri->path.len;
-		}
+	const uint8_t* const path_end = qmark ? qmark : rest;
+	if (ptr < path_end) {
+		uri->path.buf = ptr;
+		uri->path.len = (size_t)(path_end - ptr);
 	}
 
 	/* RFC3986 S3.4: The query component is indicated by the first question
 	   mark ("?") character and terminated by a number sign ("#") character
 	   or by the end of the URI.
 	*/
-query:
-	if (*ptr == '?') {
-		uri->query.buf = ++ptr;
-		for (uint8_t c; (c = *ptr) != '\0'; ++ptr) {
-			switch (c) {
-			case '#':
-				goto fragment;
-			default:
-				++uri->query.len;
-			}
-		}
+	if (qmark) {
+		uri->query.buf = qmark + 1;
+		uri->query.len = (size_t)(rest - qmark - 1);
 	}
 
 	/* RFC3986 S3.5: A fragment identifier component is indicated by the
 	   presence of a number sign ("#") character and terminated by the end
 	   of the URI.
 	*/
-fragment:
-	if (*ptr == '#') {
-		uri->fragment.buf = ptr;
-		while (*ptr++ != '\0') {
-			++uri->fragment.len;
-		}
+	if (hash) {
+		uri->fragment.buf = hash;
+		uri->fragment.len = (size_t)(end - hash);
 	}
 
-end:
 	#ifdef URI_DEBUG
-	fprintf(stderr, "PARSE URI <%s>\n", utf8);
+	fprintf(stderr, "PARSE URI <%.*s>\n", (int)len, buf);
 	serd_uri_dump(uri, stderr);
 	fprintf(stderr, "\n");
 	#endif
@@ -415,6 +396,18 @@ write_path_tail(SerdSink sink, void* stream, const SerdURI* uri, size_t i)
 	return len;
 }
 
+/** Return true iff the path segment of `uri` at `i` contains a colon. */
+static inline bool
+has_colon_segment(const SerdURI* uri, size_t i, size_t path_len)
+{
+	for (; i < path_len && uri_path_at(uri, i) != '/'; ++i) {
+		if (uri_path_at(uri, i) == ':') {
+			return true;  // Would be read as a scheme
+		}
+	}
+	return false;
+}
+
 /** Write the path of `uri` relative to the path of `base`. */
 static size_t
 write_rel_path(SerdSink       sink,
@@ -429,16 +422,31 @@ write_rel_path(SerdSink       sink,
 	// Find the last separator common to both paths
 	size_t last_shared_sep = 0;
 	size_t i               = 0;
-	for (; i < min_len && uri_path_at(uri, i) == uri_path_at(base, i); ++i) {
-		if (uri_path_at(uri, i) == '/') {
-			last_shared_sep = i;
+	if (!uri->path_base.len && !base->path_base.len) {
+		// Paths are contiguous (the common case), compare them directly
+		const uint8_t* const u = uri->path.buf;
+		const uint8_t* const b = base->path.buf;
+		for (; i < min_len && u[i] == b[i]; ++i) {
+			if (u[i] == '/') {
+				last_shared_sep = i;
+			}
+		}
+	} else {
+		for (; i < min_len && uri_path_at(uri, i) == uri_path_at(base, i); ++i) {
+			if (uri_path_at(uri, i) == '/') {
+				last_shared_sep = i;
+			}
 		}
 	}
 
 	if (i == path_len && i == base_len) {  // Paths are identical
 		return 0;
 	} else if (last_shared_sep == 0) {  // No common components
-		return write_path_tail(sink, stream, uri, 0);
+		size_t len = 0;
+		if (path_len > 1 && uri_path_at(uri, 1) == '/') {
+			len += sink("/.", 2, stream);  // Path would otherwise be authority
+		}
+		return len + write_path_tail(sink, stream, uri, 0);
 	}
 
 	// Find the number of up references ("..") required
@@ -455,6 +463,13 @@ write_rel_path(SerdSink       sink,
 		len += sink("../", 3, stream);
 	}
 
+	// Refer to the directory if the suffix is empty or looks absolute
+	const size_t tail = last_shared_sep + 1;
+	if (!up && (tail == path_len || uri_path_at(uri, tail) == '/' ||
+	            has_colon_segment(uri, tail, path_len))) {
+		len += sink("./", 2, stream);
+	}
+
 	// Write suffix
 	return len += write_path_tail(sink, stream, uri, last_shared_sep + 1);
 }
@@ -502,3 +517,67 @@ serd_uri_serialise(const SerdURI* uri, SerdSink sink, void* stream)
 {
 	return serd_uri_serialise_relative(uri, NULL, NULL, sink, stream);
 }
+
+static inline uint8_t*
+append(uint8_t* ptr, const SerdChunk* chunk)
+{
+	if (chunk->len) {
+		memcpy(ptr, chunk->buf, chunk->len);
+	}
+	return ptr + chunk->len;
+}
+
+SERD_API
+size_t
+serd_uri_serialise_buffer(const SerdURI* uri, uint8_t* buf, size_t size)
+{
+	// Calculate the exact length first, so nothing is written on overflow
+	const size_t len = (uri->scheme.buf ? uri->scheme.len + 1 : 0) +
+		(uri->authority.buf ? uri->authority.len + 2 : 0) +
+		uri->path_base.len +
+		(uri->path.buf ? uri->path.len : 0) +
+		(uri->query.buf ? uri->query.len + 1 : 0) +
+		(uri->fragment.buf ? uri->fragment.len : 0);
+	if (len >= size) {
+		return len;
+	}
+
+	uint8_t* ptr = buf;
+	if (uri->scheme.buf) {
+		ptr    = append(ptr, &uri->scheme);
+		*ptr++ = ':';
+	}
+	if (uri->authority.buf) {
+		*ptr++ = '/';
+		*ptr++ = '/';
+		ptr    = append(ptr, &uri->authority);
+	}
+	ptr = append(ptr, &uri->path_base);
+	ptr = append(ptr, &uri->path);
+	if (uri->query.buf) {
+		*ptr++ = '?';
+		ptr    = append(ptr, &uri->query);
+	}
+	ptr  = append(ptr, &uri->fragment);  // Includes the leading `#'
+	*ptr = '\0';
+	return len;
+}
+
+SERD_API
+size_t
+serd_uri_resolve_string(const uint8_t* str,
+                        size_t         len,
+                        const SerdURI* base,
+                        uint8_t*       buf,
+                        size_t         size)
+{
+	SerdURI ref;
+	serd_uri_parse_chunk(str, len, &ref);
+	if (!base) {
+		return serd_uri_serialise_buffer(&ref, buf, size);
+	}
+
+	SerdURI abs_uri;
+	serd_uri_resolve(&ref, base, &abs_uri);
+	return serd_uri_serialise_buffer(&abs_uri, buf, size);
+}
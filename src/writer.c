@@ -21,19 +21,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define NS_RDF "http://www.w3.org/1999/02/22-rdf-syntax-ns#"
-#define NS_XSD "http://www.w3.org/2001/XMLSchema#"
-
 typedef struct {
 	SerdNode graph;
 	SerdNode subject;
 	SerdNode predicate;
+	size_t   graph_size;      ///< Allocated size of graph.buf
+	size_t   subject_size;    ///< Allocated size of subject.buf
+	size_t   predicate_size;  ///< Allocated size of predicate.buf
 } WriteContext;
 
 static const WriteContext WRITE_CONTEXT_NULL = {
 	{ 0, 0, 0, 0, SERD_NOTHING },
 	{ 0, 0, 0, 0, SERD_NOTHING },
-	{ 0, 0, 0, 0, SERD_NOTHING }
+	{ 0, 0, 0, 0, SERD_NOTHING },
+	0, 0, 0
 };
 
 typedef enum {
@@ -74,26 +75,34 @@ static const SepRule rules[] = {
 };
 
 struct SerdWriterImpl {
-	SerdSyntax    syntax;
-	SerdStyle     style;
-	SerdEnv*      env;
-	SerdNode      root_node;
-	SerdURI       root_uri;
-	SerdURI       base_uri;
-	SerdStack     anon_stack;
-	SerdBulkSink  bulk_sink;
-	SerdSink      sink;
-	void*         stream;
-	SerdErrorSink error_sink;
-	void*         error_handle;
-	WriteContext  context;
-	SerdNode      list_subj;
-	unsigned      list_depth;
-	uint8_t*      bprefix;
-	size_t        bprefix_len;
-	unsigned      indent;
-	Sep           last_sep;
-	bool          empty;
+	const SerdAllocator* allocator;
+	SerdSyntax           syntax;
+	SerdStyle            style;
+	SerdEnv*             env;
+	SerdNode             root_node;
+	SerdURI              root_uri;
+	SerdURI              base_uri;
+	bool                 rooted;        ///< True iff base_uri is under root_uri
+	uint8_t*             base_str;      ///< Base URI up to the end of its path
+	size_t               base_dir_len;  ///< Length of base_str up to last '/'
+	size_t               base_str_len;
+	SerdStack            anon_stack;
+	size_t               anon_stack_peak;  ///< End of initialised anon_stack
+	SerdBulkSink         bulk_sink;
+	SerdSink             sink;
+	void*                stream;
+	SerdFlushPolicy      flush;
+	SerdErrorSink        error_sink;
+	void*                error_handle;
+	WriteContext         context;
+	SerdNode             list_subj;
+	size_t               list_subj_size;  ///< Allocated size of list_subj.buf
+	unsigned             list_depth;
+	uint8_t*             bprefix;
+	size_t               bprefix_len;
+	unsigned             indent;
+	Sep                  last_sep;
+	bool                 empty;
 };
 
 typedef enum {
@@ -125,11 +134,19 @@ anon_stack_top(SerdWriter* writer)
 	                       + writer->anon_stack.size - sizeof(WriteContext));
 }
 
+// Copy `src` to `dst`, reusing the `size` bytes allocated for `dst` if possible
 static void
-copy_node(SerdNode* dst, const SerdNode* src)
+copy_node(const SerdWriter* writer,
+          SerdNode*         dst,
+          size_t*           size,
+          const SerdNode*   src)
 {
-	if (src) {
-		dst->buf = (uint8_t*)realloc((char*)dst->buf, src->n_bytes + 1);
+	if (src && src->buf) {
+		if (*size < src->n_bytes + 1) {
+			*size    = src->n_bytes + 1;
+			dst->buf = (uint8_t*)serd_realloc(
+				writer->allocator, (char*)dst->buf, *size);
+		}
 		dst->n_bytes = src->n_bytes;
 		dst->n_chars = src->n_chars;
 		dst->flags   = src->flags;
@@ -140,16 +157,40 @@ copy_node(SerdNode* dst, const SerdNode* src)
 	}
 }
 
+// Return true iff `node` equals the context node `ctx`
+static inline bool
+context_equals(const SerdNode* node, const SerdNode* ctx)
+{
+	// URIs often share a long prefix, so check the last byte before memcmp()
+	return node->type == ctx->type && node->n_bytes == ctx->n_bytes &&
+		(!node->n_bytes ||
+		 node->buf[node->n_bytes - 1] == ctx->buf[ctx->n_bytes - 1]) &&
+		!memcmp(node->buf, ctx->buf, node->n_bytes);
+}
+
+static void
+free_context(const SerdAllocator* allocator, WriteContext* ctx)
+{
+	serd_node_free_with_allocator(allocator, &ctx->graph);
+	serd_node_free_with_allocator(allocator, &ctx->subject);
+	serd_node_free_with_allocator(allocator, &ctx->predicate);
+	*ctx = WRITE_CONTEXT_NULL;
+}
+
 static inline size_t
 sink(const void* buf, size_t len, SerdWriter* writer)
 {
-	if (len == 0) {
-		return 0;
-	} else if (writer->style & SERD_STYLE_BULK) {
-		return serd_bulk_sink_write(buf, len, &writer->bulk_sink);
-	} else {
-		return writer->sink(buf, len, writer->stream);
+	return serd_bulk_sink_write(buf, len, &writer->bulk_sink);
+}
+
+// Flush output at the end of a writer call if flushing every statement
+static inline SerdStatus
+end_call(SerdWriter* writer, SerdStatus st)
+{
+	if (writer->flush == SERD_FLUSH_STATEMENT) {
+		serd_bulk_sink_flush(&writer->bulk_sink);
 	}
+	return st;
 }
 
 // Parse a UTF-8 character, set *size to the length, and return the code point
@@ -191,13 +232,29 @@ parse_utf8_char(SerdWriter* writer, const uint8_t* utf8, size_t* size)
 	return c;
 }
 
+// Write a \\uXXXX or \\UXXXXXXXX escape for code point `c`
+static size_t
+write_escape(SerdWriter* writer, uint32_t c)
+{
+	static const char hex_chars[] = "0123456789ABCDEF";
+
+	char           escape[10] = { '\\', 'u', 0, 0, 0, 0, 0, 0, 0, 0 };
+	const unsigned n_digits   = (c <= 0xFFFF) ? 4 : 8;
+	if (n_digits == 8) {
+		escape[1] = 'U';
+	}
+	for (unsigned i = 0; i < n_digits; ++i, c >>= 4) {
+		escape[n_digits + 1 - i] = hex_chars[c & 0xF];
+	}
+	return sink(escape, n_digits + 2, writer);
+}
+
 // Write a single character, as an escape for single byte characters
 // (Caller prints any single byte characters that don't need escaping)
 static size_t
 write_character(SerdWriter* writer, const uint8_t* utf8, size_t* size)
 {
 	const uint8_t replacement_char[] = { 0xEF, 0xBF, 0xBD };
-	char          escape[11]         = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 	const uint8_t in                 = utf8[0];
 
 	uint32_t c = parse_utf8_char(writer, utf8, size);
@@ -206,8 +263,7 @@ write_character(SerdWriter* writer, const uint8_t* utf8, size_t* size)
 		w_err(writer, SERD_ERR_BAD_ARG, "invalid UTF-8: %X\n", in);
 		return sink(replacement_char, sizeof(replacement_char), writer);
 	case 1:
-		snprintf(escape, sizeof(escape), "\\u%04X", in);
-		return sink(escape, 6, writer);
+		return write_escape(writer, in);
 	default:
 		break;
 	}
@@ -217,25 +273,64 @@ write_character(SerdWriter* writer, const uint8_t* utf8, size_t* size)
 		return sink(utf8, *size, writer);
 	}
 
-	if (c <= 0xFFFF) {
-		snprintf(escape, sizeof(escape), "\\u%04X", c);
-		return sink(escape, 6, writer);
-	} else {
-		snprintf(escape, sizeof(escape), "\\U%08X", c);
-		return sink(escape, 10, writer);
-	}
+	return write_escape(writer, c);
 }
 
+typedef enum {
+	ESCAPE_TEXT  = 1,      ///< Must be escaped in a string
+	ESCAPE_URI   = 1 << 1, ///< Must be escaped in a URI
+	ESCAPE_LNAME = 1 << 2  ///< Must be escaped in a local name
+} EscapeFlag;
+
+/**
+   Escape table for text, URIs, and local names.
+   This is indexed by byte and contains ESCAPE_* flags, plus '0' to keep the
+   table printable.  Control characters, DEL, and all non-ASCII bytes stop
+   text and URI runs, so they can be escaped or checked by write_character.
+*/
+static const char escape_table[] =
+	"3333333333333333333333333333333324344444444440040000000000042424"
+	"4000000000000000000000000000302020000000000000000000000000022243"
+	"3333333333333333333333333333333333333333333333333333333333333333"
+	"3333333333333333333333333333333333333333333333333333333333333333";
+
 static inline bool
-uri_must_escape(const uint8_t c)
+must_escape(const uint8_t c, const EscapeFlag flag)
 {
-	switch (c) {
-	case ' ': case '"': case '<': case '>': case '\\':
-	case '^': case '`': case '{': case '|': case '}':
-		return true;
-	default:
-		return !in_range(c, 0x20, 0x7E);
+	return (escape_table[c] - '0') & flag;
+}
+
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+
+/** Return non-zero iff some byte in `x` equals `b`. */
+static inline uint64_t
+swar_has_byte(const uint64_t x, const uint8_t b)
+{
+	const uint64_t y = x ^ (SWAR_ONES * b);
+	return (y - SWAR_ONES) & ~y & SWAR_HIGHS;
+}
+
+/** Return the length of the leading run of `utf8` with no `flag` bytes. */
+static inline size_t
+clean_run_length(const uint8_t* utf8, size_t n_bytes, const EscapeFlag flag)
+{
+	size_t i = 0;
+	if (flag == ESCAPE_TEXT) {
+		// Check 8 bytes at a time for controls, DEL, non-ASCII, '"', and '\\'
+		for (; i + 8 <= n_bytes; i += 8) {
+			uint64_t x;
+			memcpy(&x, utf8 + i, sizeof(x));
+			if ((((x - SWAR_ONES * 0x20) & ~x) |
+			     (x + SWAR_ONES) | x) & SWAR_HIGHS ||
+			    swar_has_byte(x, '"') || swar_has_byte(x, '\\')) {
+				break;
+			}
+		}
 	}
+
+	for (; i < n_bytes && !must_escape(utf8[i], flag); ++i) {}
+	return i;
 }
 
 static size_t
@@ -243,12 +338,8 @@ write_uri(SerdWriter* writer, const uint8_t* utf8, size_t n_bytes)
 {
 	size_t len = 0;
 	for (size_t i = 0; i < n_bytes;) {
-		size_t j = i;  // Index of next character that must be escaped
-		for (; j < n_bytes; ++j) {
-			if (uri_must_escape(utf8[j])) {
-				break;
-			}
-		}
+		// Index of next character that must be escaped
+		const size_t j = i + clean_run_length(utf8 + i, n_bytes - i, ESCAPE_URI);
 
 		// Bulk write all characters up to this special one
 		len += sink(&utf8[i], j - i, writer);
@@ -264,8 +355,8 @@ write_uri(SerdWriter* writer, const uint8_t* utf8, size_t n_bytes)
 	return len;
 }
 
-static bool
-lname_must_escape(const uint8_t c)
+static size_t
+write_lname(SerdWriter* writer, const uint8_t* utf8, size_t n_bytes)
 {
 	/* This arbitrary list of characters, most of which have nothing to do with
 	   Turtle, must be handled as special cases here because the RDF and SPARQL
@@ -274,28 +365,14 @@ lname_must_escape(const uint8_t c)
 	   out the window for no good reason.
 
 	   Note '-', '.', and '_' are also in PN_LOCAL_ESC, but are valid unescaped
-	   in local names, so they are not escaped here. */
+	   in local names, so they are not escaped here.  The escaped characters
+	   are marked with ESCAPE_LNAME in escape_table. */
 
-	switch (c) {
-	case '\'': case '!': case '#': case '$': case '%': case '&':
-	case '(': case ')': case '*': case '+': case ',': case '/':
-	case ';': case '=': case '?': case '@': case '~':
-		return true;
-	}
-	return false;
-}
-
-static size_t
-write_lname(SerdWriter* writer, const uint8_t* utf8, size_t n_bytes)
-{
 	size_t len = 0;
 	for (size_t i = 0; i < n_bytes; ++i) {
-		size_t j = i;  // Index of next character that must be escaped
-		for (; j < n_bytes; ++j) {
-			if (lname_must_escape(utf8[j])) {
-				break;
-			}
-		}
+		// Index of next character that must be escaped
+		const size_t j =
+			i + clean_run_length(utf8 + i, n_bytes - i, ESCAPE_LNAME);
 
 		// Bulk write all characters up to this special one
 		len += sink(&utf8[i], j - i, writer);
@@ -317,13 +394,8 @@ write_text(SerdWriter* writer, TextContext ctx,
 	size_t len = 0;
 	for (size_t i = 0; i < n_bytes;) {
 		// Fast bulk write for long strings of printable ASCII
-		size_t j = i;
-		for (; j < n_bytes; ++j) {
-			if (utf8[j] == '\\' || utf8[j] == '"'
-			    || (!in_range(utf8[j], 0x20, 0x7E))) {
-				break;
-			}
-		}
+		const size_t j =
+			i + clean_run_length(utf8 + i, n_bytes - i, ESCAPE_TEXT);
 
 		len += sink(&utf8[i], j - i, writer);
 		if ((i = j) == n_bytes) {
@@ -382,12 +454,104 @@ uri_sink(const void* buf, size_t len, void* stream)
 	return write_uri((SerdWriter*)stream, (const uint8_t*)buf, len);
 }
 
+/** Recalculate the base/root relationship after either has changed. */
+static void
+update_base(SerdWriter* writer)
+{
+	const SerdURI* base = &writer->base_uri;
+
+	writer->rooted = uri_is_under(base, &writer->root_uri);
+	serd_free(writer->allocator, writer->base_str);
+	writer->base_str     = NULL;
+	writer->base_dir_len = 0;
+	writer->base_str_len = 0;
+	if (!base->scheme.len) {
+		return;
+	}
+
+	// Find the last separator in the base path
+	const size_t path_len = uri_path_len(base);
+	size_t       last_sep = 0;
+	for (size_t i = 0; i < path_len; ++i) {
+		if (uri_path_at(base, i) == '/') {
+			last_sep = i;
+		}
+	}
+	if (last_sep == 0) {
+		return;  // Relative paths are written from the root, no fast path
+	}
+
+	SerdBuffer buf = { writer->allocator, { NULL, 0 } };
+	serd_buffer_sink(base->scheme.buf, base->scheme.len, &buf);
+	serd_buffer_sink(":", 1, &buf);
+	if (base->authority.buf) {
+		serd_buffer_sink("//", 2, &buf);
+		serd_buffer_sink(base->authority.buf, base->authority.len, &buf);
+	}
+	const size_t dir_len = buf.chunk.len + last_sep + 1;
+	if (base->path_base.len) {
+		serd_buffer_sink(base->path_base.buf, base->path_base.len, &buf);
+	}
+	if (base->path.len) {
+		serd_buffer_sink(base->path.buf, base->path.len, &buf);
+	}
+
+	writer->base_str_len = buf.chunk.len;
+	writer->base_str     = serd_buffer_sink_finish(&buf);
+	writer->base_dir_len = dir_len;
+}
+
+/**
+   Write `node` relative to the base directory if it is simply an extension of
+   it, which is equivalent to, but much faster than, general relativisation.
+   Return false if the general case must be used.
+*/
+static bool
+write_rel_uri(SerdWriter* writer, const SerdNode* node)
+{
+	const size_t dir_len = writer->base_dir_len;
+	if (!dir_len || writer->syntax == SERD_NTRIPLES ||
+	    node->n_bytes <= dir_len ||
+	    memcmp(node->buf, writer->base_str, dir_len)) {
+		return false;
+	}
+
+	const uint8_t* const rel      = node->buf + dir_len;
+	const size_t         rel_len  = node->n_bytes - dir_len;
+	const size_t         name_len = writer->base_str_len - dir_len;
+	size_t               path_len = 0;
+	while (path_len < rel_len && rel[path_len] != '?' && rel[path_len] != '#') {
+		++path_len;
+	}
+
+	if (!path_len || (path_len == name_len &&
+	                  !memcmp(rel, writer->base_str + dir_len, name_len))) {
+		return false;  // Same document as base, which has special rules
+	}
+
+	if (rel[0] == '/') {
+		return false;  // Base path has an empty segment, would read as absolute
+	}
+	for (size_t i = 0; i < path_len && rel[i] != '/'; ++i) {
+		if (rel[i] == ':') {
+			return false;  // First segment would read as a scheme
+		}
+	}
+
+	write_uri(writer, rel, rel_len);
+	return true;
+}
+
 static void
 write_newline(SerdWriter* writer)
 {
-	sink("\n", 1, writer);
-	for (unsigned i = 0; i < writer->indent; ++i) {
-		sink("\t", 1, writer);
+	static const char   tabs[] = "\n\t\t\t\t\t\t\t\t";
+	static const size_t n_tabs = sizeof(tabs) - 2;
+
+	size_t n = writer->indent;
+	sink(tabs, MIN(n, n_tabs) + 1, writer);
+	for (n -= MIN(n, n_tabs); n > 0; n -= MIN(n, n_tabs)) {
+		sink(tabs + 1, MIN(n, n_tabs), writer);
 	}
 }
 
@@ -414,10 +578,7 @@ static SerdStatus
 reset_context(SerdWriter* writer, bool del)
 {
 	if (del) {
-		serd_node_free(&writer->context.graph);
-		serd_node_free(&writer->context.subject);
-		serd_node_free(&writer->context.predicate);
-		writer->context = WRITE_CONTEXT_NULL;
+		free_context(writer->allocator, &writer->context);
 	} else {
 		writer->context.graph.type     = SERD_NOTHING;
 		writer->context.subject.type   = SERD_NOTHING;
@@ -462,7 +623,8 @@ write_node(SerdWriter*        writer,
 		} else if (writer->syntax != SERD_NTRIPLES
 		           && (field == FIELD_SUBJECT && (flags & SERD_LIST_S_BEGIN))) {
 			assert(writer->list_depth == 0);
-			copy_node(&writer->list_subj, node);
+			copy_node(
+				writer, &writer->list_subj, &writer->list_subj_size, node);
 			++writer->list_depth;
 			++writer->indent;
 			write_sep(writer, SEP_LIST_BEGIN);
@@ -516,13 +678,11 @@ write_node(SerdWriter*        writer,
 		break;
 	case SERD_LITERAL:
 		if (writer->syntax == SERD_TURTLE && datatype && datatype->buf) {
-			const char* type_uri = (const char*)datatype->buf;
-			if (!strncmp(type_uri, NS_XSD, sizeof(NS_XSD) - 1) && (
-				    !strcmp(type_uri + sizeof(NS_XSD) - 1, "boolean") ||
-				    !strcmp(type_uri + sizeof(NS_XSD) - 1, "integer"))) {
+			if (serd_node_is_vocab(datatype, SERD_XSD_BOOLEAN) ||
+			    serd_node_is_vocab(datatype, SERD_XSD_INTEGER)) {
 				sink(node->buf, node->n_bytes, writer);
 				break;
-			} else if (!strcmp(type_uri + sizeof(NS_XSD) - 1, "decimal") &&
+			} else if (serd_node_is_vocab(datatype, SERD_XSD_DECIMAL) &&
 			           strchr((const char*)node->buf, '.') &&
 			           node->buf[node->n_bytes - 1] != '.') {
 				/* xsd:decimal literals without trailing digits, e.g. "5.", can
@@ -559,11 +719,11 @@ write_node(SerdWriter*        writer,
 		}
 		has_scheme = serd_uri_string_has_scheme(node->buf);
 		if (field == FIELD_PREDICATE && (writer->syntax == SERD_TURTLE)
-		    && !strcmp((const char*)node->buf, NS_RDF "type")) {
+		    && serd_node_is_vocab(node, SERD_RDF_TYPE)) {
 			sink("a", 1, writer);
 			break;
 		} else if ((writer->syntax == SERD_TURTLE)
-		           && !strcmp((const char*)node->buf, NS_RDF "nil")) {
+		           && serd_node_is_vocab(node, SERD_RDF_NIL)) {
 			sink("()", 2, writer);
 			break;
 		} else if (has_scheme && (writer->style & SERD_STYLE_CURIED) &&
@@ -574,13 +734,15 @@ write_node(SerdWriter*        writer,
 			break;
 		}
 		sink("<", 1, writer);
-		if (writer->style & SERD_STYLE_RESOLVED) {
+		if (!(writer->style & SERD_STYLE_RESOLVED)) {
+			write_uri(writer, node->buf, node->n_bytes);
+		} else if (!write_rel_uri(writer, node)) {
 			SerdURI in_base_uri, uri, abs_uri;
 			serd_env_get_base_uri(writer->env, &in_base_uri);
-			serd_uri_parse(node->buf, &uri);
+			serd_uri_parse_chunk(node->buf, node->n_bytes, &uri);
 			serd_uri_resolve(&uri, &in_base_uri, &abs_uri);
-			bool rooted = uri_is_under(&writer->base_uri, &writer->root_uri);
-			SerdURI* root = rooted ? &writer->root_uri : & writer->base_uri;
+			const SerdURI* root = (writer->rooted ? &writer->root_uri
+			                       : &writer->base_uri);
 			if (!uri_is_under(&abs_uri, root) ||
 			    writer->syntax == SERD_NTRIPLES) {
 				serd_uri_serialise(&abs_uri, uri_sink, writer);
@@ -588,8 +750,6 @@ write_node(SerdWriter*        writer,
 				serd_uri_serialise_relative(
 					&uri, &writer->base_uri, root, uri_sink, writer);
 			}
-		} else {
-			write_uri(writer, node->buf, node->n_bytes);
 		}
 		sink(">", 1, writer);
 		if (is_inline_start(writer, field, flags)) {
@@ -614,7 +774,10 @@ write_pred(SerdWriter* writer, SerdStatementFlags flags, const SerdNode* pred)
 {
 	write_node(writer, pred, NULL, NULL, FIELD_PREDICATE, flags);
 	write_sep(writer, SEP_P_O);
-	copy_node(&writer->context.predicate, pred);
+	copy_node(writer,
+	          &writer->context.predicate,
+	          &writer->context.predicate_size,
+	          pred);
 }
 
 static bool
@@ -625,27 +788,26 @@ write_list_obj(SerdWriter*        writer,
                const SerdNode*    datatype,
                const SerdNode*    lang)
 {
-	if (!strcmp((const char*)object->buf, NS_RDF "nil")) {
+	if (serd_node_is_vocab(object, SERD_RDF_NIL)) {
 		--writer->indent;
 		write_sep(writer, SEP_LIST_END);
 		return true;
-	} else if (!strcmp((const char*)predicate->buf, NS_RDF "first")) {
+	} else if (serd_node_is_vocab(predicate, SERD_RDF_FIRST)) {
 		write_sep(writer, SEP_LIST_SEP);
 		write_node(writer, object, datatype, lang, FIELD_OBJECT, flags);
 	}
 	return false;
 }
 
-SERD_API
-SerdStatus
-serd_writer_write_statement(SerdWriter*        writer,
-                            SerdStatementFlags flags,
-                            const SerdNode*    graph,
-                            const SerdNode*    subject,
-                            const SerdNode*    predicate,
-                            const SerdNode*    object,
-                            const SerdNode*    datatype,
-                            const SerdNode*    lang)
+static SerdStatus
+write_statement(SerdWriter*        writer,
+                SerdStatementFlags flags,
+                const SerdNode*    graph,
+                const SerdNode*    subject,
+                const SerdNode*    predicate,
+                const SerdNode*    object,
+                const SerdNode*    datatype,
+                const SerdNode*    lang)
 {
 	if (!subject || !predicate || !object
 	    || !subject->buf || !predicate->buf || !object->buf
@@ -675,14 +837,20 @@ serd_writer_write_statement(SerdWriter*        writer,
 		if (write_list_obj(writer, flags, predicate, object, datatype, lang)) {
 			// Reached end of list
 			if (--writer->list_depth == 0 && writer->list_subj.type) {
-				reset_context(writer, true);
-				writer->context.subject = writer->list_subj;
-				writer->list_subj       = SERD_NODE_NULL;
+				// Swap list subject into context, keeping old buffer for reuse
+				const SerdNode subj      = writer->context.subject;
+				const size_t   subj_size = writer->context.subject_size;
+				reset_context(writer, false);
+				writer->context.subject      = writer->list_subj;
+				writer->context.subject_size = writer->list_subj_size;
+				writer->list_subj            = subj;
+				writer->list_subj_size       = subj_size;
+				writer->list_subj.type       = SERD_NOTHING;
 			}
 			return SERD_SUCCESS;
 		}
-	} else if (serd_node_equals(subject, &writer->context.subject)) {
-		if (serd_node_equals(predicate, &writer->context.predicate)) {
+	} else if (context_equals(subject, &writer->context.subject)) {
+		if (context_equals(predicate, &writer->context.predicate)) {
 			// Abbreviate S P
 			if (!(flags & SERD_ANON_O_BEGIN)) {
 				++writer->indent;
@@ -719,8 +887,11 @@ serd_writer_write_statement(SerdWriter*        writer,
 			++writer->indent;
 		}
 
-		reset_context(writer, true);
-		copy_node(&writer->context.subject, subject);
+		reset_context(writer, false);
+		copy_node(writer,
+		          &writer->context.subject,
+		          &writer->context.subject_size,
+		          subject);
 
 		if (!(flags & SERD_LIST_S_BEGIN)) {
 			write_pred(writer, flags, predicate);
@@ -729,25 +900,47 @@ serd_writer_write_statement(SerdWriter*        writer,
 		write_node(writer, object, datatype, lang, FIELD_OBJECT, flags);
 	}
 
+	WriteContext* ctx = &writer->context;
 	if (flags & (SERD_ANON_S_BEGIN|SERD_ANON_O_BEGIN)) {
-		WriteContext* ctx = (WriteContext*)serd_stack_push(
+		// Save context, and reuse buffers left from an earlier anon if any
+		const bool    fresh = writer->anon_stack.size >= writer->anon_stack_peak;
+		WriteContext* top   = (WriteContext*)serd_stack_push(
 			&writer->anon_stack, sizeof(WriteContext));
-		*ctx = writer->context;
-		WriteContext new_context = {
-			serd_node_copy(graph), serd_node_copy(subject), SERD_NODE_NULL };
-		if ((flags & SERD_ANON_S_BEGIN)) {
-			new_context.predicate = serd_node_copy(predicate);
+		const WriteContext spare = fresh ? WRITE_CONTEXT_NULL : *top;
+		if (fresh) {
+			writer->anon_stack_peak = writer->anon_stack.size;
 		}
-		writer->context = new_context;
+		*top = *ctx;
+		*ctx = spare;
+		copy_node(writer, &ctx->graph, &ctx->graph_size, graph);
+		copy_node(writer, &ctx->subject, &ctx->subject_size, subject);
+		copy_node(writer, &ctx->predicate, &ctx->predicate_size,
+		          (flags & SERD_ANON_S_BEGIN) ? predicate : NULL);
 	} else {
-		copy_node(&writer->context.graph, graph);
-		copy_node(&writer->context.subject, subject);
-		copy_node(&writer->context.predicate, predicate);
+		copy_node(writer, &ctx->graph, &ctx->graph_size, graph);
+		copy_node(writer, &ctx->subject, &ctx->subject_size, subject);
+		copy_node(writer, &ctx->predicate, &ctx->predicate_size, predicate);
 	}
 
 	return SERD_SUCCESS;
 }
 
+SERD_API
+SerdStatus
+serd_writer_write_statement(SerdWriter*        writer,
+                            SerdStatementFlags flags,
+                            const SerdNode*    graph,
+                            const SerdNode*    subject,
+                            const SerdNode*    predicate,
+                            const SerdNode*    object,
+                            const SerdNode*    datatype,
+                            const SerdNode*    lang)
+{
+	return end_call(writer,
+	                write_statement(writer, flags, graph, subject, predicate,
+	                                object, datatype, lang));
+}
+
 SERD_API
 SerdStatus
 serd_writer_end_anon(SerdWriter*     writer,
@@ -763,15 +956,24 @@ serd_writer_end_anon(SerdWriter*     writer,
 	}
 	--writer->indent;
 	write_sep(writer, SEP_ANON_END);
-	reset_context(writer, true);
-	writer->context = *anon_stack_top(writer);
+	reset_context(writer, false);
+
+	// Restore outer context, and leave this one in the stack for reuse
+	WriteContext* const top   = anon_stack_top(writer);
+	const WriteContext  inner = writer->context;
+	writer->context = *top;
+	*top            = inner;
 	serd_stack_pop(&writer->anon_stack, sizeof(WriteContext));
+
 	const bool is_subject = serd_node_equals(node, &writer->context.subject);
 	if (is_subject) {
-		copy_node(&writer->context.subject, node);
+		copy_node(writer,
+		          &writer->context.subject,
+		          &writer->context.subject_size,
+		          node);
 		writer->context.predicate.type = SERD_NOTHING;
 	}
-	return SERD_SUCCESS;
+	return end_call(writer, SERD_SUCCESS);
 }
 
 SERD_API
@@ -781,9 +983,7 @@ serd_writer_finish(SerdWriter* writer)
 	if (writer->context.subject.type) {
 		sink(" .\n", 3, writer);
 	}
-	if (writer->style & SERD_STYLE_BULK) {
-		serd_bulk_sink_flush(&writer->bulk_sink);
-	}
+	serd_bulk_sink_flush(&writer->bulk_sink);
 	writer->indent = 0;
 	return reset_context(writer, true);
 }
@@ -796,31 +996,56 @@ serd_writer_new(SerdSyntax     syntax,
                 const SerdURI* base_uri,
                 SerdSink       ssink,
                 void*          stream)
+{
+	return serd_writer_new_with_allocator(
+		NULL, syntax, style, env, base_uri, ssink, stream);
+}
+
+SERD_API
+SerdWriter*
+serd_writer_new_with_allocator(const SerdAllocator* allocator,
+                               SerdSyntax           syntax,
+                               SerdStyle            style,
+                               SerdEnv*             env,
+                               const SerdURI*       base_uri,
+                               SerdSink             ssink,
+                               void*                stream)
 {
 	const WriteContext context = WRITE_CONTEXT_NULL;
-	SerdWriter*        writer  = (SerdWriter*)malloc(sizeof(SerdWriter));
+	SerdWriter*        writer  = (SerdWriter*)serd_malloc(
+		allocator, sizeof(SerdWriter));
+	if (!writer) {
+		return NULL;
+	}
+
+	writer->allocator    = allocator;
 	writer->syntax       = syntax;
 	writer->style        = style;
 	writer->env          = env;
 	writer->root_node    = SERD_NODE_NULL;
 	writer->root_uri     = SERD_URI_NULL;
 	writer->base_uri     = base_uri ? *base_uri : SERD_URI_NULL;
-	writer->anon_stack   = serd_stack_new(sizeof(WriteContext));
+	writer->base_str     = NULL;
+	writer->anon_stack   = serd_stack_new(allocator, sizeof(WriteContext));
+	writer->anon_stack_peak = writer->anon_stack.size;
+	writer->bulk_sink    = serd_bulk_sink_new(
+		allocator, ssink, stream, SERD_PAGE_SIZE);
 	writer->sink         = ssink;
 	writer->stream       = stream;
+	writer->flush        = ((style & SERD_STYLE_BULK)
+	                        ? SERD_FLUSH_FULL : SERD_FLUSH_STATEMENT);
 	writer->error_sink   = NULL;
 	writer->error_handle = NULL;
 	writer->context      = context;
 	writer->list_subj    = SERD_NODE_NULL;
+	writer->list_subj_size = 0;
 	writer->list_depth   = 0;
 	writer->bprefix      = NULL;
 	writer->bprefix_len  = 0;
 	writer->indent       = 0;
 	writer->last_sep     = SEP_NONE;
 	writer->empty        = true;
-	if (style & SERD_STYLE_BULK) {
-		writer->bulk_sink = serd_bulk_sink_new(ssink, stream, SERD_PAGE_SIZE);
-	}
+	update_base(writer);
 	return writer;
 }
 
@@ -834,17 +1059,39 @@ serd_writer_set_error_sink(SerdWriter*   writer,
 	writer->error_handle = error_handle;
 }
 
+SERD_API
+void
+serd_writer_set_buffer(SerdWriter*     writer,
+                       size_t          size,
+                       SerdFlushPolicy policy)
+{
+	serd_bulk_sink_free(&writer->bulk_sink);
+	writer->bulk_sink = serd_bulk_sink_new(writer->allocator,
+	                                       writer->sink,
+	                                       writer->stream,
+	                                       size ? size : SERD_PAGE_SIZE);
+	writer->flush = policy;
+}
+
+SERD_API
+void
+serd_writer_flush(SerdWriter* writer)
+{
+	serd_bulk_sink_flush(&writer->bulk_sink);
+}
+
 SERD_API
 void
 serd_writer_chop_blank_prefix(SerdWriter*    writer,
                               const uint8_t* prefix)
 {
-	free(writer->bprefix);
+	serd_free(writer->allocator, writer->bprefix);
 	writer->bprefix_len = 0;
 	writer->bprefix     = NULL;
 	if (prefix) {
 		writer->bprefix_len = strlen((const char*)prefix);
-		writer->bprefix     = (uint8_t*)malloc(writer->bprefix_len + 1);
+		writer->bprefix     = (uint8_t*)serd_malloc(
+			writer->allocator, writer->bprefix_len + 1);
 		memcpy(writer->bprefix, prefix, writer->bprefix_len + 1);
 	}
 }
@@ -856,6 +1103,7 @@ serd_writer_set_base_uri(SerdWriter*     writer,
 {
 	if (!serd_env_set_base_uri(writer->env, uri)) {
 		serd_env_get_base_uri(writer->env, &writer->base_uri);
+		update_base(writer);
 
 		if (writer->syntax != SERD_NTRIPLES) {
 			if (writer->context.graph.type || writer->context.subject.type) {
@@ -867,7 +1115,7 @@ serd_writer_set_base_uri(SerdWriter*     writer,
 			sink("> .\n", 4, writer);
 		}
 		writer->indent = 0;
-		return reset_context(writer, false);
+		return end_call(writer, reset_context(writer, false));
 	}
 	return SERD_ERR_UNKNOWN;
 }
@@ -877,14 +1125,16 @@ SerdStatus
 serd_writer_set_root_uri(SerdWriter*     writer,
                          const SerdNode* uri)
 {
-	serd_node_free(&writer->root_node);
+	serd_node_free_with_allocator(writer->allocator, &writer->root_node);
 	if (uri && uri->buf) {
-		writer->root_node = serd_node_copy(uri);
-		serd_uri_parse(uri->buf, &writer->root_uri);
+		writer->root_node = serd_node_copy_with_allocator(
+			writer->allocator, uri);
+		serd_uri_parse_chunk(uri->buf, uri->n_bytes, &writer->root_uri);
 	} else {
 		writer->root_node = SERD_NODE_NULL;
 		writer->root_uri  = SERD_URI_NULL;
 	}
+	update_base(writer);
 	return SERD_SUCCESS;
 }
 
@@ -907,7 +1157,7 @@ serd_writer_set_prefix(SerdWriter*     writer,
 			sink("> .\n", 4, writer);
 		}
 		writer->indent = 0;
-		return reset_context(writer, false);
+		return end_call(writer, reset_context(writer, false));
 	}
 	return SERD_ERR_UNKNOWN;
 }
@@ -916,14 +1166,20 @@ SERD_API
 void
 serd_writer_free(SerdWriter* writer)
 {
+	const SerdAllocator* const allocator = writer->allocator;
+
 	serd_writer_finish(writer);
-	serd_stack_free(&writer->anon_stack);
-	free(writer->bprefix);
-	if (writer->style & SERD_STYLE_BULK) {
-		serd_bulk_sink_free(&writer->bulk_sink);
+	for (size_t i = SERD_STACK_BOTTOM; i < writer->anon_stack_peak;
+	     i += sizeof(WriteContext)) {
+		free_context(allocator, (WriteContext*)(writer->anon_stack.buf + i));
 	}
-	serd_node_free(&writer->root_node);
-	free(writer);
+	serd_stack_free(&writer->anon_stack);
+	serd_node_free_with_allocator(allocator, &writer->list_subj);
+	serd_free(allocator, writer->bprefix);
+	serd_bulk_sink_free(&writer->bulk_sink);
+	serd_node_free_with_allocator(allocator, &writer->root_node);
+	serd_free(allocator, writer->base_str);
+	serd_free(allocator, writer);
 }
 
 SERD_API
@@ -0,0 +1,618 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/**
+   End-to-end throughput benchmark.
+
+   This generates a synthetic document with the given shape, then measures
+   reading it to a null sink, writing it from memory, and reading it straight
+   into a writer, in Turtle and NTriples and with each reader input mode.
+   Results are written as JSON for comparison between versions and machines.
+*/
+
+#define _POSIX_C_SOURCE 201112L /* for clock_gettime */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "serd/serd.h"
+#include "serd_config.h"
+
+#define BENCH_ERRORF(fmt, ...) fprintf(stderr, "serd_bench: " fmt, __VA_ARGS__);
+
+static const uint8_t* const doc_name = (const uint8_t*)"(generated)";
+
+/** Shape of the generated document. */
+typedef struct {
+	unsigned long n_statements;  ///< Approximate number of statements
+	unsigned      iri_len;       ///< Length of object IRIs
+	unsigned      literal_len;   ///< Length of literals (unescaped)
+	unsigned      escape_pct;    ///< Percentage of literal characters escaped
+	unsigned      n_prefixes;    ///< Number of namespace prefixes
+	unsigned      depth;         ///< Nesting depth of anonymous blank nodes
+	unsigned      list_len;      ///< Length of collections
+	unsigned      repeat;        ///< Number of runs (best is reported)
+} Params;
+
+/** A growing string. */
+typedef struct {
+	char*  buf;
+	size_t len;
+	size_t size;
+} Text;
+
+/** A recorded reader event, for writing from memory. */
+typedef struct {
+	SerdStatementFlags flags;
+	SerdNode           nodes[6];  ///< Graph, S, P, O, datatype, language
+	bool               is_end;    ///< End of anonymous node nodes[1]
+} Event;
+
+typedef struct {
+	Event* events;
+	size_t n_events;
+	size_t size;
+} Events;
+
+/** Counters updated by the null sinks. */
+typedef struct {
+	size_t n_statements;
+	size_t n_bytes;
+} Counts;
+
+typedef enum {
+	MODE_PAGED,
+	MODE_BYTES,
+	MODE_STRING
+} ReadMode;
+
+static const char* const mode_names[] = { "paged", "bytes", "string" };
+
+static double
+now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Generator */
+
+static void
+text_append(Text* text, const char* str, size_t len)
+{
+	if (text->len + len + 1 > text->size) {
+		while (text->len + len + 1 > text->size) {
+			text->size = text->size ? text->size * 2 : 4096;
+		}
+		text->buf = (char*)realloc(text->buf, text->size);
+	}
+	memcpy(text->buf + text->len, str, len);
+	text->len += len;
+	text->buf[text->len] = '\0';
+}
+
+static void
+text_printf(Text* text, const char* fmt, ...)
+{
+	char    buf[256];
+	va_list args;
+	va_start(args, fmt);
+	const int len = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	text_append(text, buf, (size_t)len < sizeof(buf) ? (size_t)len
+	                                                  : sizeof(buf) - 1);
+}
+
+/** Deterministic pseudo-random numbers so runs are comparable. */
+static unsigned
+next_rand(unsigned long* state)
+{
+	*state = *state * 6364136223846793005UL + 1442695040888963407UL;
+	return (unsigned)(*state >> 33);
+}
+
+/** Append a resource name, as a CURIE if there are prefixes. */
+static void
+write_name(Text* text, const Params* params, const char* kind, unsigned long i)
+{
+	if (params->n_prefixes) {
+		text_printf(text, "ex%lu:%s%lu", i % params->n_prefixes, kind, i);
+	} else {
+		text_printf(text, "<http://example.org/ns/%s%lu>", kind, i);
+	}
+}
+
+static void
+write_iri(Text* text, const Params* params, unsigned long i)
+{
+	static const char pad[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+	char head[64];
+	int  len = snprintf(head, sizeof(head), "http://example.org/iri/%lu/", i);
+	text_append(text, "<", 1);
+	text_append(text, head, (size_t)len);
+	for (unsigned c = (unsigned)len; c < params->iri_len; ++c) {
+		text_append(text, &pad[(c + i) % (sizeof(pad) - 1)], 1);
+	}
+	text_append(text, ">", 1);
+}
+
+static void
+write_literal(Text* text, const Params* params, unsigned long* rng)
+{
+	static const char* const escapes[] = { "\\n", "\\\"", "\\\\", "\\u00E9" };
+	static const char        plain[]   = "abcdefghijklm nopqrstuvwxyz";
+
+	text_append(text, "\"", 1);
+	for (unsigned c = 0; c < params->literal_len; ++c) {
+		const unsigned r = next_rand(rng);
+		if (r % 100 < params->escape_pct) {
+			const char* esc = escapes[(r / 100) % 4];
+			text_append(text, esc, strlen(esc));
+		} else {
+			text_append(text, &plain[(r / 100) % (sizeof(plain) - 1)], 1);
+		}
+	}
+	text_append(text, "\"", 1);
+}
+
+/** Generate a Turtle document with about params->n_statements statements. */
+static void
+generate(Text* text, const Params* params)
+{
+	unsigned long rng = 1;
+	for (unsigned p = 0; p < params->n_prefixes; ++p) {
+		text_printf(text, "@prefix ex%u: <http://example.org/ns%u/> .\n", p, p);
+	}
+
+	unsigned long n = 0;
+	for (unsigned long i = 0; n < params->n_statements; ++i) {
+		write_name(text, params, "s", i);
+		text_append(text, " ", 1);
+		write_name(text, params, "p", i % 7);
+		text_append(text, " ", 1);
+		switch (i % 4) {
+		case 0:
+			write_iri(text, params, i);
+			++n;
+			break;
+		case 1:
+			write_literal(text, params, &rng);
+			++n;
+			break;
+		case 2:
+			for (unsigned d = 0; d < params->depth; ++d) {
+				text_append(text, "[ ", 2);
+				write_name(text, params, "q", d);
+				text_append(text, " ", 1);
+			}
+			write_literal(text, params, &rng);
+			for (unsigned d = 0; d < params->depth; ++d) {
+				text_append(text, " ]", 2);
+			}
+			n += params->depth + 1;
+			break;
+		default:
+			text_append(text, "(", 1);
+			for (unsigned l = 0; l < params->list_len; ++l) {
+				text_append(text, " ", 1);
+				write_name(text, params, "o", l);
+			}
+			text_append(text, " )", 2);
+			n += 1 + 2 * params->list_len;
+		}
+		text_append(text, " .\n", 3);
+	}
+}
+
+/* Sinks */
+
+static size_t
+count_sink(const void* buf, size_t len, void* stream)
+{
+	(void)buf;
+	((Counts*)stream)->n_bytes += len;
+	return len;
+}
+
+static size_t
+text_sink(const void* buf, size_t len, void* stream)
+{
+	text_append((Text*)stream, (const char*)buf, len);
+	return len;
+}
+
+static SerdStatus
+count_statement(void*              handle,
+                SerdStatementFlags flags,
+                const SerdNode*    graph,
+                const SerdNode*    subject,
+                const SerdNode*    predicate,
+                const SerdNode*    object,
+                const SerdNode*    object_datatype,
+                const SerdNode*    object_lang)
+{
+	(void)flags; (void)graph; (void)subject; (void)predicate;
+	(void)object; (void)object_datatype; (void)object_lang;
+	++((Counts*)handle)->n_statements;
+	return SERD_SUCCESS;
+}
+
+static Event*
+push_event(Events* events)
+{
+	if (events->n_events == events->size) {
+		events->size   = events->size ? events->size * 2 : 1024;
+		events->events = (Event*)realloc(events->events,
+		                                 events->size * sizeof(Event));
+	}
+	Event* ev = &events->events[events->n_events++];
+	memset(ev, 0, sizeof(Event));
+	return ev;
+}
+
+static SerdStatus
+record_statement(void*              handle,
+                 SerdStatementFlags flags,
+                 const SerdNode*    graph,
+                 const SerdNode*    subject,
+                 const SerdNode*    predicate,
+                 const SerdNode*    object,
+                 const SerdNode*    object_datatype,
+                 const SerdNode*    object_lang)
+{
+	Event* ev    = push_event((Events*)handle);
+	ev->flags    = flags;
+	ev->nodes[0] = serd_node_copy(graph);
+	ev->nodes[1] = serd_node_copy(subject);
+	ev->nodes[2] = serd_node_copy(predicate);
+	ev->nodes[3] = serd_node_copy(object);
+	ev->nodes[4] = serd_node_copy(object_datatype);
+	ev->nodes[5] = serd_node_copy(object_lang);
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+record_end(void* handle, const SerdNode* node)
+{
+	Event* ev    = push_event((Events*)handle);
+	ev->is_end   = true;
+	ev->nodes[1] = serd_node_copy(node);
+	return SERD_SUCCESS;
+}
+
+static const SerdNode*
+opt_node(const SerdNode* node)
+{
+	return node->buf ? node : NULL;
+}
+
+static void
+events_free(Events* events)
+{
+	for (size_t i = 0; i < events->n_events; ++i) {
+		for (unsigned n = 0; n < 6; ++n) {
+			serd_node_free(&events->events[i].nodes[n]);
+		}
+	}
+	free(events->events);
+}
+
+/* Benchmarks */
+
+static SerdStatus
+read_doc(SerdReader* reader, const Text* doc, FILE* file, ReadMode mode)
+{
+	SerdStatus st = SERD_SUCCESS;
+	switch (mode) {
+	case MODE_PAGED:
+		rewind(file);
+		return serd_reader_read_file_handle(reader, file, doc_name);
+	case MODE_BYTES:
+		rewind(file);
+		if (!(st = serd_reader_start_stream(reader, file, doc_name, false))) {
+			while (!(st = serd_reader_read_chunk(reader))) {}
+			serd_reader_end_stream(reader);
+		}
+		return st > SERD_FAILURE ? st : SERD_SUCCESS;
+	case MODE_STRING:
+		return serd_reader_read_string(reader, (const uint8_t*)doc->buf);
+	}
+	return st;
+}
+
+/** Time reading `doc` to a null sink, or through a writer if `out_syntax`. */
+static double
+bench_read(const Text* doc,
+           FILE*       file,
+           SerdSyntax  in_syntax,
+           SerdSyntax  out_syntax,
+           ReadMode    mode,
+           Counts*     counts)
+{
+	SerdEnv*    env    = serd_env_new(NULL);
+	SerdWriter* writer = NULL;
+	SerdReader* reader = NULL;
+	if (out_syntax) {
+		writer = serd_writer_new(
+			out_syntax, SERD_STYLE_ABBREVIATED, env, NULL, count_sink, counts);
+		reader = serd_reader_new(
+			in_syntax, writer, NULL,
+			(SerdBaseSink)serd_writer_set_base_uri,
+			(SerdPrefixSink)serd_writer_set_prefix,
+			(SerdStatementSink)serd_writer_write_statement,
+			(SerdEndSink)serd_writer_end_anon);
+	} else {
+		reader = serd_reader_new(
+			in_syntax, counts, NULL, NULL, NULL, count_statement, NULL);
+	}
+
+	const double     start = now();
+	const SerdStatus st    = read_doc(reader, doc, file, mode);
+	if (writer) {
+		serd_writer_finish(writer);
+	}
+	const double elapsed = now() - start;
+
+	if (st) {
+		BENCH_ERRORF("error reading document (%s)\n", serd_strerror(st));
+	}
+	serd_reader_free(reader);
+	if (writer) {
+		serd_writer_free(writer);
+	}
+	serd_env_free(env);
+	return elapsed;
+}
+
+/** Time writing recorded `events` to a null sink. */
+static double
+bench_write(const Events* events, SerdSyntax syntax, Counts* counts)
+{
+	SerdEnv*    env    = serd_env_new(NULL);
+	SerdWriter* writer = serd_writer_new(
+		syntax, SERD_STYLE_ABBREVIATED, env, NULL, count_sink, counts);
+
+	const double start = now();
+	for (size_t i = 0; i < events->n_events; ++i) {
+		const Event* ev = &events->events[i];
+		if (ev->is_end) {
+			serd_writer_end_anon(writer, &ev->nodes[1]);
+		} else {
+			serd_writer_write_statement(writer,
+			                            ev->flags,
+			                            opt_node(&ev->nodes[0]),
+			                            &ev->nodes[1],
+			                            &ev->nodes[2],
+			                            &ev->nodes[3],
+			                            opt_node(&ev->nodes[4]),
+			                            opt_node(&ev->nodes[5]));
+			++counts->n_statements;
+		}
+	}
+	serd_writer_finish(writer);
+	const double elapsed = now() - start;
+
+	serd_writer_free(writer);
+	serd_env_free(env);
+	return elapsed;
+}
+
+static void
+print_result(FILE*         out,
+             bool          first,
+             const char*   name,
+             SerdSyntax    syntax,
+             const char*   mode,
+             size_t        n_bytes,
+             size_t        n_statements,
+             double        seconds)
+{
+	fprintf(out, "%s\n    {\"benchmark\": \"%s\", \"syntax\": \"%s\", "
+	        "\"mode\": \"%s\",\n     \"bytes\": %lu, \"statements\": %lu, "
+	        "\"seconds\": %.6f,\n     \"mb_per_s\": %.2f, "
+	        "\"statements_per_s\": %.0f}",
+	        first ? "" : ",", name,
+	        syntax == SERD_TURTLE ? "turtle" : "ntriples", mode,
+	        (unsigned long)n_bytes, (unsigned long)n_statements, seconds,
+	        (double)n_bytes / seconds / 1.0e6,
+	        (double)n_statements / seconds);
+}
+
+static int
+print_usage(const char* name, bool error)
+{
+	FILE* const os = error ? stderr : stdout;
+	fprintf(os, "%s", error ? "\n" : "");
+	fprintf(os, "Usage: %s [OPTION]...\n", name);
+	fprintf(os, "Benchmark reading and writing a generated document.\n");
+	fprintf(os, "  -d DEPTH     Nesting depth of anonymous nodes (default 2).\n");
+	fprintf(os, "  -e PERCENT   Percentage of literal characters escaped.\n");
+	fprintf(os, "  -h           Display this help and exit.\n");
+	fprintf(os, "  -i LENGTH    Length of object IRIs (default 48).\n");
+	fprintf(os, "  -l LENGTH    Length of literals (default 32).\n");
+	fprintf(os, "  -L LENGTH    Length of collections (default 3).\n");
+	fprintf(os, "  -n COUNT     Number of statements (default 100000).\n");
+	fprintf(os, "  -o FILENAME  Write JSON results to FILENAME.\n");
+	fprintf(os, "  -p COUNT     Number of namespace prefixes (default 8).\n");
+	fprintf(os, "  -r COUNT     Number of runs to take the best of (default 3).\n");
+	return error ? 1 : 0;
+}
+
+static bool
+parse_count(const char* str, unsigned long* count)
+{
+	char* end = NULL;
+	*count = strtoul(str, &end, 10);
+	return end && end != str && !*end;
+}
+
+int
+main(int argc, char** argv)
+{
+	Params      params   = { 100000, 48, 32, 5, 8, 2, 3, 3 };
+	const char* out_path = NULL;
+	for (int a = 1; a < argc; ++a) {
+		if (argv[a][0] != '-' || argv[a][1] == '\0' || argv[a][2] != '\0') {
+			BENCH_ERRORF("invalid argument `%s'\n", argv[a]);
+			return print_usage(argv[0], true);
+		} else if (argv[a][1] == 'h') {
+			return print_usage(argv[0], false);
+		} else if (++a == argc) {
+			BENCH_ERRORF("option `%s' requires an argument\n", argv[a - 1]);
+			return print_usage(argv[0], true);
+		} else if (argv[a - 1][1] == 'o') {
+			out_path = argv[a];
+			continue;
+		}
+
+		unsigned long value = 0;
+		if (!parse_count(argv[a], &value)) {
+			BENCH_ERRORF("invalid number `%s'\n", argv[a]);
+			return print_usage(argv[0], true);
+		}
+		switch (argv[a - 1][1]) {
+		case 'd': params.depth         = (unsigned)value; break;
+		case 'e': params.escape_pct    = (unsigned)value; break;
+		case 'i': params.iri_len       = (unsigned)value; break;
+		case 'l': params.literal_len   = (unsigned)value; break;
+		case 'L': params.list_len      = (unsigned)value; break;
+		case 'n': params.n_statements  = value; break;
+		case 'p': params.n_prefixes    = (unsigned)value; break;
+		case 'r': params.repeat        = value ? (unsigned)value : 1; break;
+		default:
+			BENCH_ERRORF("invalid option `%s'\n", argv[a - 1]);
+			return print_usage(argv[0], true);
+		}
+	}
+
+	// Generate the Turtle document, and convert it to NTriples
+	Text ttl = { NULL, 0, 0 };
+	Text nt  = { NULL, 0, 0 };
+	generate(&ttl, &params);
+	{
+		SerdEnv*    env    = serd_env_new(NULL);
+		SerdWriter* writer = serd_writer_new(
+			SERD_NTRIPLES, (SerdStyle)0, env, NULL, text_sink, &nt);
+		SerdReader* reader = serd_reader_new(
+			SERD_TURTLE, writer, NULL,
+			(SerdBaseSink)serd_writer_set_base_uri,
+			(SerdPrefixSink)serd_writer_set_prefix,
+			(SerdStatementSink)serd_writer_write_statement,
+			(SerdEndSink)serd_writer_end_anon);
+		const SerdStatus st = serd_reader_read_string(
+			reader, (const uint8_t*)ttl.buf);
+		serd_writer_finish(writer);
+		serd_reader_free(reader);
+		serd_writer_free(writer);
+		serd_env_free(env);
+		if (st) {
+			BENCH_ERRORF("failed to read generated document (%s)\n",
+			             serd_strerror(st));
+			return 1;
+		}
+	}
+
+	// Every statement is one line of NTriples
+	unsigned long n_statements = 0;
+	for (size_t i = 0; i < nt.len; ++i) {
+		n_statements += (nt.buf[i] == '\n');
+	}
+
+	FILE* out = out_path ? fopen(out_path, "w") : stdout;
+	if (!out) {
+		BENCH_ERRORF("failed to open %s\n", out_path);
+		return 1;
+	}
+
+	fprintf(out, "{\n  \"serd_version\": \"%s\",\n", SERD_VERSION);
+	fprintf(out, "  \"parameters\": {\"statements\": %lu, \"iri_length\": %u, "
+	        "\"literal_length\": %u, \"escape_percent\": %u,\n"
+	        "                 \"prefixes\": %u, \"depth\": %u, "
+	        "\"list_length\": %u, \"runs\": %u},\n",
+	        n_statements, params.iri_len, params.literal_len, params.escape_pct,
+	        params.n_prefixes, params.depth, params.list_len, params.repeat);
+	fprintf(out, "  \"results\": [");
+
+	const SerdSyntax syntaxes[] = { SERD_TURTLE, SERD_NTRIPLES };
+	bool             first      = true;
+	for (unsigned s = 0; s < 2; ++s) {
+		const SerdSyntax syntax = syntaxes[s];
+		const Text*      doc    = (syntax == SERD_TURTLE) ? &ttl : &nt;
+		FILE*            file   = tmpfile();
+		if (!file || fwrite(doc->buf, 1, doc->len, file) != doc->len) {
+			BENCH_ERRORF("failed to write temporary file%s\n", "");
+			return 1;
+		}
+
+		// Read to a null sink, and read through a writer, in each mode
+		for (unsigned w = 0; w < 2; ++w) {
+			for (unsigned m = MODE_PAGED; m <= MODE_STRING; ++m) {
+				double best = 0.0;
+				Counts counts;
+				for (unsigned r = 0; r < params.repeat; ++r) {
+					memset(&counts, 0, sizeof(counts));
+					const double t = bench_read(
+						doc, file, syntax, w ? syntax : (SerdSyntax)0,
+						(ReadMode)m, &counts);
+					best = (r == 0 || t < best) ? t : best;
+				}
+				print_result(out, first, w ? "round_trip" : "read", syntax,
+				             mode_names[m], doc->len,
+				             w ? n_statements : counts.n_statements, best);
+				first = false;
+			}
+		}
+		fclose(file);
+
+		// Write from memory to a null sink
+		Events events = { NULL, 0, 0 };
+		{
+			SerdReader* reader = serd_reader_new(
+				syntax, &events, NULL, NULL, NULL,
+				record_statement, record_end);
+			serd_reader_read_string(reader, (const uint8_t*)doc->buf);
+			serd_reader_free(reader);
+		}
+		double best = 0.0;
+		Counts counts;
+		for (unsigned r = 0; r < params.repeat; ++r) {
+			memset(&counts, 0, sizeof(counts));
+			const double t = bench_write(&events, syntax, &counts);
+			best = (r == 0 || t < best) ? t : best;
+		}
+		print_result(out, first, "write", syntax, "memory",
+		             counts.n_bytes, counts.n_statements, best);
+		events_free(&events);
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+	if (out_path) {
+		fclose(out);
+	}
+
+	free(ttl.buf);
+	free(nt.buf);
+	return 0;
+}
@@ -0,0 +1,613 @@
+/*
+  Copyright 2011-2015 David Robillard <http://drobilla.net>
+
+  Permission to use, copy, modify, and/or distribute this software for any
+  purpose with or without fee is hereby granted, provided that the above
+  copyright notice and this permission notice appear in all copies.
+
+  THIS SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/**
+   Micro-benchmarks for individual kernels.
+
+   Each kernel is run with an increasing number of operations until a run takes
+   at least the minimum time, then the best of several runs is reported as
+   nanoseconds and allocations per operation.  Allocations are counted with a
+   SerdAllocator, so they are only reported for kernels that take one.
+*/
+
+#define _POSIX_C_SOURCE 201112L /* for clock_gettime */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "serd/serd.h"
+#include "serd_config.h"
+
+#define BENCH_ERRORF(fmt, ...) \
+	fprintf(stderr, "serd_microbench: " fmt, __VA_ARGS__);
+
+#define N_SAMPLES 64
+
+/** State of a single benchmark run. */
+typedef struct {
+	size_t               n_ops;      ///< Number of operations to run
+	const SerdAllocator* allocator;  ///< Counting allocator for kernels
+	size_t               n_allocs;   ///< Total number of allocations so far
+	size_t               start_allocs;
+	double               start;
+	double               seconds;    ///< Time taken by the timed section
+	size_t               allocs;     ///< Allocations in the timed section
+	bool                 counted;    ///< True iff allocations were counted
+} Bench;
+
+typedef void (*KernelFunc)(Bench* bench, unsigned param);
+
+/** A benchmarked kernel, optionally run with several parameter values. */
+typedef struct {
+	const char* name;
+	KernelFunc  func;
+	unsigned    params[4];  ///< Zero-terminated, or empty for no parameter
+} Kernel;
+
+/** Written by kernels so the compiler can not discard their results. */
+static volatile size_t result_sink = 0;
+
+static double
+now(void)
+{
+#ifdef HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Counting allocator */
+
+static void*
+count_allocate(void* handle, size_t size)
+{
+	++((Bench*)handle)->n_allocs;
+	return malloc(size);
+}
+
+static void*
+count_reallocate(void* handle, void* ptr, size_t size)
+{
+	++((Bench*)handle)->n_allocs;
+	return realloc(ptr, size);
+}
+
+static void
+count_deallocate(void* handle, void* ptr)
+{
+	(void)handle;
+	free(ptr);
+}
+
+/* Timing */
+
+/** Start the timed section of a kernel, after any setup. */
+static void
+bench_start(Bench* bench, bool counted)
+{
+	bench->counted      = counted;
+	bench->start_allocs = bench->n_allocs;
+	bench->start        = now();
+}
+
+/** Stop the timed section of a kernel, before any cleanup. */
+static void
+bench_stop(Bench* bench)
+{
+	bench->seconds = now() - bench->start;
+	bench->allocs  = bench->n_allocs - bench->start_allocs;
+}
+
+static size_t
+count_sink(const void* buf, size_t len, void* stream)
+{
+	(void)buf;
+	*(size_t*)stream += len;
+	return len;
+}
+
+/* URI kernels */
+
+static const char* const uri_samples[] = {
+	"http://example.org/",
+	"http://example.org/a/b/c/d;p?q#frag",
+	"https://user@www.example.com:8080/path/to/some/resource.ttl",
+	"file:///home/user/data/dataset.ttl",
+	"http://www.w3.org/1999/02/22-rdf-syntax-ns#type",
+	"http://purl.org/dc/terms/title",
+	"urn:isbn:0451450523",
+	"http://example.org/search?query=value&limit=10&offset=20#results"
+};
+
+static const char* const ref_samples[] = {
+	"g", "./g", "g/", "/g", "//g", "?y", "g?y", "#s", "g#s", "g?y#s",
+	";x", "g;x", "", ".", "./", "..", "../", "../g", "../..", "../../g",
+	"../../../g", "/./g", "/../g", "g.", ".g", "g..", "..g", "./../g",
+	"./g/.", "g/./h", "g/../h", "g;x=1/./y", "g;x=1/../y"
+};
+
+#define N_URIS (sizeof(uri_samples) / sizeof(const char*))
+#define N_REFS (sizeof(ref_samples) / sizeof(const char*))
+
+static void
+bench_uri_parse(Bench* bench, unsigned param)
+{
+	(void)param;
+	size_t total = 0;
+	bench_start(bench, false);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdURI uri;
+		serd_uri_parse((const uint8_t*)uri_samples[i % N_URIS], &uri);
+		total += uri.path.len;
+	}
+	bench_stop(bench);
+	result_sink = total;
+}
+
+static void
+bench_uri_resolve(Bench* bench, unsigned param)
+{
+	(void)param;
+	SerdURI base;
+	SerdURI refs[N_REFS];
+	serd_uri_parse((const uint8_t*)"http://a/b/c/d;p?q", &base);
+	for (size_t i = 0; i < N_REFS; ++i) {
+		serd_uri_parse((const uint8_t*)ref_samples[i], &refs[i]);
+	}
+
+	size_t total = 0;
+	bench_start(bench, false);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdURI out;
+		serd_uri_resolve(&refs[i % N_REFS], &base, &out);
+		total += out.path.len + out.path_base.len;
+	}
+	bench_stop(bench);
+	result_sink = total;
+}
+
+static void
+bench_uri_serialise_relative(Bench* bench, unsigned param)
+{
+	(void)param;
+	static const char* const targets[] = {
+		"http://example.org/a/b/c/g",
+		"http://example.org/a/b/c/d/e/f",
+		"http://example.org/a/b/g",
+		"http://example.org/a/x/y/z",
+		"http://example.org/a/b/c/d;p?y",
+		"http://example.org/other",
+		"http://other.org/a/b/c",
+		"http://example.org/a/b/c/d;p?q#s"
+	};
+	static const size_t n_targets = sizeof(targets) / sizeof(const char*);
+
+	SerdURI base;
+	SerdURI root;
+	SerdURI uris[sizeof(targets) / sizeof(const char*)];
+	serd_uri_parse((const uint8_t*)"http://example.org/a/b/c/d;p?q", &base);
+	serd_uri_parse((const uint8_t*)"http://example.org/a/", &root);
+	for (size_t i = 0; i < n_targets; ++i) {
+		serd_uri_parse((const uint8_t*)targets[i], &uris[i]);
+	}
+
+	size_t total = 0;
+	bench_start(bench, false);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		serd_uri_serialise_relative(
+			&uris[i % n_targets], &base, &root, count_sink, &total);
+	}
+	bench_stop(bench);
+	result_sink = total;
+}
+
+/* Number kernels */
+
+static void
+bench_strtod(Bench* bench, unsigned param)
+{
+	(void)param;
+	static const char* const numbers[] = {
+		"0", "1", "-42", "3.14159", "2.718281828459045", "1.0e10",
+		"6.02214076E23", "-1.602176634e-19", "0.1", "123456.789",
+		"9007199254740993", "1.7976931348623157e308", "5e-324",
+		"0.30000000000000004", "100.25", "-0.000001"
+	};
+	static const size_t n_numbers = sizeof(numbers) / sizeof(const char*);
+
+	double total = 0.0;
+	bench_start(bench, false);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		total += serd_strtod(numbers[i % n_numbers], NULL);
+	}
+	bench_stop(bench);
+	result_sink = (size_t)(total != 0.0);
+}
+
+static void
+bench_node_new_decimal(Bench* bench, unsigned param)
+{
+	(void)param;
+	static const double values[] = {
+		0.0, 1.0, -42.0, 3.14159, 2.718281828459045, 1.0e10, 0.1,
+		123456.789, -0.000001, 100.25, 9.99999, 1234567890.125
+	};
+	static const size_t n_values = sizeof(values) / sizeof(double);
+
+	size_t total = 0;
+	bench_start(bench, true);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdNode node = serd_node_new_decimal_with_allocator(
+			bench->allocator, values[i % n_values], 8);
+		total += node.n_bytes;
+		serd_node_free_with_allocator(bench->allocator, &node);
+	}
+	bench_stop(bench);
+	result_sink = total;
+}
+
+/* Base64 kernels */
+
+#define BLOB_SIZE 1024
+
+static void
+bench_base64_decode(Bench* bench, unsigned param)
+{
+	(void)param;
+	uint8_t blob[BLOB_SIZE];
+	for (size_t i = 0; i < BLOB_SIZE; ++i) {
+		blob[i] = (uint8_t)((i * 7919) & 0xFF);
+	}
+	SerdNode node = serd_node_new_blob(blob, BLOB_SIZE, true);
+
+	size_t total = 0;
+	bench_start(bench, false);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		size_t size = 0;
+		void*  data = serd_base64_decode(node.buf, node.n_bytes, &size);
+		total += size;
+		free(data);
+	}
+	bench_stop(bench);
+	serd_node_free(&node);
+	result_sink = total;
+}
+
+static void
+bench_node_new_blob(Bench* bench, unsigned param)
+{
+	(void)param;
+	uint8_t blob[BLOB_SIZE];
+	for (size_t i = 0; i < BLOB_SIZE; ++i) {
+		blob[i] = (uint8_t)((i * 7919) & 0xFF);
+	}
+
+	size_t total = 0;
+	bench_start(bench, true);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdNode node = serd_node_new_blob_with_allocator(
+			bench->allocator, blob, BLOB_SIZE, (i & 1));
+		total += node.n_bytes;
+		serd_node_free_with_allocator(bench->allocator, &node);
+	}
+	bench_stop(bench);
+	result_sink = total;
+}
+
+/* Environment kernels */
+
+/** Return an environment with `n_prefixes` prefixes ns0: to nsN:. */
+static SerdEnv*
+new_prefixed_env(Bench* bench, unsigned n_prefixes)
+{
+	SerdEnv* env = serd_env_new_with_allocator(bench->allocator, NULL);
+	for (unsigned i = 0; i < n_prefixes; ++i) {
+		char name[32];
+		char uri[64];
+		snprintf(name, sizeof(name), "ns%u", i);
+		snprintf(uri, sizeof(uri), "http://example.org/ns%u/", i);
+		serd_env_set_prefix_from_strings(
+			env, (const uint8_t*)name, (const uint8_t*)uri);
+	}
+	return env;
+}
+
+static void
+bench_env_qualify(Bench* bench, unsigned param)
+{
+	SerdEnv* env = new_prefixed_env(bench, param);
+	char     strs[N_SAMPLES][64];
+	SerdNode nodes[N_SAMPLES];
+	for (unsigned i = 0; i < N_SAMPLES; ++i) {
+		snprintf(strs[i], sizeof(strs[i]), "http://example.org/ns%u/name%u",
+		         (i * 2654435761u) % param, i);
+		nodes[i] = serd_node_from_string(SERD_URI, (const uint8_t*)strs[i]);
+	}
+
+	size_t total = 0;
+	bench_start(bench, true);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdNode  prefix;
+		SerdChunk suffix;
+		if (serd_env_qualify(env, &nodes[i % N_SAMPLES], &prefix, &suffix)) {
+			total += suffix.len;
+		}
+	}
+	bench_stop(bench);
+	serd_env_free(env);
+	result_sink = total;
+}
+
+static void
+bench_env_expand(Bench* bench, unsigned param)
+{
+	SerdEnv* env = new_prefixed_env(bench, param);
+	char     strs[N_SAMPLES][64];
+	SerdNode nodes[N_SAMPLES];
+	for (unsigned i = 0; i < N_SAMPLES; ++i) {
+		snprintf(strs[i], sizeof(strs[i]), "ns%u:name%u",
+		         (i * 2654435761u) % param, i);
+		nodes[i] = serd_node_from_string(SERD_CURIE, (const uint8_t*)strs[i]);
+	}
+
+	size_t total = 0;
+	bench_start(bench, true);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		SerdChunk prefix;
+		SerdChunk suffix;
+		if (!serd_env_expand(env, &nodes[i % N_SAMPLES], &prefix, &suffix)) {
+			total += prefix.len + suffix.len;
+		}
+	}
+	bench_stop(bench);
+	serd_env_free(env);
+	result_sink = total;
+}
+
+/* Writer kernels */
+
+/** Write one statement per operation with the given objects. */
+static void
+bench_write_objects(Bench*          bench,
+                    SerdSyntax      syntax,
+                    SerdStyle       style,
+                    const SerdNode* objects,
+                    size_t          n_objects)
+{
+	SerdNode s = serd_node_from_string(
+		SERD_URI, (const uint8_t*)"http://example.org/subject");
+	SerdNode p = serd_node_from_string(
+		SERD_URI, (const uint8_t*)"http://example.org/predicate");
+
+	size_t      total  = 0;
+	SerdEnv*    env    = serd_env_new_with_allocator(bench->allocator, NULL);
+	SerdWriter* writer = serd_writer_new_with_allocator(
+		bench->allocator, syntax, style, env, NULL, count_sink, &total);
+
+	bench_start(bench, true);
+	for (size_t i = 0; i < bench->n_ops; ++i) {
+		serd_writer_write_statement(writer, 0, NULL, &s, &p,
+		                            &objects[i % n_objects], NULL, NULL);
+	}
+	serd_writer_finish(writer);
+	bench_stop(bench);
+
+	serd_writer_free(writer);
+	serd_env_free(env);
+	result_sink = total;
+}
+
+static void
+bench_write_text(Bench* bench, unsigned param)
+{
+	(void)param;
+	static const char* const texts[] = {
+		"A plain literal with no special characters at all",
+		"A \"quoted\" literal with a\ttab and a back\\slash",
+		"Line one\nLine two\nLine three\r\n",
+		"Non-ASCII: caf\xC3\xA9, na\xC3\xAFve, \xE2\x82\xAC" "5, \xF0\x9F\x98\x80",
+	};
+	static const size_t n_texts = sizeof(texts) / sizeof(const char*);
+
+	SerdNode objects[sizeof(texts) / sizeof(const char*)];
+	for (size_t i = 0; i < n_texts; ++i) {
+		objects[i] = serd_node_from_string(
+			SERD_LITERAL, (const uint8_t*)texts[i]);
+	}
+
+	bench_write_objects(bench, SERD_TURTLE, SERD_STYLE_ASCII,
+	                    objects, n_texts);
+}
+
+static void
+bench_write_uri(Bench* bench, unsigned param)
+{
+	(void)param;
+	static const char* const uris[] = {
+		"http://example.org/a/plain/path/to/a/resource",
+		"http://example.org/search?query=value&limit=10#results",
+		"http://example.org/caf\xC3\xA9/na\xC3\xAFve/\xE2\x82\xAC",
+		"http://example.org/a%20path/with%20percent%20escapes",
+	};
+	static const size_t n_uris = sizeof(uris) / sizeof(const char*);
+
+	SerdNode objects[sizeof(uris) / sizeof(const char*)];
+	for (size_t i = 0; i < n_uris; ++i) {
+		objects[i] = serd_node_from_string(SERD_URI, (const uint8_t*)uris[i]);
+	}
+
+	bench_write_objects(bench, SERD_NTRIPLES, SERD_STYLE_ASCII,
+	                    objects, n_uris);
+}
+
+static const Kernel kernels[] = {
+	{ "uri_parse",              bench_uri_parse,              { 0 } },
+	{ "uri_resolve",            bench_uri_resolve,            { 0 } },
+	{ "uri_serialise_relative", bench_uri_serialise_relative, { 0 } },
+	{ "strtod",                 bench_strtod,                 { 0 } },
+	{ "base64_decode",          bench_base64_decode,          { 0 } },
+	{ "node_new_blob",          bench_node_new_blob,          { 0 } },
+	{ "node_new_decimal",       bench_node_new_decimal,       { 0 } },
+	{ "env_qualify",            bench_env_qualify,     { 10, 100, 1000, 0 } },
+	{ "env_expand",             bench_env_expand,      { 10, 100, 1000, 0 } },
+	{ "write_text",             bench_write_text,             { 0 } },
+	{ "write_uri",              bench_write_uri,              { 0 } },
+	{ NULL,                     NULL,                         { 0 } }
+};
+
+/** Run `kernel` until it takes `min_seconds`, and report the best of runs. */
+static void
+run_kernel(const Kernel* kernel,
+           unsigned      param,
+           double        min_seconds,
+           unsigned      repeat)
+{
+	Bench         bench     = { 1, NULL, 0, 0, 0.0, 0.0, 0, false };
+	SerdAllocator allocator = {
+		&bench, count_allocate, count_reallocate, count_deallocate };
+	bench.allocator = &allocator;
+
+	// Find a number of operations that takes long enough to measure
+	for (kernel->func(&bench, param);
+	     bench.seconds < min_seconds && bench.n_ops < ((size_t)1 << 40);
+	     kernel->func(&bench, param)) {
+		const double scale = (bench.seconds > 0.0)
+			? 1.2 * min_seconds / bench.seconds
+			: 100.0;
+		bench.n_ops = (size_t)(bench.n_ops * (scale < 100.0 ? scale : 100.0));
+		bench.n_ops += 1;
+	}
+
+	double best   = bench.seconds;
+	size_t allocs = bench.allocs;
+	for (unsigned r = 1; r < repeat; ++r) {
+		kernel->func(&bench, param);
+		best   = (bench.seconds < best) ? bench.seconds : best;
+		allocs = (bench.allocs < allocs) ? bench.allocs : allocs;
+	}
+
+	char name[64];
+	if (param) {
+		snprintf(name, sizeof(name), "%s/%u", kernel->name, param);
+	} else {
+		snprintf(name, sizeof(name), "%s", kernel->name);
+	}
+
+	const double n_ops = (double)bench.n_ops;
+	if (bench.counted) {
+		printf("%-28s %12.1f %12.2f %12zu\n", name,
+		       best * 1.0e9 / n_ops, (double)allocs / n_ops, bench.n_ops);
+	} else {
+		printf("%-28s %12.1f %12s %12zu\n", name,
+		       best * 1.0e9 / n_ops, "-", bench.n_ops);
+	}
+	fflush(stdout);
+}
+
+static int
+print_usage(const char* name, bool error)
+{
+	FILE* const os = error ? stderr : stdout;
+	fprintf(os, "%s", error ? "\n" : "");
+	fprintf(os, "Usage: %s [OPTION]... [KERNEL]...\n", name);
+	fprintf(os, "Run micro-benchmarks for kernels whose names contain KERNEL.\n");
+	fprintf(os, "  -h           Display this help and exit.\n");
+	fprintf(os, "  -l           List kernels and exit.\n");
+	fprintf(os, "  -r COUNT     Number of runs to take the best of (default 3).\n");
+	fprintf(os, "  -t MSECS     Minimum time of each run (default 100).\n");
+	return error ? 1 : 0;
+}
+
+static bool
+parse_count(const char* str, unsigned long* count)
+{
+	char* end = NULL;
+	*count = strtoul(str, &end, 10);
+	return end && end != str && !*end;
+}
+
+static bool
+selected(const Kernel* kernel, int n_filters, char** filters)
+{
+	for (int i = 0; i < n_filters; ++i) {
+		if (strstr(kernel->name, filters[i])) {
+			return true;
+		}
+	}
+	return n_filters == 0;
+}
+
+int
+main(int argc, char** argv)
+{
+	unsigned long repeat = 3;
+	unsigned long msecs  = 100;
+	bool          list   = false;
+	int           a      = 1;
+	for (; a < argc && argv[a][0] == '-'; ++a) {
+		if (argv[a][1] == '\0' || argv[a][2] != '\0') {
+			BENCH_ERRORF("invalid argument `%s'\n", argv[a]);
+			return print_usage(argv[0], true);
+		} else if (argv[a][1] == 'h') {
+			return print_usage(argv[0], false);
+		} else if (argv[a][1] == 'l') {
+			list = true;
+			continue;
+		} else if (argv[a][1] != 'r' && argv[a][1] != 't') {
+			BENCH_ERRORF("invalid option `%s'\n", argv[a]);
+			return print_usage(argv[0], true);
+		} else if (++a == argc) {
+			BENCH_ERRORF("option `%s' requires an argument\n", argv[a - 1]);
+			return print_usage(argv[0], true);
+		}
+
+		unsigned long value = 0;
+		if (!parse_count(argv[a], &value)) {
+			BENCH_ERRORF("invalid number `%s'\n", argv[a]);
+			return print_usage(argv[0], true);
+		} else if (argv[a - 1][1] == 'r') {
+			repeat = value ? value : 1;
+		} else {
+			msecs = value;
+		}
+	}
+
+	if (!list) {
+		printf("%-28s %12s %12s %12s\n", "kernel", "ns/op", "allocs/op", "ops");
+	}
+
+	for (const Kernel* k = kernels; k->name; ++k) {
+		if (!selected(k, argc - a, argv + a)) {
+			continue;
+		} else if (list) {
+			printf("%s\n", k->name);
+		} else if (!k->params[0]) {
+			run_kernel(k, 0, msecs / 1000.0, (unsigned)repeat);
+		} else {
+			for (const unsigned* p = k->params; *p; ++p) {
+				run_kernel(k, *p, msecs / 1000.0, (unsigned)repeat);
+			}
+		}
+	}
+
+	return 0;
+}
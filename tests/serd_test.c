@@ -22,7 +22,13 @@
 #include <string.h>
 
 #include "serd/serd.h"
+#include "serd_config.h"
 
+#ifdef HAVE_ZLIB
+#    include <zlib.h>
+#endif
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #define USTR(s) ((const uint8_t*)(s))
 
 #ifndef INFINITY
@@ -87,6 +93,117 @@ test_sink(void*              handle,
 	return SERD_SUCCESS;
 }
 
+typedef struct {
+	char     buf[64];
+	size_t   len;
+	unsigned n_begins;
+	unsigned n_chunks;
+	unsigned n_ends;
+	unsigned n_streamed;
+} LiteralTest;
+
+static SerdStatus
+literal_begin_sink(void* handle)
+{
+	++((LiteralTest*)handle)->n_begins;
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+literal_chunk_sink(void* handle, const SerdChunk* chunk)
+{
+	LiteralTest* lt = (LiteralTest*)handle;
+	if (lt->len + chunk->len < sizeof(lt->buf)) {
+		memcpy(lt->buf + lt->len, chunk->buf, chunk->len);
+		lt->len += chunk->len;
+	}
+	++lt->n_chunks;
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+literal_end_sink(void* handle)
+{
+	++((LiteralTest*)handle)->n_ends;
+	return SERD_SUCCESS;
+}
+
+static SerdStatus
+literal_statement_sink(void*              handle,
+                       SerdStatementFlags flags,
+                       const SerdNode*    graph,
+                       const SerdNode*    subject,
+                       const SerdNode*    predicate,
+                       const SerdNode*    object,
+                       const SerdNode*    object_datatype,
+                       const SerdNode*    object_lang)
+{
+	if ((object->flags & SERD_IS_STREAMED) && !object->n_bytes) {
+		++((LiteralTest*)handle)->n_streamed;
+	}
+	return SERD_SUCCESS;
+}
+
+typedef struct {
+	size_t n_allocs;
+	size_t n_live;
+} AllocTest;
+
+static void*
+test_allocate(void* handle, size_t size)
+{
+	AllocTest* at = (AllocTest*)handle;
+	++at->n_allocs;
+	++at->n_live;
+	return malloc(size);
+}
+
+static void*
+test_reallocate(void* handle, void* ptr, size_t size)
+{
+	AllocTest* at = (AllocTest*)handle;
+	if (!ptr) {
+		++at->n_allocs;
+		++at->n_live;
+	}
+	return realloc(ptr, size);
+}
+
+static void
+test_deallocate(void* handle, void* ptr)
+{
+	if (ptr) {
+		--((AllocTest*)handle)->n_live;
+	}
+	free(ptr);
+}
+
+#ifdef HAVE_ZLIB
+/** Decompress a sequence of gzip members. */
+static uint8_t*
+gunzip(const uint8_t* buf, size_t len, size_t out_size)
+{
+	uint8_t* out = (uint8_t*)calloc(1, out_size + 1);
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	inflateInit2(&zs, 15 + 32);
+	zs.next_in   = (Bytef*)buf;
+	zs.avail_in  = (uInt)len;
+	zs.next_out  = out;
+	zs.avail_out = (uInt)out_size;
+	while (zs.avail_in) {
+		const int ret = inflate(&zs, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END) {
+			inflateReset(&zs);
+		} else if (ret != Z_OK) {
+			break;
+		}
+	}
+	inflateEnd(&zs);
+	return out;
+}
+#endif
+
 int
 main(void)
 {
@@ -118,6 +235,36 @@ main(void)
 		}
 	}
 
+	// Test that hard cases are correctly rounded
+	const char* exact_test_strs[] = {
+		"9007199254740993",
+		"2.2250738585072011e-308",
+		"0.1000000000000000055511151231257827021181583404541015625",
+		"0.1000000000000000055511151231257827021181583404541015626",
+		"1.7976931348623158e308",
+		"2.4703282292062328e-324",
+		"123456789012345678901234567890e-10",
+		"1e23",
+		"1e-400"
+	};
+
+	for (unsigned i = 0; i < sizeof(exact_test_strs) / sizeof(char*); ++i) {
+		const double num = serd_strtod(exact_test_strs[i], NULL);
+		const double ref = strtod(exact_test_strs[i], NULL);
+		if (num != ref) {
+			return failure("Parsed `%s' %.17g != %.17g\n",
+			               exact_test_strs[i], num, ref);
+		}
+	}
+
+	// Test serd_strntod on a string that is not null terminated
+	char*       end      = NULL;
+	const char* expt_buf = "12.5e2xyz";
+	if (serd_strntod(expt_buf, 4, &end) != 12.5 || end != expt_buf + 4 ||
+	    serd_strntod(expt_buf, 6, &end) != 1250.0 || end != expt_buf + 6) {
+		return failure("Bad length-bounded strtod\n");
+	}
+
 	// Test serd_node_new_decimal
 
 	const double dbl_test_nums[] = {
@@ -169,6 +316,55 @@ main(void)
 		serd_node_free(&node);
 	}
 
+	// Test serd_format_integer at the limits of int64_t
+	uint8_t ibuf[SERD_INTEGER_BUF_SIZE];
+	if (serd_format_integer(INT64_MIN, ibuf) != 20 ||
+	    strcmp((const char*)ibuf, "-9223372036854775808")) {
+		return failure("Bad INT64_MIN `%s'\n", ibuf);
+	} else if (serd_format_integer(INT64_MAX, ibuf) != 19 ||
+	           strcmp((const char*)ibuf, "9223372036854775807")) {
+		return failure("Bad INT64_MAX `%s'\n", ibuf);
+	}
+
+	// Test serd_node_new_double
+
+	const double dbl_rt_nums[] = {
+		0.0, -0.0, 1.0, -2.5, 0.1, 1234.5678, 5e-324, DBL_MAX, NAN, -INFINITY,
+		1e23, 3.4855101425421902e-242, 9007199254740993.0,
+		8.98846567431158e307, 2.2250738585072014e-308
+	};
+
+	const char* dbl_rt_strs[] = {
+		"0.0E0", "-0.0E0", "1.0E0", "-2.5E0", "1.0E-1", "1.2345678E3",
+		"5.0E-324", "1.7976931348623157E308", "NaN", "-INF",
+		"1.0E23", "3.48551014254219E-242", "9.007199254740992E15",
+		"8.98846567431158E307", "2.2250738585072014E-308"
+	};
+
+	for (unsigned i = 0; i < sizeof(dbl_rt_nums) / sizeof(double); ++i) {
+		SerdNode node = serd_node_new_double(dbl_rt_nums[i]);
+		if (strcmp((const char*)node.buf, dbl_rt_strs[i])) {
+			return failure("Serialised `%s' != %s\n",
+			               node.buf, dbl_rt_strs[i]);
+		}
+		const size_t len = strlen((const char*)node.buf);
+		if (node.n_bytes != len || node.n_chars != len) {
+			return failure("Length %zu,%zu != %zu\n",
+			               node.n_bytes, node.n_chars, len);
+		}
+		serd_node_free(&node);
+	}
+
+	// Test that random doubles read back exactly
+	uint8_t dbuf[SERD_DOUBLE_BUF_SIZE];
+	for (unsigned i = 0; i < 100000; ++i) {
+		const double d = ldexp((double)rand() / RAND_MAX, rand() % 2000 - 1000);
+		serd_format_double(d, dbuf);
+		if (strtod((const char*)dbuf, NULL) != d) {
+			return failure("`%s' does not read back as %.17g\n", dbuf, d);
+		}
+	}
+
 	// Test serd_node_new_blob
 	for (size_t size = 0; size < 256; ++size) {
 		uint8_t* data = (uint8_t*)malloc(size);
@@ -178,7 +374,8 @@ main(void)
 
 		SerdNode blob = serd_node_new_blob(data, size, size % 5);
 
-		if (blob.n_bytes != blob.n_chars) {
+		if (blob.n_bytes != blob.n_chars ||
+		    blob.n_bytes != strlen((const char*)blob.buf)) {
 			return failure("Blob %zu bytes != %zu chars\n",
 			               blob.n_bytes, blob.n_chars);
 		}
@@ -196,6 +393,36 @@ main(void)
 			}
 		}
 
+		// Encode and decode again in chunks of varying size
+		const size_t       step = size % 7 + 1;
+		SerdChunk          text = { NULL, 0 };
+		SerdBase64Encoder* enc  = serd_base64_encoder_new(
+			size % 5, serd_chunk_sink, &text);
+		for (size_t i = 0; i < size; i += step) {
+			serd_base64_encoder_write(enc, data + i, MIN(step, size - i));
+		}
+		serd_base64_encoder_finish(enc);
+		serd_base64_encoder_free(enc);
+		uint8_t* text_str = serd_chunk_sink_finish(&text);
+		if (strcmp((const char*)text_str, (const char*)blob.buf)) {
+			return failure("Streamed encoding `%s' != `%s'\n",
+			               text_str, blob.buf);
+		}
+
+		SerdChunk          bin = { NULL, 0 };
+		SerdBase64Decoder* dec = serd_base64_decoder_new(serd_chunk_sink, &bin);
+		for (size_t i = 0; i < blob.n_bytes; i += step) {
+			serd_base64_decoder_write(
+				dec, blob.buf + i, MIN(step, blob.n_bytes - i));
+		}
+		serd_base64_decoder_finish(dec);
+		serd_base64_decoder_free(dec);
+		if (bin.len != size || (size && memcmp(bin.buf, data, size))) {
+			return failure("Corrupt streamed blob of size %zu\n", size);
+		}
+		free(text_str);
+		free((uint8_t*)bin.buf);
+
 		serd_node_free(&blob);
 		free(out);
 		free(data);
@@ -269,6 +496,52 @@ main(void)
 		return failure("Bad path %s for %s\n", serd_uri_to_path(uri), uri);
 	}
 
+	// Test serd_uri_parse_chunk on a URI inside a larger string
+	const uint8_t* chunk_str = USTR("<http://ex.org/a/b?q=1#f> <x:y>");
+	SerdURI        curi;
+	serd_uri_parse_chunk(chunk_str + 1, 23, &curi);
+	if (curi.scheme.len != 4 || curi.authority.len != 6 ||
+	    curi.path.len != 4 || strncmp((const char*)curi.path.buf, "/a/b", 4) ||
+	    curi.query.len != 3 || curi.fragment.len != 2) {
+		return failure("Bad parse of URI chunk\n");
+	}
+	serd_uri_parse_chunk(chunk_str + 27, 3, &curi);
+	if (curi.scheme.len != 1 || curi.path.len != 1 || curi.path.buf[0] != 'y') {
+		return failure("Bad parse of URI chunk without authority\n");
+	}
+
+	// Test serd_uri_resolve_string into a caller buffer
+	SerdURI res_base;
+	serd_uri_parse(USTR("http://a/b/c/d;p?q"), &res_base);
+	const char* const resolved[][2] = {
+		{ "g",        "http://a/b/c/g" },
+		{ "../g",     "http://a/b/g" },
+		{ "./g?y#s",  "http://a/b/c/g?y#s" },
+		{ "#s",       "http://a/b/c/d;p?q#s" },
+		{ "",         "http://a/b/c/d;p?q" },
+		{ "//g/x",    "http://g/x" },
+		{ "x:y",      "x:y" }
+	};
+	for (size_t i = 0; i < sizeof(resolved) / sizeof(resolved[0]); ++i) {
+		const char*  ref = resolved[i][0];
+		uint8_t      rbuf[32];
+		const size_t rlen = serd_uri_resolve_string(
+			USTR(ref), strlen(ref), &res_base, rbuf, sizeof(rbuf));
+		SerdNode rnode = serd_node_new_uri_from_string(USTR(ref), &res_base, NULL);
+		if (rlen != strlen(resolved[i][1]) ||
+		    strcmp((const char*)rbuf, resolved[i][1]) ||
+		    strcmp((const char*)rnode.buf, resolved[i][1])) {
+			return failure("Resolved <%s> to <%s>, not <%s>\n",
+			               ref, rbuf, resolved[i][1]);
+		}
+		serd_node_free(&rnode);
+	}
+	uint8_t small[8] = { 0 };
+	if (serd_uri_resolve_string(USTR("g"), 1, &res_base, small, 8) != 14 ||
+	    small[0]) {
+		return failure("Resolved URI overflowed buffer\n");
+	}
+
 	// Test serd_node_new_file_uri and serd_file_uri_parse
 	SerdURI        furi;
 	const uint8_t* path_str  = USTR("C:/My 100%");
@@ -489,6 +762,48 @@ main(void)
 		return failure("Qualified %s\n", shorter_uri.buf);
 	}
 
+	// Test qualifying with many overlapping prefixes
+
+	SerdEnv* big_env = serd_env_new(NULL);
+	serd_env_set_prefix_from_strings(
+		big_env, USTR("eg"), USTR("http://example.org/"));
+	for (unsigned i = 0; i < 100; ++i) {
+		char name[8];
+		char ns[32];
+		snprintf(name, sizeof(name), "p%u", i);
+		snprintf(ns, sizeof(ns), "http://example.org/ns%u/", i);
+		serd_env_set_prefix_from_strings(big_env, USTR(name), USTR(ns));
+	}
+
+	SerdNode ns_uri = serd_node_from_string(
+		SERD_URI, USTR("http://example.org/ns42/x"));
+	if (!serd_env_qualify(big_env, &ns_uri, &prefix_name, &suffix) ||
+	    strcmp((const char*)prefix_name.buf, "p42") ||
+	    suffix.len != 1 || suffix.buf[0] != 'x') {
+		return failure("Failed to qualify %s\n", ns_uri.buf);
+	}
+
+	SerdNode eg_uri = serd_node_from_string(
+		SERD_URI, USTR("http://example.org/ns42"));
+	if (!serd_env_qualify(big_env, &eg_uri, &prefix_name, &suffix) ||
+	    strcmp((const char*)prefix_name.buf, "eg")) {
+		return failure("Failed to qualify %s\n", eg_uri.buf);
+	}
+
+	serd_env_set_prefix_from_strings(
+		big_env, USTR("p42"), USTR("http://example.org/other/"));
+	if (serd_env_qualify(big_env, &ns_uri, &prefix_name, &suffix)) {
+		return failure("Qualified %s with rebound prefix\n", ns_uri.buf);
+	}
+
+	SerdNode p99 = serd_node_from_string(SERD_CURIE, USTR("p99:y"));
+	SerdNode x99 = serd_env_expand_node(big_env, &p99);
+	if (!x99.buf || strcmp((const char*)x99.buf, "http://example.org/ns99/y")) {
+		return failure("Expanded %s to %s\n", p99.buf, x99.buf);
+	}
+	serd_node_free(&x99);
+	serd_env_free(big_env);
+
 	// Test SerdReader and SerdWriter
 
 	const char* path = "serd_test.ttl";
@@ -599,6 +914,75 @@ main(void)
 
 	free(out);
 
+	// Test writer buffering
+	chunk.buf = NULL;
+	chunk.len = 0;
+	writer    = serd_writer_new(
+		SERD_TURTLE, (SerdStyle)0, env, NULL, serd_chunk_sink, &chunk);
+	serd_writer_set_buffer(writer, 16, SERD_FLUSH_FULL);
+	serd_writer_set_base_uri(writer, &o);
+	if (chunk.len != 32) {
+		return failure("Wrote %zu bytes, not 2 full blocks\n", chunk.len);
+	}
+	serd_writer_flush(writer);
+	serd_writer_free(writer);
+	out = serd_chunk_sink_finish(&chunk);
+	if (strcmp((const char*)out, "@base <http://example.org/base> .\n")) {
+		return failure("Incorrect buffered output:\n%s\n", out);
+	}
+
+	free(out);
+
+	// Test relative URI output
+	chunk.buf = NULL;
+	chunk.len = 0;
+	writer    = serd_writer_new(
+		SERD_TURTLE, SERD_STYLE_RESOLVED, env, NULL, serd_chunk_sink, &chunk);
+	SerdNode rbase = serd_node_from_string(SERD_URI,
+	                                       USTR("http://example.org/a/b"));
+	serd_writer_set_base_uri(writer, &rbase);
+	SerdNode rs = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org/a/c/d"));
+	SerdNode rp = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org/a/b#p"));
+	SerdNode ro = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org/e"));
+	serd_writer_write_statement(writer, 0, NULL, &rs, &rp, &ro, NULL, NULL);
+	serd_writer_free(writer);
+	out = serd_chunk_sink_finish(&chunk);
+	if (strcmp((const char*)out,
+	           "@base <http://example.org/a/b> .\n\n"
+	           "<c/d>\n\t<#p> </e> .\n")) {
+		return failure("Incorrect relative output:\n%s\n", out);
+	}
+
+	free(out);
+
+	// Test relative URI output that would otherwise resolve differently
+	chunk.buf = NULL;
+	chunk.len = 0;
+	writer    = serd_writer_new(
+		SERD_TURTLE, SERD_STYLE_RESOLVED, env, NULL, serd_chunk_sink, &chunk);
+	SerdNode ebase = serd_node_from_string(SERD_URI,
+	                                       USTR("http://example.org//b"));
+	serd_writer_set_base_uri(writer, &ebase);
+	SerdNode es = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org///c"));
+	SerdNode ep = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org//x:p"));
+	SerdNode eo = serd_node_from_string(SERD_URI,
+	                                    USTR("http://example.org//"));
+	serd_writer_write_statement(writer, 0, NULL, &es, &ep, &eo, NULL, NULL);
+	serd_writer_free(writer);
+	out = serd_chunk_sink_finish(&chunk);
+	if (strcmp((const char*)out,
+	           "@base <http://example.org//b> .\n\n"
+	           "<.//c>\n\t<./x:p> <./> .\n")) {
+		return failure("Incorrect relative output:\n%s\n", out);
+	}
+
+	free(out);
+
 	// Rewind and test reader
 	fseek(fd, 0, SEEK_SET);
 
@@ -620,6 +1004,7 @@ main(void)
 	serd_reader_set_default_graph(reader, &g);
 	serd_reader_add_blank_prefix(reader, USTR("tmp"));
 	serd_reader_add_blank_prefix(reader, NULL);
+	serd_reader_set_timing(reader, true);
 
 	if (!serd_reader_read_file(reader, USTR("http://notafile"))) {
 		return failure("Apparently read an http URI\n");
@@ -642,6 +1027,19 @@ main(void)
 		return failure("Bad graph %p\n", rt->graph);
 	}
 
+	// Statistics are all zero if compiled out with SERD_NO_STATS
+	const SerdReaderStats stats = serd_reader_get_stats(reader);
+	if (stats.n_statements && stats.n_statements != 12) {
+		return failure("Bad statistics statement count %zu\n",
+		               stats.n_statements);
+	} else if (stats.n_statements &&
+	           (!stats.n_bytes || !stats.n_pages ||
+	            stats.n_nodes < stats.n_statements ||
+	            !stats.stack_peak ||
+	            stats.sink_time < 0.0 || stats.parse_time < 0.0)) {
+		return failure("Bad statistics\n");
+	}
+
 	if (!serd_reader_read_string(reader, USTR("This isn't Turtle at all."))) {
 		return failure("Parsed invalid string successfully.\n");
 	}
@@ -649,6 +1047,429 @@ main(void)
 	serd_reader_free(reader);
 	fclose(fd);
 
+	// Test literal streaming
+
+	LiteralTest lt;
+	memset(&lt, 0, sizeof(lt));
+	reader = serd_reader_new(
+		SERD_TURTLE, &lt, NULL, NULL, NULL, literal_statement_sink, NULL);
+	serd_reader_set_literal_sink(
+		reader, 8, literal_begin_sink, literal_chunk_sink, literal_end_sink);
+	st = serd_reader_read_string(
+		reader,
+		USTR("<http://example.org/s> <http://example.org/p> "
+		     "\"short\" , \"\"\"a long \\\"literal\\\" that is "
+		     "streamed\"\"\"@en ."));
+	if (st) {
+		return failure("Error reading streamed literal (%s)\n",
+		               serd_strerror(st));
+	} else if (lt.n_begins != 1 || lt.n_ends != 1 || lt.n_streamed != 1 ||
+	           lt.n_chunks != 5) {
+		return failure("Bad literal streaming %u begins %u chunks %u ends\n",
+		               lt.n_begins, lt.n_chunks, lt.n_ends);
+	} else if (lt.len != 33 ||
+	           strncmp(lt.buf, "a long \"literal\" that is streamed", 33)) {
+		return failure("Bad streamed literal `%s'\n", lt.buf);
+	}
+	serd_reader_free(reader);
+
+	// Test SerdIndex
+
+	const char* doc_path = "serd_test_index.ttl";
+	FILE*       doc_fd   = fopen(doc_path, "w+");
+	if (!doc_fd) {
+		return failure("Failed to open file %s\n", doc_path);
+	}
+	fprintf(doc_fd,
+	        "@prefix eg: <http://example.org/> .\n"
+	        "eg:s eg:p eg:o1 .\n"
+	        "@prefix ex: <http://example.net/> .\n"
+	        "eg:s eg:p eg:o2 , eg:o3 .\n"
+	        "ex:s ex:p ex:o .\n");
+	fseek(doc_fd, 0, SEEK_SET);
+
+	SerdIndex* index = serd_index_new(2);
+	if ((st = serd_index_build(index, SERD_TURTLE, doc_fd, USTR(doc_path)))) {
+		return failure("Failed to build index (%s)\n", serd_strerror(st));
+	} else if (serd_index_get_size(index) != 3) {
+		return failure("Bad index size %zu\n", serd_index_get_size(index));
+	} else if (serd_index_get_offset(index, 0) != 0 ||
+	           serd_index_get_offset(index, 1) != 53) {
+		return failure("Bad index offset %zu\n", serd_index_get_offset(index, 1));
+	}
+
+	const char* index_path = "serd_test_index.idx";
+	FILE*       index_fd   = fopen(index_path, "w+");
+	if (!index_fd) {
+		return failure("Failed to open file %s\n", index_path);
+	} else if (serd_index_write(index, index_fd)) {
+		return failure("Failed to write index\n");
+	}
+	serd_index_free(index);
+	fseek(index_fd, 0, SEEK_SET);
+	if (!(index = serd_index_read(index_fd))) {
+		return failure("Failed to read index\n");
+	} else if (serd_index_get_size(index) != 3) {
+		return failure("Bad read index size %zu\n", serd_index_get_size(index));
+	}
+	fclose(index_fd);
+
+	n_prefixes = 0;
+	if (serd_index_seek(index, 1, doc_fd, NULL, count_prefixes, &n_prefixes)) {
+		return failure("Failed to seek to checkpoint 1\n");
+	} else if (!serd_index_seek(index, 3, doc_fd, NULL, NULL, NULL)) {
+		return failure("Seeked to non-existent checkpoint 3\n");
+	}
+	serd_index_free(index);
+
+	ReaderTest* it   = (ReaderTest*)malloc(sizeof(ReaderTest));
+	it->n_statements = 0;
+	it->graph        = NULL;
+	reader = serd_reader_new(SERD_TURTLE, it, free, NULL, NULL, test_sink, NULL);
+	if ((st = serd_reader_read_file_handle(reader, doc_fd, USTR(doc_path)))) {
+		return failure("Failed to read from checkpoint (%s)\n",
+		               serd_strerror(st));
+	} else if (n_prefixes != 1 || it->n_statements != 3) {
+		return failure("Bad prefix count %d or statement count %d\n",
+		               n_prefixes, it->n_statements);
+	}
+	serd_reader_free(reader);
+	fclose(doc_fd);
+
+	// Test sorter with a budget small enough to use several runs
+	SerdEnv*  senv = serd_env_new(NULL);
+	SerdChunk sout = { NULL, 0 };
+	SerdNode  sa   = serd_node_from_string(SERD_URI, USTR("http://ex.org/a"));
+	SerdNode  sb   = serd_node_from_string(SERD_URI, USTR("http://ex.org/b"));
+	SerdNode  sp   = serd_node_from_string(SERD_URI, USTR("http://ex.org/p"));
+	SerdNode  ss[] = { sb, sa, sb };
+	writer = serd_writer_new(
+		SERD_NTRIPLES, (SerdStyle)0, senv, NULL, serd_chunk_sink, &sout);
+	SerdSorter* sorter = serd_sorter_new(
+		senv, 256, (SerdStatementSink)serd_writer_write_statement, writer);
+	for (unsigned i = 0; i < 3; ++i) {
+		char str[2] = { (char)('1' + i), '\0' };
+		SerdNode so = serd_node_from_string(SERD_LITERAL, USTR(str));
+		if (serd_sorter_add_statement(
+			    sorter, 0, NULL, &ss[i], &sp, &so, NULL, NULL)) {
+			return failure("Failed to add statement to sorter\n");
+		}
+	}
+	if (serd_sorter_finish(sorter)) {
+		return failure("Failed to finish sorting\n");
+	}
+	serd_sorter_free(sorter);
+	serd_writer_free(writer);
+	serd_env_free(senv);
+
+	uint8_t* sorted = serd_chunk_sink_finish(&sout);
+	if (strcmp((const char*)sorted,
+	           "<http://ex.org/a> <http://ex.org/p> \"2\" .\n"
+	           "<http://ex.org/b> <http://ex.org/p> \"1\" .\n"
+	           "<http://ex.org/b> <http://ex.org/p> \"3\" .\n")) {
+		return failure("Bad sorted output:\n%s\n", sorted);
+	}
+	free(sorted);
+
+	// Test partitioner keeps blank closures with the statement using them
+	SerdEnv* penv  = serd_env_new(NULL);
+	SerdNode pname = serd_node_from_string(SERD_LITERAL, USTR("eg"));
+	SerdNode pns   = serd_node_from_string(SERD_URI, USTR("http://ex.org/"));
+	serd_env_set_prefix(penv, &pname, &pns);
+	serd_env_set_base_uri(penv, &pns);
+
+	ReaderTest  parts[3]   = { { 0, NULL }, { 0, NULL }, { 0, NULL } };
+	void* const handles[3] = { &parts[0], &parts[1], &parts[2] };
+	SerdPartitioner* part  = serd_partitioner_new(
+		penv, 3, test_sink, NULL, handles);
+
+	SerdNode pcurie = serd_node_from_string(SERD_CURIE, USTR("eg:s"));
+	SerdNode puri   = serd_node_from_string(SERD_URI, USTR("http://ex.org/s"));
+	SerdNode prel   = serd_node_from_string(SERD_URI, USTR("s"));
+	SerdNode pb1    = serd_node_from_string(SERD_BLANK, USTR("b1"));
+	SerdNode pb2    = serd_node_from_string(SERD_BLANK, USTR("b2"));
+	SerdNode plit   = serd_node_from_string(SERD_LITERAL, USTR("o"));
+	const unsigned pindex = serd_partitioner_get_index(part, &puri);
+	if (pindex >= 3 ||
+	    serd_partitioner_get_index(part, &pcurie) != pindex ||
+	    serd_partitioner_get_index(part, &prel) != pindex) {
+		return failure("Equal subjects mapped to different partitions\n");
+	}
+
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pcurie, &pname, &pb1, NULL, NULL);
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pb1, &pname, &pb2, NULL, NULL);
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pb2, &pname, &plit, NULL, NULL);
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pb1, &pname, &plit, NULL, NULL);
+	if (parts[pindex].n_statements != 4) {
+		return failure("Closure split across partitions\n");
+	}
+
+	for (unsigned i = 0; i < 64; ++i) {
+		char subj[32];
+		snprintf(subj, sizeof(subj), "http://ex.org/s%u", i);
+		SerdNode ps = serd_node_from_string(SERD_URI, USTR(subj));
+		serd_partitioner_write_statement(
+			part, 0, NULL, &ps, &pname, &plit, NULL, NULL);
+	}
+	if (parts[0].n_statements + parts[1].n_statements +
+	    parts[2].n_statements != 68 ||
+	    !parts[0].n_statements || !parts[1].n_statements ||
+	    !parts[2].n_statements) {
+		return failure("Bad partition sizes %d %d %d\n",
+		               parts[0].n_statements, parts[1].n_statements,
+		               parts[2].n_statements);
+	}
+
+	// Test blank nodes described later go with the statement using them
+	SerdNode pb3 = serd_node_from_string(SERD_BLANK, USTR("b3"));
+	serd_partitioner_write_statement(
+		part, 0, NULL, &puri, &pname, &pb3, NULL, NULL);
+	for (unsigned i = 0; i < 64; ++i) {
+		char subj[32];
+		snprintf(subj, sizeof(subj), "http://ex.org/t%u", i);
+		SerdNode ps = serd_node_from_string(SERD_URI, USTR(subj));
+		serd_partitioner_write_statement(
+			part, 0, NULL, &ps, &pname, &plit, NULL, NULL);
+	}
+	const int n_pindex = parts[pindex].n_statements;
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pb3, &pname, &plit, NULL, NULL);
+	serd_partitioner_write_statement(
+		part, 0, NULL, &pb2, &pname, &plit, NULL, NULL);
+	if (parts[pindex].n_statements != n_pindex + 2) {
+		return failure("Later blank node description in another partition\n");
+	}
+	serd_partitioner_free(part);
+	serd_env_free(penv);
+
+	// Test filter with exact and prefix patterns for several fields
+	SerdEnv* fenv = serd_env_new(&pns);
+	serd_env_set_prefix(fenv, &pname, &pns);
+
+	ReaderTest  ft     = { 0, NULL };
+	SerdFilter* filter = serd_filter_new(fenv, test_sink, &ft);
+	if (serd_filter_add_exact(filter, (SerdFilterField)6, USTR("x")) !=
+	    SERD_ERR_BAD_ARG) {
+		return failure("Added pattern for invalid field\n");
+	}
+	serd_filter_add_prefix(
+		filter, SERD_FILTER_SUBJECT, USTR("http://ex.org/s"));
+	serd_filter_add_exact(
+		filter, SERD_FILTER_PREDICATE, USTR("http://ex.org/p"));
+	serd_filter_add_exact(
+		filter, SERD_FILTER_PREDICATE, USTR("http://ex.org/q"));
+	serd_filter_add_exact(filter, SERD_FILTER_LANG, USTR("EN"));
+
+	SerdNode fp   = serd_node_from_string(SERD_CURIE, USTR("eg:p"));
+	SerdNode fq   = serd_node_from_string(SERD_URI, USTR("q"));
+	SerdNode fr   = serd_node_from_string(SERD_URI, USTR("http://ex.org/r"));
+	SerdNode fen  = serd_node_from_string(SERD_LITERAL, USTR("en"));
+	SerdNode fde  = serd_node_from_string(SERD_LITERAL, USTR("de"));
+	SerdNode fs2  = serd_node_from_string(SERD_URI, USTR("http://ex.org/s2"));
+	SerdNode fo2  = serd_node_from_string(SERD_URI, USTR("http://ex.org/o"));
+	SerdNode fdt  = serd_node_from_string(
+		SERD_URI, USTR("http://www.w3.org/2001/XMLSchema#string"));
+	if (!serd_filter_matches(filter, NULL, &pcurie, &fp, &plit, NULL, &fen) ||
+	    !serd_filter_matches(filter, NULL, &prel, &fq, &plit, NULL, &fen) ||
+	    !serd_filter_matches(filter, NULL, &fs2, &fq, &plit, NULL, &fen) ||
+	    serd_filter_matches(filter, NULL, &puri, &fr, &plit, NULL, &fen) ||
+	    serd_filter_matches(filter, NULL, &puri, &fp, &plit, NULL, &fde) ||
+	    serd_filter_matches(filter, NULL, &puri, &fp, &plit, NULL, NULL) ||
+	    serd_filter_matches(filter, NULL, &pb1, &fp, &plit, NULL, &fen) ||
+	    serd_filter_matches(filter, NULL, &fp, &fp, &plit, NULL, &fen)) {
+		return failure("Bad filter match\n");
+	}
+
+	serd_filter_add_exact(filter, SERD_FILTER_OBJECT, USTR("http://ex.org/o"));
+	serd_filter_add_prefix(filter, SERD_FILTER_DATATYPE, USTR("http://"));
+	if (serd_filter_matches(filter, NULL, &puri, &fp, &fo2, NULL, &fen) ||
+	    serd_filter_matches(filter, NULL, &puri, &fp, &plit, NULL, &fen)) {
+		return failure("Bad filter match for literal or URI object\n");
+	}
+	serd_filter_free(filter);
+
+	filter = serd_filter_new(fenv, test_sink, &ft);
+	serd_filter_add_exact(filter, SERD_FILTER_DATATYPE, fdt.buf);
+	serd_filter_add_exact(filter, SERD_FILTER_GRAPH, USTR("http://ex.org/g"));
+	SerdNode fg = serd_node_from_string(SERD_CURIE, USTR("eg:g"));
+	serd_filter_write_statement(
+		filter, SERD_ANON_O_BEGIN, &fg, &puri, &fp, &plit, NULL, NULL);
+	serd_filter_write_statement(
+		filter, 0, &fg, &puri, &fp, &plit, &fdt, NULL);
+	serd_filter_write_statement(
+		filter, 0, &fg, &puri, &fp, &plit, NULL, &fen);
+	serd_filter_write_statement(
+		filter, 0, NULL, &puri, &fp, &plit, NULL, NULL);
+	serd_filter_write_statement(
+		filter, 0, &fg, &puri, &fp, &fo2, NULL, NULL);
+	if (ft.n_statements != 2 || ft.graph != &fg) {
+		return failure("Filter passed %d statements\n", ft.n_statements);
+	}
+	serd_filter_free(filter);
+	serd_env_free(fenv);
+
+	// Test batch writer output is the same as that of a single writer
+	SerdEnv*  benv   = serd_env_new(NULL);
+	SerdNode  bname  = serd_node_from_string(SERD_LITERAL, USTR("eg"));
+	SerdNode  bns    = serd_node_from_string(SERD_URI,
+	                                         USTR("http://example.org/"));
+	SerdChunk single = { NULL, 0 };
+	SerdChunk multi  = { NULL, 0 };
+	writer = serd_writer_new(
+		SERD_TURTLE, SERD_STYLE_CURIED, benv, NULL, serd_chunk_sink, &single);
+	serd_writer_set_prefix(writer, &bname, &bns);
+
+	SerdBatchWriter* bwriter = serd_batch_writer_new(
+		SERD_TURTLE, SERD_STYLE_CURIED, benv, NULL, serd_chunk_sink, &multi, 3);
+	SerdBatch* batch = serd_batch_new();
+	for (unsigned i = 0; i < 64; ++i) {
+		char subj[32];
+		snprintf(subj, sizeof(subj), "http://example.org/s%u", i);
+		SerdNode bs = serd_node_from_string(SERD_URI, USTR(subj));
+		SerdNode bp = serd_node_from_string(SERD_URI,
+		                                    USTR("http://example.org/p"));
+		SerdNode bo = serd_node_from_string(SERD_LITERAL, USTR("o"));
+		for (unsigned j = 0; j < 3; ++j) {
+			serd_writer_write_statement(
+				writer, 0, NULL, &bs, &bp, &bo, NULL, NULL);
+			serd_batch_add_statement(batch, 0, NULL, &bs, &bp, &bo, NULL, NULL);
+		}
+		if (i % 4 == 3) {
+			serd_batch_writer_write(bwriter, batch);
+			if (serd_batch_size(batch)) {
+				return failure("Batch not taken by writer\n");
+			}
+		}
+	}
+	serd_writer_free(writer);
+	serd_batch_writer_free(bwriter);
+	serd_batch_free(batch);
+	serd_env_free(benv);
+
+	uint8_t* single_str = serd_chunk_sink_finish(&single);
+	uint8_t* multi_str  = serd_chunk_sink_finish(&multi);
+	if (strcmp((const char*)single_str, (const char*)multi_str)) {
+		return failure("Batch output differs:\n%s\n", multi_str);
+	}
+
+	// Test async sink with small blocks so writing waits for the I/O thread
+	SerdChunk      aout  = { NULL, 0 };
+	SerdAsyncSink* async = serd_async_sink_new(16, 2, serd_chunk_sink, &aout);
+	const size_t   alen  = strlen((const char*)single_str);
+	for (size_t i = 0; i < alen; i += 7) {
+		const size_t n = MIN(7, alen - i);
+		if (serd_async_sink_write(single_str + i, n, async) != n) {
+			return failure("Failed to write to async sink\n");
+		}
+	}
+	if (serd_async_sink_flush(async) || aout.len != alen) {
+		return failure("Flushed %zu of %zu bytes\n", aout.len, alen);
+	}
+	serd_async_sink_free(async);
+	uint8_t* async_str = serd_chunk_sink_finish(&aout);
+	if (strcmp((const char*)single_str, (const char*)async_str)) {
+		return failure("Async output differs:\n%s\n", async_str);
+	}
+	free(async_str);
+	free(single_str);
+	free(multi_str);
+
+	// Test compressor as a single stream and in parallel blocks
+	const size_t plain_len = 1000000;
+	uint8_t*     plain     = (uint8_t*)malloc(plain_len + 1);
+	for (size_t i = 0; i < plain_len; ++i) {
+		plain[i] = (uint8_t)('a' + (i * 7 + i / 13) % 26);
+	}
+	plain[plain_len] = '\0';
+	for (unsigned n_threads = 1; n_threads <= 3; n_threads += 2) {
+		SerdChunk       zout = { NULL, 0 };
+		SerdCompressor* comp = serd_compressor_new(
+			SERD_GZIP, 0, n_threads, serd_chunk_sink, &zout);
+		if (!comp) {
+			if (serd_compression_supported(SERD_GZIP)) {
+				return failure("Failed to create compressor\n");
+			}
+			break;
+		}
+		for (size_t i = 0; i < plain_len; i += 4099) {
+			const size_t n = MIN(4099, plain_len - i);
+			if (serd_compressor_sink(plain + i, n, comp) != n) {
+				return failure("Failed to compress\n");
+			}
+		}
+		if (serd_compressor_finish(comp)) {
+			return failure("Failed to finish compression\n");
+		}
+		serd_compressor_free(comp);
+#ifdef HAVE_ZLIB
+		uint8_t* unzipped = gunzip(zout.buf, zout.len, plain_len);
+		if (strcmp((const char*)unzipped, (const char*)plain)) {
+			return failure("Bad decompressed output with %u threads\n",
+			               n_threads);
+		}
+		free(unzipped);
+#endif
+		free((uint8_t*)zout.buf);
+	}
+	free(plain);
+
+	// Test that everything is allocated and freed with a custom allocator
+	AllocTest           at    = { 0, 0 };
+	const SerdAllocator alloc = {
+		&at, test_allocate, test_reallocate, test_deallocate
+	};
+	SerdNode anode = serd_node_new_integer_with_allocator(&alloc, 42);
+	SerdNode acopy = serd_node_copy_with_allocator(&alloc, &anode);
+	SerdNode ablob = serd_node_new_blob_with_allocator(&alloc, "blob", 4, 0);
+	SerdNode afile = serd_node_new_file_uri_with_allocator(
+		&alloc, USTR("/a b"), NULL, NULL, true);
+	if (at.n_live != 4 || strcmp((const char*)acopy.buf, "42") ||
+	    strcmp((const char*)afile.buf, "file:///a%20b")) {
+		return failure("Bad nodes from custom allocator\n");
+	}
+	serd_node_free_with_allocator(&alloc, &anode);
+	serd_node_free_with_allocator(&alloc, &acopy);
+	serd_node_free_with_allocator(&alloc, &ablob);
+	serd_node_free_with_allocator(&alloc, &afile);
+
+	SerdNode  abase  = serd_node_from_string(SERD_URI, USTR("http://ex.org/"));
+	SerdNode  acurie = serd_node_from_string(SERD_CURIE, USTR("eg:s"));
+	SerdEnv*  aenv   = serd_env_new_with_allocator(&alloc, &abase);
+	SerdChunk mout   = { NULL, 0 };
+	SerdWriter* awriter = serd_writer_new_with_allocator(
+		&alloc, SERD_TURTLE, SERD_STYLE_ABBREVIATED, aenv, NULL,
+		serd_chunk_sink, &mout);
+	SerdReader* areader = serd_reader_new_with_allocator(
+		&alloc, SERD_TURTLE, awriter, NULL,
+		(SerdBaseSink)serd_writer_set_base_uri,
+		(SerdPrefixSink)serd_writer_set_prefix,
+		(SerdStatementSink)serd_writer_write_statement,
+		(SerdEndSink)serd_writer_end_anon);
+	serd_reader_add_blank_prefix(areader, USTR("x"));
+	if (serd_reader_read_string(
+		    areader,
+		    USTR("@prefix eg: <rel/> .\n"
+		         "eg:s eg:p [ eg:q \"1\" ; eg:r ( eg:a eg:b ) ] .\n"))) {
+		return failure("Failed to read with custom allocator\n");
+	}
+	SerdNode aexp = serd_env_expand_node(aenv, &acurie);
+	if (strcmp((const char*)aexp.buf, "http://ex.org/rel/s")) {
+		return failure("Bad expansion with custom allocator\n");
+	}
+	serd_node_free_with_allocator(&alloc, &aexp);
+	serd_reader_free(areader);
+	serd_writer_free(awriter);
+	serd_env_free(aenv);
+	free((uint8_t*)mout.buf);
+	if (!at.n_allocs || at.n_live) {
+		return failure("Custom allocator made %zu allocations, %zu leaked\n",
+		               at.n_allocs, at.n_live);
+	}
+
 	serd_env_free(env);
 
 	printf("Success\n");